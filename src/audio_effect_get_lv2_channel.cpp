@@ -1,5 +1,6 @@
 #include "audio_effect_get_lv2_channel.h"
 #include "godot_cpp/classes/audio_server.hpp"
+#include "lv2_dsp.h"
 #include "lv2_server.h"
 #include <algorithm>
 
@@ -105,23 +106,16 @@ Ref<AudioEffectInstance> AudioEffectGetLv2Channel::_instantiate() {
 }
 
 void AudioEffectGetLv2ChannelInstance::_process(const void *p_src_frames, AudioFrame *p_dst_frames, int p_frame_count) {
-    AudioFrame *src_frames = (AudioFrame *)p_src_frames;
-
-    if (temp_buffer.size() != p_frame_count) {
-        temp_buffer.resize(p_frame_count);
-    }
+    const AudioFrame *src_frames = (const AudioFrame *)p_src_frames;
 
     Lv2Instance *instance = Lv2Server::get_singleton()->get_instance(base->get_instance_name());
-    if (instance != NULL) {
-        int p_rate = 1;
-        instance->get_channel_sample(temp_buffer.ptrw(), p_rate, p_frame_count, base->channel_left,
-                                     base->channel_right);
+    if (instance != NULL &&
+        instance->mix_channel_sample(p_dst_frames, src_frames, base->mix, p_frame_count, base->channel_left,
+                                     base->channel_right, get_instance_id()) > 0) {
+        return;
     }
 
-    for (int i = 0; i < p_frame_count; i++) {
-        p_dst_frames[i].left = (1 - base->mix) * src_frames[i].left + (base->mix) * temp_buffer[i].left;
-        p_dst_frames[i].right = (1 - base->mix) * src_frames[i].left + (base->mix) * temp_buffer[i].right;
-    }
+    lv2_dsp_scale((float *)p_dst_frames, (const float *)src_frames, p_frame_count * 2, 1 - base->mix);
 }
 
 bool AudioEffectGetLv2ChannelInstance::_process_silence() const {
@@ -14,7 +14,6 @@ class AudioEffectGetLv2ChannelInstance : public AudioEffectInstance {
     GDCLASS(AudioEffectGetLv2ChannelInstance, AudioEffectInstance);
 
 private:
-    Vector<AudioFrame> temp_buffer;
     friend class AudioEffectGetLv2Channel;
     Ref<AudioEffectGetLv2Channel> base;
     bool has_data = false;
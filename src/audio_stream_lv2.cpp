@@ -104,10 +104,10 @@ Lv2Instance *AudioStreamLv2::get_instance() {
     return NULL;
 }
 
-int AudioStreamLv2::process_sample(AudioFrame *p_buffer, float p_rate, int p_frames) {
+int AudioStreamLv2::process_sample(AudioFrame *p_buffer, float p_rate, int p_frames, uint64_t p_consumer) {
     Lv2Instance *lv2_instance = get_instance();
     if (lv2_instance != NULL) {
-        return lv2_instance->process_sample(p_buffer, p_rate, p_frames);
+        return lv2_instance->process_sample(p_buffer, p_rate, p_frames, p_consumer);
     }
 
     for (int frame = 0; frame < p_frames; frame += 1) {
@@ -118,6 +118,13 @@ int AudioStreamLv2::process_sample(AudioFrame *p_buffer, float p_rate, int p_fra
     return p_frames;
 }
 
+void AudioStreamLv2::release_consumer(uint64_t p_consumer) {
+    Lv2Instance *lv2_instance = get_instance();
+    if (lv2_instance != NULL) {
+        lv2_instance->release_output_consumer(p_consumer);
+    }
+}
+
 void AudioStreamLv2::_get_property_list(List<PropertyInfo> *p_list) const {
     String options = Lv2Server::get_singleton()->get_name_options();
     p_list->push_back(PropertyInfo(Variant::STRING_NAME, "lv2_name", PROPERTY_HINT_ENUM, options));
@@ -27,7 +27,8 @@ public:
     virtual String get_stream_name() const;
     virtual float get_length() const;
 
-    int process_sample(AudioFrame *p_buffer, float p_rate, int p_frames);
+    int process_sample(AudioFrame *p_buffer, float p_rate, int p_frames, uint64_t p_consumer = 0);
+    void release_consumer(uint64_t p_consumer);
 
     AudioStreamLv2();
     ~AudioStreamLv2();
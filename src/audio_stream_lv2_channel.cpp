@@ -50,10 +50,10 @@ Ref<AudioStreamPlayback> AudioStreamLv2Channel::_instantiate_playback() const {
     return talking_tree;
 }
 
-int AudioStreamLv2Channel::process_sample(AudioFrame *p_buffer, float p_rate, int p_frames) {
+int AudioStreamLv2Channel::process_sample(AudioFrame *p_buffer, float p_rate, int p_frames, uint64_t p_consumer) {
     Lv2Instance *instance = Lv2Server::get_singleton()->get_instance(get_instance_name());
     if (instance != NULL && instance->is_active()) {
-        return instance->get_channel_sample(p_buffer, p_rate, p_frames, channel_left, channel_right);
+        return instance->get_channel_sample(p_buffer, p_rate, p_frames, channel_left, channel_right, p_consumer);
     }
 
     for (int frame = 0; frame < p_frames; frame += 1) {
@@ -64,6 +64,13 @@ int AudioStreamLv2Channel::process_sample(AudioFrame *p_buffer, float p_rate, in
     return p_frames;
 }
 
+void AudioStreamLv2Channel::release_consumer(uint64_t p_consumer) {
+    Lv2Instance *instance = Lv2Server::get_singleton()->get_instance(get_instance_name());
+    if (instance != NULL) {
+        instance->release_output_consumer(p_consumer);
+    }
+}
+
 void AudioStreamLv2Channel::set_channel_left(int p_channel_left) {
     channel_left = p_channel_left;
 }
@@ -18,7 +18,8 @@ private:
 
 public:
     virtual String get_stream_name() const;
-    virtual int process_sample(AudioFrame *p_buffer, float p_rate, int p_frames);
+    virtual int process_sample(AudioFrame *p_buffer, float p_rate, int p_frames, uint64_t p_consumer = 0);
+    void release_consumer(uint64_t p_consumer);
     virtual float get_length() const;
     AudioStreamLv2Channel();
     ~AudioStreamLv2Channel();
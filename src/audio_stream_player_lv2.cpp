@@ -13,6 +13,7 @@ AudioStreamPlaybackLv2::~AudioStreamPlaybackLv2() {
 void AudioStreamPlaybackLv2::_stop() {
     active = false;
     base->set_active(active);
+    base->release_consumer(get_instance_id());
 }
 
 void AudioStreamPlaybackLv2::_start(double p_from_pos) {
@@ -32,7 +33,7 @@ int AudioStreamPlaybackLv2::_mix(AudioFrame *p_buffer, float p_rate, int p_frame
         return 0;
     }
 
-    return base->process_sample(p_buffer, p_rate, p_frames);
+    return base->process_sample(p_buffer, p_rate, p_frames, get_instance_id());
 }
 
 void AudioStreamPlaybackLv2::_tag_used_streams() {
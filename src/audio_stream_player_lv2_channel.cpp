@@ -11,6 +11,7 @@ AudioStreamPlaybackLv2Channel::~AudioStreamPlaybackLv2Channel() {
 
 void AudioStreamPlaybackLv2Channel::_stop() {
     active = false;
+    base->release_consumer(get_instance_id());
 }
 
 void AudioStreamPlaybackLv2Channel::_start(double p_from_pos) {
@@ -29,7 +30,7 @@ int AudioStreamPlaybackLv2Channel::_mix(AudioFrame *p_buffer, float p_rate, int
         return 0;
     }
 
-    return base->process_sample(p_buffer, p_rate, p_frames);
+    return base->process_sample(p_buffer, p_rate, p_frames, get_instance_id());
 }
 
 int AudioStreamPlaybackLv2Channel::_get_loop_count() const {
@@ -1,9 +1,16 @@
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sndfile.h>
 #include <vector>
 
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
 #include "lv2_host.h"
 
 using namespace godot;
@@ -216,9 +223,137 @@ bool run_offline(Lv2Host *lv2_host, double sr, double duration_sec, double freq_
     return true;
 }
 
+struct BenchResult {
+    double mean_usec = 0.0;
+    double p99_usec = 0.0;
+    double max_usec = 0.0;
+};
+
+// times perform() over p_blocks blocks of silence (plus a note on the first MIDI input), in process or in a
+// `--serve` child when p_executable is set
+bool run_bench(const std::string &p_uri, const std::string &p_executable, double p_sr, uint32_t p_block,
+               int p_blocks, BenchResult &r_result) {
+    LilvWorld *world = lilv_world_new();
+    Lv2Host *lv2_host = new Lv2Host(world, p_sr, p_block, p_block * 64u + 2048u);
+    lv2_host->set_remote_executable(p_executable);
+
+    if (!lv2_host->load_world() || !lv2_host->find_plugin(p_uri) || !lv2_host->instantiate()) {
+        std::cerr << "Failed to instantiate " << p_uri << (p_executable.empty() ? "" : " out of process") << "\n";
+        delete lv2_host;
+        lilv_world_free(world);
+        return false;
+    }
+    lv2_host->wire_worker_interface();
+    if (!lv2_host->prepare_ports_and_buffers(p_block)) {
+        std::cerr << "Failed to prepare/connect ports\n";
+        delete lv2_host;
+        lilv_world_free(world);
+        return false;
+    }
+
+    // out of process the buffers live in the shared segment, like the rings of an instance
+    for (int c = 0; c < lv2_host->get_input_channel_count(); c++) {
+        float *frames = lv2_host->allocate_shared_frames(p_block);
+        if (frames) {
+            std::fill(frames, frames + p_block, 0.0f);
+            lv2_host->bind_input_channel(c, frames, p_block, nullptr);
+        }
+    }
+    for (int c = 0; c < lv2_host->get_output_channel_count(); c++) {
+        float *frames = lv2_host->allocate_shared_frames(p_block);
+        if (frames) {
+            lv2_host->bind_output_channel(c, frames, p_block, nullptr);
+        }
+    }
+
+    lv2_host->activate();
+
+    std::vector<double> times;
+    times.reserve(p_blocks);
+    for (int i = 0; i < p_blocks; i++) {
+        if (i == 0 && lv2_host->get_input_midi_count() > 0) {
+            MidiEvent midi_event;
+            midi_event.data[0] = 0x90;
+            midi_event.data[1] = 60;
+            midi_event.data[2] = 100;
+            lv2_host->write_midi_in(0, midi_event);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        lv2_host->perform(p_block);
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    lv2_host->deactivate();
+    delete lv2_host;
+    lilv_world_free(world);
+
+    // the first blocks warm up caches and page tables
+    const size_t warmup = std::min<size_t>(times.size() / 10, 16);
+    times.erase(times.begin(), times.begin() + warmup);
+    if (times.empty()) {
+        return false;
+    }
+
+    double sum = 0.0;
+    for (double time : times) {
+        sum += time;
+    }
+    std::sort(times.begin(), times.end());
+    r_result.mean_usec = sum / (double)times.size();
+    r_result.p99_usec = times[std::min(times.size() - 1, (size_t)((double)times.size() * 0.99))];
+    r_result.max_usec = times.back();
+    return true;
+}
+
+int bench(const std::string &p_uri, int p_blocks) {
+    const double sr = 48000.0;
+    const uint32_t block = 512;
+
+    std::string executable;
+#ifdef __linux__
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length > 0) {
+        executable.assign(path, (size_t)length);
+    }
+#endif
+    if (executable.empty()) {
+        std::cerr << "Could not locate the lv2-host executable (out-of-process hosting needs Linux)\n";
+        return 2;
+    }
+
+    BenchResult local, remote;
+    if (!run_bench(p_uri, "", sr, block, p_blocks, local)) {
+        return 3;
+    }
+    if (!run_bench(p_uri, executable, sr, block, p_blocks, remote)) {
+        return 3;
+    }
+
+    const double period_usec = block * 1000000.0 / sr;
+    std::printf("%d blocks of %u frames (%.0f usec period)\n", p_blocks, block, period_usec);
+    std::printf("in process:     mean %8.1f usec  p99 %8.1f usec  max %8.1f usec\n", local.mean_usec, local.p99_usec,
+                local.max_usec);
+    std::printf("out of process: mean %8.1f usec  p99 %8.1f usec  max %8.1f usec\n", remote.mean_usec,
+                remote.p99_usec, remote.max_usec);
+    std::printf("overhead:       mean %8.1f usec  p99 %8.1f usec  (%.1f%% of the period)\n",
+                remote.mean_usec - local.mean_usec, remote.p99_usec - local.p99_usec,
+                (remote.mean_usec - local.mean_usec) * 100.0 / period_usec);
+    return 0;
+}
+
 int main(int argc, char **argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--serve") == 0) {
+        return lv2_remote_serve(std::atoi(argv[2]));
+    }
+    if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "--bench") == 0) {
+        return bench(argv[2], argc == 4 ? std::max(std::atoi(argv[3]), 1) : 2000);
+    }
     if (argc != 2) {
         std::cout << "Usage: " << argv[0] << " <plugin_uri>" << std::endl;
+        std::cout << "       " << argv[0] << " --bench <plugin_uri> [blocks]" << std::endl;
+        std::cout << "       " << argv[0] << " --serve <fd>" << std::endl;
         return 1;
     }
     const std::string plugin_uri = argv[1];
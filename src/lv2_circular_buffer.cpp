@@ -2,37 +2,59 @@
 
 using namespace godot;
 
-template <typename T> Lv2CircularBuffer<T>::Lv2CircularBuffer() {
+template <typename T> Lv2CircularBuffer<T>::Lv2CircularBuffer(int p_capacity) {
+    storage.assign(p_capacity, T());
+    audio_buffer.buffer = storage.data();
+    audio_buffer.capacity = p_capacity;
 }
 
 template <typename T> Lv2CircularBuffer<T>::~Lv2CircularBuffer() {
 }
 
+template <typename T> Lv2CircularBuffer<T>::Lv2CircularBuffer(const Lv2CircularBuffer &p_other) {
+    *this = p_other;
+}
+
+template <typename T> Lv2CircularBuffer<T> &Lv2CircularBuffer<T>::operator=(const Lv2CircularBuffer &p_other) {
+    if (this == &p_other) {
+        return *this;
+    }
+
+    audio_buffer = p_other.audio_buffer;
+    storage = p_other.storage;
+
+    // owned storage is copied, attached memory stays shared
+    if (!p_other.storage.empty()) {
+        audio_buffer.buffer = storage.data();
+    }
+
+    return *this;
+}
+
+template <typename T> void Lv2CircularBuffer<T>::attach(T *p_data, int p_capacity) {
+    std::vector<T>().swap(storage);
+    audio_buffer.buffer = p_data;
+    audio_buffer.capacity = p_capacity;
+    audio_buffer.read_index = 0;
+    audio_buffer.write_index = 0;
+}
+
 template <typename T> void Lv2CircularBuffer<T>::write_channel(const T *p_buffer, int p_frames) {
     for (int frame = 0; frame < p_frames; frame++) {
-        audio_buffer.buffer[(audio_buffer.write_index + frame) % CIRCULAR_BUFFER_SIZE] = p_buffer[frame];
+        audio_buffer.buffer[(audio_buffer.write_index + frame) % audio_buffer.capacity] = p_buffer[frame];
     }
-    audio_buffer.write_index = (audio_buffer.write_index + p_frames) % CIRCULAR_BUFFER_SIZE;
+    audio_buffer.write_index = (audio_buffer.write_index + p_frames) % audio_buffer.capacity;
 }
 
 template <typename T> int Lv2CircularBuffer<T>::read_channel(T *p_buffer, int p_frames) {
     const int read_index = audio_buffer.read_index;
-    const int write_index = audio_buffer.write_index;
 
-    int available = 0;
-
-    if (write_index >= read_index) {
-        available = write_index - read_index;
-    } else {
-        available = (CIRCULAR_BUFFER_SIZE - read_index) + write_index;
-    }
-
-    if (available < p_frames) {
+    if (get_available() < p_frames) {
         return 0;
     }
 
     for (int frame = 0; frame < p_frames; frame++) {
-        p_buffer[frame] = audio_buffer.buffer[(read_index + frame) % CIRCULAR_BUFFER_SIZE];
+        p_buffer[frame] = audio_buffer.buffer[(read_index + frame) % audio_buffer.capacity];
     }
 
     return p_frames;
@@ -48,24 +70,73 @@ template <typename T> void Lv2CircularBuffer<T>::set_write_index(int p_index) {
 
 template <typename T> int Lv2CircularBuffer<T>::update_read_index(int p_frames) {
     const int read_index = audio_buffer.read_index;
-    const int write_index = audio_buffer.write_index;
 
-    // TODO: remove duplicate code
-    int available = 0;
+    if (get_available() < p_frames) {
+        return 0;
+    }
+
+    audio_buffer.read_index = (read_index + p_frames) % audio_buffer.capacity;
+
+    return p_frames;
+}
+
+template <typename T> T *Lv2CircularBuffer<T>::get_data() {
+    return audio_buffer.buffer;
+}
+
+template <typename T> int Lv2CircularBuffer<T>::get_capacity() const {
+    return audio_buffer.capacity;
+}
+
+template <typename T> int Lv2CircularBuffer<T>::get_read_index() const {
+    return audio_buffer.read_index;
+}
+
+template <typename T> int Lv2CircularBuffer<T>::get_write_index() const {
+    return audio_buffer.write_index;
+}
+
+template <typename T> int Lv2CircularBuffer<T>::get_available() const {
+    const int read_index = audio_buffer.read_index;
+    const int write_index = audio_buffer.write_index;
 
     if (write_index >= read_index) {
-        available = write_index - read_index;
-    } else {
-        available = (CIRCULAR_BUFFER_SIZE - read_index) + write_index;
+        return write_index - read_index;
     }
 
-    if (available < p_frames) {
-        return 0;
+    return (audio_buffer.capacity - read_index) + write_index;
+}
+
+template <typename T> Lv2RingSpan<T> Lv2CircularBuffer<T>::reserve(int p_frames) {
+    Lv2RingSpan<T> span;
+    const int write_index = audio_buffer.write_index;
+
+    span.first = audio_buffer.buffer + write_index;
+    span.first_frames = p_frames < audio_buffer.capacity - write_index ? p_frames : audio_buffer.capacity - write_index;
+    span.second = audio_buffer.buffer;
+    span.second_frames = p_frames - span.first_frames;
+
+    return span;
+}
+
+template <typename T> void Lv2CircularBuffer<T>::commit(int p_frames) {
+    audio_buffer.write_index = (audio_buffer.write_index + p_frames) % audio_buffer.capacity;
+}
+
+template <typename T> Lv2RingSpan<T> Lv2CircularBuffer<T>::peek(int p_frames) {
+    Lv2RingSpan<T> span;
+    if (get_available() < p_frames) {
+        return span;
     }
 
-    audio_buffer.read_index = (read_index + p_frames) % CIRCULAR_BUFFER_SIZE;
+    const int read_index = audio_buffer.read_index;
 
-    return p_frames;
+    span.first = audio_buffer.buffer + read_index;
+    span.first_frames = p_frames < audio_buffer.capacity - read_index ? p_frames : audio_buffer.capacity - read_index;
+    span.second = audio_buffer.buffer;
+    span.second_frames = p_frames - span.first_frames;
+
+    return span;
 }
 
 namespace godot {
@@ -1,15 +1,27 @@
 #ifndef LV2_CIRCULAR_BUFFER_H
 #define LV2_CIRCULAR_BUFFER_H
 
+#include <vector>
+
 namespace godot {
 
+// default capacity of rings that own their storage
 const int CIRCULAR_BUFFER_SIZE = 2048;
 
 template <typename T> struct AudioRingBuffer {
     int write_index = 0;
     int read_index = 0;
+    int capacity = 0;
+
+    T *buffer = nullptr;
+};
 
-    T buffer[CIRCULAR_BUFFER_SIZE];
+// a ring range as up to two contiguous pieces, second is only used when the range wraps
+template <typename T> struct Lv2RingSpan {
+    T *first = nullptr;
+    int first_frames = 0;
+    T *second = nullptr;
+    int second_frames = 0;
 };
 
 template <typename T> class Lv2CircularBuffer {
@@ -17,10 +29,19 @@ template <typename T> class Lv2CircularBuffer {
 private:
     AudioRingBuffer<T> audio_buffer;
 
+    // empty when the ring is attached to memory owned by someone else
+    std::vector<T> storage;
+
 public:
-    Lv2CircularBuffer();
+    explicit Lv2CircularBuffer(int p_capacity = CIRCULAR_BUFFER_SIZE);
     ~Lv2CircularBuffer();
 
+    Lv2CircularBuffer(const Lv2CircularBuffer &p_other);
+    Lv2CircularBuffer &operator=(const Lv2CircularBuffer &p_other);
+
+    // use p_data (p_capacity elements, outliving the ring) instead of owned storage, resets the indices
+    void attach(T *p_data, int p_capacity);
+
     // TODO: rename to write_buffer or write
     void write_channel(const T *p_buffer, int p_frames);
 
@@ -30,6 +51,21 @@ public:
     void set_read_index(int p_index);
     void set_write_index(int p_index);
     int update_read_index(int p_frames);
+
+    // direct access to the ring storage for kernels that read or write in place
+    T *get_data();
+    int get_capacity() const;
+    int get_read_index() const;
+    int get_write_index() const;
+    int get_available() const;
+
+    // zero-copy writes: the next p_frames of storage, filled in place and published with commit();
+    // like write_channel this never waits for readers
+    Lv2RingSpan<T> reserve(int p_frames);
+    void commit(int p_frames);
+
+    // zero-copy reads: the next p_frames readable in place (empty when fewer are available), then update_read_index()
+    Lv2RingSpan<T> peek(int p_frames);
 };
 
 } // namespace godot
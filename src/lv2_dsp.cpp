@@ -0,0 +1,306 @@
+#include "lv2_dsp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace godot;
+
+namespace {
+
+// coefficients interleaved by tap: coef[k * TRUE_PEAK_OVERSAMPLE + phase]
+struct TruePeakFilter {
+    alignas(16) float coef[TRUE_PEAK_TAPS * TRUE_PEAK_OVERSAMPLE];
+
+    TruePeakFilter() {
+        const int length = TRUE_PEAK_TAPS * TRUE_PEAK_OVERSAMPLE;
+        const double center = (length - 1) / 2.0;
+        const double pi = 3.14159265358979323846;
+
+        for (int phase = 0; phase < TRUE_PEAK_OVERSAMPLE; phase++) {
+            double sum = 0.0;
+            for (int k = 0; k < TRUE_PEAK_TAPS; k++) {
+                const int n = k * TRUE_PEAK_OVERSAMPLE + phase;
+                const double t = (n - center) / TRUE_PEAK_OVERSAMPLE;
+                const double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+                const double window = 0.5 - 0.5 * std::cos(2.0 * pi * (n + 0.5) / length);
+                coef[k * TRUE_PEAK_OVERSAMPLE + phase] = (float)(sinc * window);
+                sum += sinc * window;
+            }
+            for (int k = 0; k < TRUE_PEAK_TAPS; k++) {
+                coef[k * TRUE_PEAK_OVERSAMPLE + phase] /= (float)sum;
+            }
+        }
+    }
+};
+
+const TruePeakFilter true_peak_filter;
+
+} // namespace
+
+void godot::lv2_dsp_scale(float *p_dst, const float *p_src, int p_count, float p_gain) {
+    int i = 0;
+
+#if defined(LV2_DSP_AVX)
+    const __m256 gain = _mm256_set1_ps(p_gain);
+    for (; i + 8 <= p_count; i += 8) {
+        _mm256_storeu_ps(p_dst + i, _mm256_mul_ps(_mm256_loadu_ps(p_src + i), gain));
+    }
+#elif defined(LV2_DSP_SSE)
+    const __m128 gain = _mm_set1_ps(p_gain);
+    for (; i + 4 <= p_count; i += 4) {
+        _mm_storeu_ps(p_dst + i, _mm_mul_ps(_mm_loadu_ps(p_src + i), gain));
+    }
+#elif defined(LV2_DSP_NEON)
+    for (; i + 4 <= p_count; i += 4) {
+        vst1q_f32(p_dst + i, vmulq_n_f32(vld1q_f32(p_src + i), p_gain));
+    }
+#endif
+
+    for (; i < p_count; i++) {
+        p_dst[i] = p_src[i] * p_gain;
+    }
+}
+
+void godot::lv2_dsp_interleave(float *p_dst, const float *p_left, const float *p_right, int p_frames, float p_gain) {
+    int i = 0;
+
+#if defined(LV2_DSP_AVX)
+    const __m256 gain = _mm256_set1_ps(p_gain);
+    for (; i + 8 <= p_frames; i += 8) {
+        const __m256 l = _mm256_mul_ps(_mm256_loadu_ps(p_left + i), gain);
+        const __m256 r = _mm256_mul_ps(_mm256_loadu_ps(p_right + i), gain);
+        // unpack works per 128-bit lane, permute puts the halves back in order
+        const __m256 lo = _mm256_unpacklo_ps(l, r);
+        const __m256 hi = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(p_dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(p_dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+#elif defined(LV2_DSP_SSE)
+    const __m128 gain = _mm_set1_ps(p_gain);
+    for (; i + 4 <= p_frames; i += 4) {
+        const __m128 l = _mm_mul_ps(_mm_loadu_ps(p_left + i), gain);
+        const __m128 r = _mm_mul_ps(_mm_loadu_ps(p_right + i), gain);
+        _mm_storeu_ps(p_dst + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(p_dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(LV2_DSP_NEON)
+    for (; i + 4 <= p_frames; i += 4) {
+        float32x4x2_t lr;
+        lr.val[0] = vmulq_n_f32(vld1q_f32(p_left + i), p_gain);
+        lr.val[1] = vmulq_n_f32(vld1q_f32(p_right + i), p_gain);
+        vst2q_f32(p_dst + 2 * i, lr);
+    }
+#endif
+
+    for (; i < p_frames; i++) {
+        p_dst[2 * i] = p_left[i] * p_gain;
+        p_dst[2 * i + 1] = p_right[i] * p_gain;
+    }
+}
+
+void godot::lv2_dsp_interleave_mix(float *p_dst, const float *p_dry, const float *p_left, const float *p_right,
+                                   int p_frames, float p_dry_gain, float p_wet_gain) {
+    int i = 0;
+
+#if defined(LV2_DSP_AVX)
+    const __m256 dry_gain = _mm256_set1_ps(p_dry_gain);
+    const __m256 wet_gain = _mm256_set1_ps(p_wet_gain);
+    for (; i + 8 <= p_frames; i += 8) {
+        const __m256 l = _mm256_mul_ps(_mm256_loadu_ps(p_left + i), wet_gain);
+        const __m256 r = _mm256_mul_ps(_mm256_loadu_ps(p_right + i), wet_gain);
+        const __m256 lo = _mm256_unpacklo_ps(l, r);
+        const __m256 hi = _mm256_unpackhi_ps(l, r);
+        const __m256 dry0 = _mm256_mul_ps(_mm256_loadu_ps(p_dry + 2 * i), dry_gain);
+        const __m256 dry1 = _mm256_mul_ps(_mm256_loadu_ps(p_dry + 2 * i + 8), dry_gain);
+        _mm256_storeu_ps(p_dst + 2 * i, _mm256_add_ps(dry0, _mm256_permute2f128_ps(lo, hi, 0x20)));
+        _mm256_storeu_ps(p_dst + 2 * i + 8, _mm256_add_ps(dry1, _mm256_permute2f128_ps(lo, hi, 0x31)));
+    }
+#elif defined(LV2_DSP_SSE)
+    const __m128 dry_gain = _mm_set1_ps(p_dry_gain);
+    const __m128 wet_gain = _mm_set1_ps(p_wet_gain);
+    for (; i + 4 <= p_frames; i += 4) {
+        const __m128 l = _mm_mul_ps(_mm_loadu_ps(p_left + i), wet_gain);
+        const __m128 r = _mm_mul_ps(_mm_loadu_ps(p_right + i), wet_gain);
+        const __m128 dry0 = _mm_mul_ps(_mm_loadu_ps(p_dry + 2 * i), dry_gain);
+        const __m128 dry1 = _mm_mul_ps(_mm_loadu_ps(p_dry + 2 * i + 4), dry_gain);
+        _mm_storeu_ps(p_dst + 2 * i, _mm_add_ps(dry0, _mm_unpacklo_ps(l, r)));
+        _mm_storeu_ps(p_dst + 2 * i + 4, _mm_add_ps(dry1, _mm_unpackhi_ps(l, r)));
+    }
+#elif defined(LV2_DSP_NEON)
+    for (; i + 4 <= p_frames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(p_dry + 2 * i);
+        lr.val[0] = vmlaq_n_f32(vmulq_n_f32(lr.val[0], p_dry_gain), vld1q_f32(p_left + i), p_wet_gain);
+        lr.val[1] = vmlaq_n_f32(vmulq_n_f32(lr.val[1], p_dry_gain), vld1q_f32(p_right + i), p_wet_gain);
+        vst2q_f32(p_dst + 2 * i, lr);
+    }
+#endif
+
+    for (; i < p_frames; i++) {
+        p_dst[2 * i] = p_dry[2 * i] * p_dry_gain + p_left[i] * p_wet_gain;
+        p_dst[2 * i + 1] = p_dry[2 * i + 1] * p_dry_gain + p_right[i] * p_wet_gain;
+    }
+}
+
+void godot::lv2_dsp_deinterleave(float *p_left, float *p_right, const float *p_src, int p_frames, float p_gain) {
+    int i = 0;
+
+#if defined(LV2_DSP_AVX)
+    const __m256 gain = _mm256_set1_ps(p_gain);
+    for (; i + 8 <= p_frames; i += 8) {
+        const __m256 a = _mm256_loadu_ps(p_src + 2 * i);
+        const __m256 b = _mm256_loadu_ps(p_src + 2 * i + 8);
+        const __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+        const __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+        if (p_left) {
+            _mm256_storeu_ps(p_left + i, _mm256_mul_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), gain));
+        }
+        if (p_right) {
+            _mm256_storeu_ps(p_right + i, _mm256_mul_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), gain));
+        }
+    }
+#elif defined(LV2_DSP_SSE)
+    const __m128 gain = _mm_set1_ps(p_gain);
+    for (; i + 4 <= p_frames; i += 4) {
+        const __m128 a = _mm_loadu_ps(p_src + 2 * i);
+        const __m128 b = _mm_loadu_ps(p_src + 2 * i + 4);
+        if (p_left) {
+            _mm_storeu_ps(p_left + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), gain));
+        }
+        if (p_right) {
+            _mm_storeu_ps(p_right + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), gain));
+        }
+    }
+#elif defined(LV2_DSP_NEON)
+    for (; i + 4 <= p_frames; i += 4) {
+        const float32x4x2_t lr = vld2q_f32(p_src + 2 * i);
+        if (p_left) {
+            vst1q_f32(p_left + i, vmulq_n_f32(lr.val[0], p_gain));
+        }
+        if (p_right) {
+            vst1q_f32(p_right + i, vmulq_n_f32(lr.val[1], p_gain));
+        }
+    }
+#endif
+
+    for (; i < p_frames; i++) {
+        if (p_left) {
+            p_left[i] = p_src[2 * i] * p_gain;
+        }
+        if (p_right) {
+            p_right[i] = p_src[2 * i + 1] * p_gain;
+        }
+    }
+}
+
+void godot::lv2_dsp_peak_sum_squares(const float *p_src, int p_frames, float &r_peak, float &r_sum_squares) {
+    float peak = 0.0f;
+    float sum = 0.0f;
+    int i = 0;
+
+#if defined(LV2_DSP_AVX)
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 vpeak = _mm256_setzero_ps();
+    __m256 vsum = _mm256_setzero_ps();
+    for (; i + 8 <= p_frames; i += 8) {
+        const __m256 x = _mm256_loadu_ps(p_src + i);
+        vpeak = _mm256_max_ps(vpeak, _mm256_and_ps(x, abs_mask));
+        vsum = _mm256_add_ps(vsum, _mm256_mul_ps(x, x));
+    }
+    alignas(32) float lanes_peak[8], lanes_sum[8];
+    _mm256_store_ps(lanes_peak, vpeak);
+    _mm256_store_ps(lanes_sum, vsum);
+    for (int lane = 0; lane < 8; lane++) {
+        peak = std::max(peak, lanes_peak[lane]);
+        sum += lanes_sum[lane];
+    }
+#elif defined(LV2_DSP_SSE)
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 vpeak = _mm_setzero_ps();
+    __m128 vsum = _mm_setzero_ps();
+    for (; i + 4 <= p_frames; i += 4) {
+        const __m128 x = _mm_loadu_ps(p_src + i);
+        vpeak = _mm_max_ps(vpeak, _mm_and_ps(x, abs_mask));
+        vsum = _mm_add_ps(vsum, _mm_mul_ps(x, x));
+    }
+    alignas(16) float lanes_peak[4], lanes_sum[4];
+    _mm_store_ps(lanes_peak, vpeak);
+    _mm_store_ps(lanes_sum, vsum);
+    for (int lane = 0; lane < 4; lane++) {
+        peak = std::max(peak, lanes_peak[lane]);
+        sum += lanes_sum[lane];
+    }
+#elif defined(LV2_DSP_NEON)
+    float32x4_t vpeak = vdupq_n_f32(0.0f);
+    float32x4_t vsum = vdupq_n_f32(0.0f);
+    for (; i + 4 <= p_frames; i += 4) {
+        const float32x4_t x = vld1q_f32(p_src + i);
+        vpeak = vmaxq_f32(vpeak, vabsq_f32(x));
+        vsum = vmlaq_f32(vsum, x, x);
+    }
+    peak = vmaxvq_f32(vpeak);
+    sum = vaddvq_f32(vsum);
+#endif
+
+    for (; i < p_frames; i++) {
+        const float x = p_src[i];
+        peak = std::max(peak, std::fabs(x));
+        sum += x * x;
+    }
+
+    r_peak = peak;
+    r_sum_squares = sum;
+}
+
+float godot::lv2_dsp_true_peak(const float *p_src, int p_frames, float *p_history, float *p_scratch) {
+    if (p_frames <= 0) {
+        return 0.0f;
+    }
+
+    std::memcpy(p_scratch, p_history, TRUE_PEAK_HISTORY * sizeof(float));
+    std::memcpy(p_scratch + TRUE_PEAK_HISTORY, p_src, p_frames * sizeof(float));
+
+    const float *coef = true_peak_filter.coef;
+    const float *x = p_scratch + TRUE_PEAK_HISTORY;
+    float peak = 0.0f;
+
+#if defined(LV2_DSP_AVX) || defined(LV2_DSP_SSE)
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 vpeak = _mm_setzero_ps();
+    for (int i = 0; i < p_frames; i++) {
+        // all four phases of output sample i at once
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < TRUE_PEAK_TAPS; k++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(coef + k * TRUE_PEAK_OVERSAMPLE), _mm_set1_ps(x[i - k])));
+        }
+        vpeak = _mm_max_ps(vpeak, _mm_and_ps(acc, abs_mask));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, vpeak);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(LV2_DSP_NEON)
+    float32x4_t vpeak = vdupq_n_f32(0.0f);
+    for (int i = 0; i < p_frames; i++) {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (int k = 0; k < TRUE_PEAK_TAPS; k++) {
+            acc = vmlaq_n_f32(acc, vld1q_f32(coef + k * TRUE_PEAK_OVERSAMPLE), x[i - k]);
+        }
+        vpeak = vmaxq_f32(vpeak, vabsq_f32(acc));
+    }
+    peak = vmaxvq_f32(vpeak);
+#else
+    for (int i = 0; i < p_frames; i++) {
+        for (int phase = 0; phase < TRUE_PEAK_OVERSAMPLE; phase++) {
+            float acc = 0.0f;
+            for (int k = 0; k < TRUE_PEAK_TAPS; k++) {
+                acc += coef[k * TRUE_PEAK_OVERSAMPLE + phase] * x[i - k];
+            }
+            peak = std::max(peak, std::fabs(acc));
+        }
+    }
+#endif
+
+    std::memcpy(p_history, p_scratch + p_frames, TRUE_PEAK_HISTORY * sizeof(float));
+
+    return peak;
+}
@@ -0,0 +1,45 @@
+#ifndef LV2_DSP_H
+#define LV2_DSP_H
+
+#if defined(__AVX__)
+#define LV2_DSP_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define LV2_DSP_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define LV2_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace godot {
+
+// 4x oversampling polyphase interpolator used for true-peak detection
+const int TRUE_PEAK_OVERSAMPLE = 4;
+const int TRUE_PEAK_TAPS = 12;
+const int TRUE_PEAK_HISTORY = TRUE_PEAK_TAPS - 1;
+
+// dst = src * gain, dst may alias src.
+void lv2_dsp_scale(float *p_dst, const float *p_src, int p_count, float p_gain);
+
+// Planar -> interleaved stereo, dst[2i] = left[i] * gain, dst[2i + 1] = right[i] * gain.
+void lv2_dsp_interleave(float *p_dst, const float *p_left, const float *p_right, int p_frames, float p_gain);
+
+// Same as lv2_dsp_interleave but mixed over an interleaved dry signal: dst = dry * dry_gain + wet * wet_gain.
+// dst may alias dry.
+void lv2_dsp_interleave_mix(float *p_dst, const float *p_dry, const float *p_left, const float *p_right, int p_frames,
+                            float p_dry_gain, float p_wet_gain);
+
+// Interleaved stereo -> planar with gain, either output may be null.
+void lv2_dsp_deinterleave(float *p_left, float *p_right, const float *p_src, int p_frames, float p_gain);
+
+// Peak of |x| and sum of x^2 over a block.
+void lv2_dsp_peak_sum_squares(const float *p_src, int p_frames, float &r_peak, float &r_sum_squares);
+
+// Inter-sample peak of a block. p_history holds the last TRUE_PEAK_HISTORY input samples of the previous
+// block and is updated; p_scratch must hold TRUE_PEAK_HISTORY + p_frames floats.
+float lv2_dsp_true_peak(const float *p_src, int p_frames, float *p_history, float *p_scratch);
+
+} // namespace godot
+
+#endif
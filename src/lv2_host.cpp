@@ -1,14 +1,31 @@
 #include "lv2_host.h"
 #include "lilv/lilv.h"
+#include "lv2_midi_map.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 // #include <exception>
+#include <filesystem>
 #include <iostream>
 #include <vector>
 
+#ifndef LV2_STATE__threadSafeRestore
+#define LV2_STATE__threadSafeRestore LV2_STATE_PREFIX "threadSafeRestore"
+#endif
+
+#ifdef __linux__
+// exported by the lilv build patched in platform/vcpkg/ports/lilv, missing from a stock lilv: the library is then
+// always loaded into the shared namespace
+extern "C" {
+__attribute__((weak)) void lilv_dylib_set_isolated(bool isolated);
+__attribute__((weak)) bool lilv_dylib_was_isolated(void);
+}
+#endif
+
 using namespace godot;
 
 // helpers
@@ -20,6 +37,122 @@ static inline std::string to_string_safe(const char *s, const char *fb = "") {
     return std::string(value);
 }
 
+namespace {
+std::atomic<int> isolated_namespaces{0};
+
+bool claim_isolated_namespace() {
+    int count = isolated_namespaces.load();
+    while (count < ISOLATED_NAMESPACE_LIMIT) {
+        if (isolated_namespaces.compare_exchange_weak(count, count + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+// state snapshot blob: "LV2S", version, plugin uri, control symbols/values, state properties
+namespace {
+constexpr uint8_t kStateMagic[4] = {'L', 'V', '2', 'S'};
+constexpr uint32_t kStateVersion = 1;
+
+struct StateWriter {
+    std::vector<uint8_t> &out;
+
+    void bytes(const void *p_data, size_t p_size) {
+        const uint8_t *b = static_cast<const uint8_t *>(p_data);
+        out.insert(out.end(), b, b + p_size);
+    }
+    void u32(uint32_t p_value) {
+        bytes(&p_value, sizeof(p_value));
+    }
+    void f32(float p_value) {
+        bytes(&p_value, sizeof(p_value));
+    }
+    void str(const std::string &p_value) {
+        u32((uint32_t)p_value.size());
+        bytes(p_value.data(), p_value.size());
+    }
+};
+
+struct StateReader {
+    const std::vector<uint8_t> &in;
+    size_t pos = 0;
+
+    bool bytes(void *r_data, size_t p_size) {
+        if (p_size > in.size() - pos) {
+            return false;
+        }
+        std::memcpy(r_data, in.data() + pos, p_size);
+        pos += p_size;
+        return true;
+    }
+    bool u32(uint32_t &r_value) {
+        return bytes(&r_value, sizeof(r_value));
+    }
+    bool f32(float &r_value) {
+        return bytes(&r_value, sizeof(r_value));
+    }
+    bool str(std::string &r_value) {
+        uint32_t size = 0;
+        if (!u32(size) || size > in.size() - pos) {
+            return false;
+        }
+        r_value.assign(reinterpret_cast<const char *>(in.data() + pos), size);
+        pos += size;
+        return true;
+    }
+};
+
+struct StateContext {
+    Lv2Host *host = nullptr;
+    std::vector<StateProperty> *properties = nullptr;
+};
+
+// insertion sort keeps arrival order for equal frames and never allocates (runs on the DSP thread)
+template <typename T> void sort_by_frame(std::vector<T> &p_events) {
+    for (size_t i = 1; i < p_events.size(); ++i) {
+        T event = p_events[i];
+        size_t j = i;
+        while (j > 0 && p_events[j - 1].frame > event.frame) {
+            p_events[j] = p_events[j - 1];
+            --j;
+        }
+        p_events[j] = event;
+    }
+}
+
+static inline double elapsed_usec(std::chrono::steady_clock::time_point p_start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+// copies p_frames frames out of a binding that may wrap
+void gather_binding(const PortBinding &p_binding, float *r_dest, int p_frames) {
+    const int first_frames = (int)std::min<uint32_t>(p_binding.first_frames, (uint32_t)p_frames);
+    std::memcpy(r_dest, p_binding.first, first_frames * sizeof(float));
+    if (first_frames < p_frames) {
+        std::memcpy(r_dest + first_frames, p_binding.second, (p_frames - first_frames) * sizeof(float));
+    }
+}
+
+// copies p_frames frames into a binding that may wrap, silence when p_source is null
+void scatter_binding(const PortBinding &p_binding, const float *p_source, int p_frames) {
+    const int first_frames = (int)std::min<uint32_t>(p_binding.first_frames, (uint32_t)p_frames);
+    if (p_source) {
+        std::memcpy(p_binding.first, p_source, first_frames * sizeof(float));
+    } else {
+        std::memset(p_binding.first, 0, first_frames * sizeof(float));
+    }
+    if (first_frames < p_frames) {
+        if (p_source) {
+            std::memcpy(p_binding.second, p_source + first_frames, (p_frames - first_frames) * sizeof(float));
+        } else {
+            std::memset(p_binding.second, 0, (p_frames - first_frames) * sizeof(float));
+        }
+    }
+}
+} // namespace
+
 // ============================================================
 // Optional debug guards (enable with -DLV2HOST_DEBUG_GUARDS)
 // ============================================================
@@ -135,6 +268,8 @@ Lv2Host::Lv2Host(LilvWorld *p_world, double sr, int p_frames, uint32_t seq_bytes
     // lv2:worker proxy
     worker.sched.handle = &worker;
     worker.sched.schedule_work = &Lv2Host::s_schedule_work;
+    worker.requests.data.resize(WORKER_QUEUE_BYTES);
+    worker.responses.data.resize(WORKER_QUEUE_BYTES);
     feat_worker.URI = LV2_WORKER__schedule;
     feat_worker.data = &worker.sched;
 
@@ -169,6 +304,10 @@ Lv2Host::Lv2Host(LilvWorld *p_world, double sr, int p_frames, uint32_t seq_bytes
 }
 
 Lv2Host::~Lv2Host() {
+    if (remote) {
+        delete remote;
+        remote = nullptr;
+    }
     if (inst) {
         for (uint32_t i = 0; i < num_ports; ++i) {
             lilv_instance_connect_port(inst, i, nullptr);
@@ -206,6 +345,10 @@ Lv2Host::~Lv2Host() {
         lilv_instance_free(inst);
         inst = nullptr;
     }
+    if (isolated) {
+        isolated_namespaces--;
+        isolated = false;
+    }
     /*
     if (world) {
         lilv_world_free(world);
@@ -281,6 +424,7 @@ bool Lv2Host::find_plugin(const std::string &plugin_uri) {
         return false;
     }
     num_ports = lilv_plugin_get_num_ports(plugin);
+    remote_uri = plugin_uri;
     return true;
 }
 
@@ -289,15 +433,88 @@ bool Lv2Host::instantiate() {
         return false;
     }
 
+    // a reload (other plugin or loading policy) replaces whatever ran before
+    if (remote) {
+        delete remote;
+        remote = nullptr;
+    }
+    if (inst) {
+        lilv_instance_free(inst);
+        inst = nullptr;
+        desc = nullptr;
+    }
+    // a state parsed for the old instance
+    restore_pending.store(false, std::memory_order_release);
+    if (isolated) {
+        isolated_namespaces--;
+        isolated = false;
+    }
+
+    if (!remote_executable.empty()) {
+        remote = new Lv2RemoteLink(remote_executable);
+        remote->set_realtime(remote_realtime_policy, remote_realtime_priority);
+        remote->set_timeout_usec(remote_timeout_usec);
+        remote->set_snapshot_interval_ms(remote_snapshot_interval_ms);
+        const uint32_t min_frames = min_sub_block.load(std::memory_order_relaxed);
+        if (!remote->start(remote_uri, sr, max, seq_bytes, min_frames, state_dir, remote_lv2_path)) {
+            return false;
+        }
+        // commands are served between blocks by the child, never concurrently with run()
+        thread_safe_restore = true;
+        return true;
+    }
+
+    bool isolate = false;
+#ifdef __linux__
+    isolate = isolation_requested && lilv_dylib_set_isolated && lilv_dylib_was_isolated && claim_isolated_namespace();
+    if (isolate) {
+        lilv_dylib_set_isolated(true);
+    }
+#endif
+
     inst = lilv_plugin_instantiate(plugin, sr, features);
 
+#ifdef __linux__
+    if (isolate) {
+        lilv_dylib_set_isolated(false);
+        // dlmopen() also fails when glibc ran out of namespaces (some are taken by other libraries' dlmopen()
+        // calls), lilv then loaded the library into the shared one
+        isolated = inst && lilv_dylib_was_isolated();
+        if (!isolated) {
+            isolated_namespaces--;
+        }
+    }
+#endif
+
     if (!inst) {
         return false;
     }
     desc = lilv_instance_get_descriptor(inst);
+
+    state_iface = nullptr;
+    if (desc && desc->extension_data) {
+        state_iface = (const LV2_State_Interface *)desc->extension_data(LV2_STATE__interface);
+    }
+
+    LilvNode *thread_safe_node = lilv_new_uri(world, LV2_STATE__threadSafeRestore);
+    thread_safe_restore = lilv_plugin_has_feature(plugin, thread_safe_node);
+    lilv_node_free(thread_safe_node);
+
     return true;
 }
 
+void Lv2Host::set_isolated(bool p_isolated) {
+    isolation_requested = p_isolated;
+}
+
+bool Lv2Host::is_isolated() const {
+    return isolated;
+}
+
+int Lv2Host::get_isolated_namespace_count() {
+    return isolated_namespaces.load();
+}
+
 void Lv2Host::wire_worker_interface() {
     if (!desc || !desc->extension_data) {
         return;
@@ -373,9 +590,12 @@ uint32_t Lv2Host::lookup_port_index_by_symbol(const char *sym) const {
 }
 
 bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
-    if (!plugin || !inst) {
+    if (!plugin || (!inst && !(remote && remote->is_ready()))) {
         return false;
     }
+    if (remote) {
+        remote->reset_arena();
+    }
 
     const uint32_t min_header = (uint32_t)(sizeof(LV2_Atom) + sizeof(LV2_Atom_Sequence_Body));
     if (seq_capacity_hint < min_header) {
@@ -436,7 +656,9 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
                 }
             }
             port_buffers[i] = new float(def);
-            lilv_instance_connect_port(inst, i, port_buffers[i]);
+            if (inst) {
+                lilv_instance_connect_port(inst, i, port_buffers[i]);
+            }
             control_scalar_ports.push_back(i);
             if (d) {
                 lilv_node_free(d);
@@ -575,9 +797,25 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
         }
     }
 
-    // create midi buffers
+    // create midi buffers, writers are kept out while the input rings are replaced
+    input_write_mutex.lock();
     midi_input_buffer.resize(atom_inputs.size());
+    input_write_mutex.unlock();
     midi_output_buffer.resize(atom_outputs.size());
+    midi_input_events.resize(atom_inputs.size());
+    // a block drains at most what its ring holds plus the queue, however long the block is
+    for (size_t i = 0; i < midi_input_events.size(); i++) {
+        midi_input_events[i].reserve(midi_input_buffer[i].get_capacity() / MidiEvent::RING_SIZE + MIDI_QUEUE_SIZE);
+    }
+    queued_midi_events.resize(atom_inputs.size());
+    for (auto &events : queued_midi_events) {
+        events.clear();
+        events.reserve(MIDI_QUEUE_SIZE);
+    }
+    control_events.reserve(control_input_buffer.get_capacity() / ControlEvent::DATA_SIZE + CONTROL_QUEUE_SIZE);
+    queued_control_events.reserve(CONTROL_QUEUE_SIZE);
+    frame_ports.clear();
+    connected_offset = 0;
 
     // audio buffers
     channels = std::max(num_audio_out, num_audio_in);
@@ -605,6 +843,8 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
 
     audio_in_ptrs.assign(num_audio_in, nullptr);
     audio_out_ptrs.assign(num_audio_out, nullptr);
+    audio_in_ports.assign(num_audio_in, 0);
+    audio_out_ports.assign(num_audio_out, 0);
 
     // CV heap
     cv_heap.assign(num_ports, nullptr);
@@ -621,9 +861,13 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
         if (is_audio && is_input) {
             float *buf = (channels ? audio_ptrs[std::min(in_idx, channels - 1)] : nullptr);
             port_buffers[i] = buf;
-            lilv_instance_connect_port(inst, i, buf);
+            if (inst) {
+                lilv_instance_connect_port(inst, i, buf);
+            }
+            frame_ports.push_back(i);
             if (in_idx < audio_in_ptrs.size()) {
                 audio_in_ptrs[in_idx] = buf;
+                audio_in_ports[in_idx] = i;
             }
             ++in_idx;
             continue;
@@ -631,9 +875,13 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
         if (is_audio && is_output) {
             float *buf = (channels ? audio_ptrs[std::min(out_idx, channels - 1)] : nullptr);
             port_buffers[i] = buf;
-            lilv_instance_connect_port(inst, i, buf);
+            if (inst) {
+                lilv_instance_connect_port(inst, i, buf);
+            }
+            frame_ports.push_back(i);
             if (out_idx < audio_out_ptrs.size()) {
                 audio_out_ptrs[out_idx] = buf;
+                audio_out_ports[out_idx] = i;
             }
             ++out_idx;
             continue;
@@ -653,22 +901,32 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
 #endif
             cv_heap[i] = buf;
             port_buffers[i] = buf;
-            lilv_instance_connect_port(inst, i, buf);
+            if (inst) {
+                lilv_instance_connect_port(inst, i, buf);
+            }
+            frame_ports.push_back(i);
             continue;
         }
 
         for (auto &a : atom_inputs) {
-            if (a.index == i) {
+            if (inst && a.index == i) {
                 lilv_instance_connect_port(inst, i, a.seq);
             }
         }
         for (auto &o : atom_outputs) {
-            if (o.index == i) {
+            if (inst && o.index == i) {
                 lilv_instance_connect_port(inst, i, o.seq);
             }
         }
     }
 
+    // frame ports start out on the internal buffers
+    port_bindings.assign(num_ports, PortBinding{});
+    for (uint32_t index : frame_ports) {
+        port_bindings[index].first = port_buffers[index];
+    }
+    bindings_dirty = false;
+
     for (int i = 0; i < num_ports; i++) {
         const LilvPort *port = lilv_plugin_get_port_by_index(plugin, i);
         bool is_control = lilv_port_is_a(plugin, port, CONTROL);
@@ -803,12 +1061,20 @@ bool Lv2Host::prepare_ports_and_buffers(int p_frames) {
 }
 
 void Lv2Host::activate() {
+    if (remote) {
+        remote->command(LV2_REMOTE_COMMAND_ACTIVATE, nullptr, nullptr);
+        return;
+    }
     if (inst) {
         lilv_instance_activate(inst);
     }
 }
 
 void Lv2Host::deactivate() {
+    if (remote) {
+        remote->command(LV2_REMOTE_COMMAND_DEACTIVATE, nullptr, nullptr);
+        return;
+    }
     if (inst) {
         lilv_instance_deactivate(inst);
     }
@@ -850,6 +1116,14 @@ std::vector<std::string> Lv2Host::get_presets() {
 }
 
 void Lv2Host::load_preset(std::string preset) {
+    if (remote) {
+        std::vector<uint8_t> label(preset.begin(), preset.end());
+        std::vector<float> values;
+        if (remote->command(LV2_REMOTE_COMMAND_LOAD_PRESET, &label, nullptr, &values)) {
+            sync_remote_controls(values);
+        }
+        return;
+    }
     if (plugin) {
         LilvNodes *presets = lilv_plugin_get_related(plugin, PRESETS);
 
@@ -878,13 +1152,638 @@ void Lv2Host::load_preset(std::string preset) {
     }
 }
 
+void Lv2Host::set_state_dir(const std::string &p_dir) {
+    state_dir = p_dir;
+}
+
+const std::string &Lv2Host::get_state_dir() const {
+    return state_dir;
+}
+
+bool Lv2Host::has_thread_safe_restore() const {
+    return thread_safe_restore;
+}
+
+bool Lv2Host::save_state(std::vector<uint8_t> &r_blob) {
+    if (remote) {
+        return remote->command(LV2_REMOTE_COMMAND_SAVE_STATE, nullptr, &r_blob);
+    }
+    if (!plugin || !inst) {
+        return false;
+    }
+
+    std::vector<StateProperty> properties;
+    if (state_iface && state_iface->save) {
+        StateContext context{this, &properties};
+        LV2_State_Status status =
+            state_iface->save(lilv_instance_get_handle(inst), &Lv2Host::s_state_store, &context,
+                              LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE, features);
+        if (status != LV2_STATE_SUCCESS) {
+            return false;
+        }
+    }
+
+    r_blob.clear();
+    StateWriter writer{r_blob};
+    writer.bytes(kStateMagic, sizeof(kStateMagic));
+    writer.u32(kStateVersion);
+    writer.str(lilv_node_as_uri(lilv_plugin_get_uri(plugin)));
+
+    writer.u32((uint32_t)control_inputs.size());
+    for (const LilvControl &control : control_inputs) {
+        writer.str(control.symbol);
+        writer.f32(*port_buffers[control.index]);
+    }
+
+    writer.u32((uint32_t)properties.size());
+    for (const StateProperty &property : properties) {
+        writer.str(to_string_safe(s_unmap_cb(this, property.key)));
+        writer.str(to_string_safe(s_unmap_cb(this, property.type)));
+        writer.u32(property.flags);
+        writer.u32((uint32_t)property.value.size());
+        writer.bytes(property.value.data(), property.value.size());
+    }
+
+    return true;
+}
+
+bool Lv2Host::parse_state(const std::vector<uint8_t> &p_blob, std::vector<std::pair<std::string, float>> &r_controls,
+                          std::vector<StateProperty> &r_properties) {
+    if (!plugin) {
+        return false;
+    }
+
+    StateReader reader{p_blob};
+    uint8_t magic[sizeof(kStateMagic)];
+    uint32_t version = 0;
+    std::string uri;
+
+    if (!reader.bytes(magic, sizeof(magic)) || std::memcmp(magic, kStateMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+    if (!reader.u32(version) || version != kStateVersion || !reader.str(uri)) {
+        return false;
+    }
+    if (uri != lilv_node_as_uri(lilv_plugin_get_uri(plugin))) {
+        return false;
+    }
+
+    uint32_t control_count = 0;
+    if (!reader.u32(control_count)) {
+        return false;
+    }
+    r_controls.clear();
+    for (uint32_t i = 0; i < control_count; ++i) {
+        std::string symbol;
+        float value = 0.0f;
+        if (!reader.str(symbol) || !reader.f32(value)) {
+            return false;
+        }
+        r_controls.emplace_back(symbol, value);
+    }
+
+    uint32_t property_count = 0;
+    if (!reader.u32(property_count)) {
+        return false;
+    }
+    r_properties.clear();
+    for (uint32_t i = 0; i < property_count; ++i) {
+        std::string key, type;
+        uint32_t size = 0;
+        StateProperty property{};
+        if (!reader.str(key) || !reader.str(type) || !reader.u32(property.flags) || !reader.u32(size)) {
+            return false;
+        }
+        property.value.resize(size);
+        if (!reader.bytes(property.value.data(), size)) {
+            return false;
+        }
+        property.key = map_uri(key.c_str());
+        property.type = map_uri(type.c_str());
+        r_properties.push_back(std::move(property));
+    }
+
+    return reader.pos == p_blob.size();
+}
+
+bool Lv2Host::prepare_state(const std::vector<uint8_t> &p_blob, ParsedState &r_state) {
+    std::vector<std::pair<std::string, float>> controls;
+    if (!parse_state(p_blob, controls, r_state.properties)) {
+        return false;
+    }
+
+    // resolved here so applying the state is plain stores
+    r_state.controls.clear();
+    for (const auto &control : controls) {
+        const uint32_t port_index = lookup_port_index_by_symbol(control.first.c_str());
+        if (port_index == UINT32_MAX) {
+            continue;
+        }
+        if (!lilv_port_is_a(plugin, lilv_plugin_get_port_by_index(plugin, port_index), CONTROL)) {
+            continue;
+        }
+        r_state.controls.emplace_back(port_index, control.second);
+    }
+
+    return true;
+}
+
+bool Lv2Host::apply_state(ParsedState &p_state) {
+    if (!inst) {
+        return false;
+    }
+
+    for (const auto &control : p_state.controls) {
+        if (control.first < port_buffers.size() && port_buffers[control.first]) {
+            *port_buffers[control.first] = control.second;
+        }
+    }
+
+    if (p_state.restore_properties && state_iface && state_iface->restore) {
+        StateContext context{this, &p_state.properties};
+        LV2_State_Status status =
+            state_iface->restore(lilv_instance_get_handle(inst), &Lv2Host::s_state_retrieve, &context, 0, features);
+        if (status != LV2_STATE_SUCCESS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Lv2Host::restore_state(const std::vector<uint8_t> &p_blob) {
+    if (remote) {
+        std::vector<float> values;
+        if (!remote->command(LV2_REMOTE_COMMAND_RESTORE_STATE, &p_blob, nullptr, &values)) {
+            return false;
+        }
+        sync_remote_controls(values);
+        return true;
+    }
+    if (!inst) {
+        return false;
+    }
+
+    ParsedState state;
+    return prepare_state(p_blob, state) && apply_state(state);
+}
+
+bool Lv2Host::queue_restore_state(const std::vector<uint8_t> &p_blob) {
+    if (remote) {
+        // the child restores between its own blocks
+        return restore_state(p_blob);
+    }
+    if (!inst) {
+        return false;
+    }
+
+    std::unique_ptr<ParsedState> state = std::make_unique<ParsedState>();
+    if (!prepare_state(p_blob, *state)) {
+        return false;
+    }
+
+    if (thread_safe_restore) {
+        ParsedState properties;
+        properties.properties = std::move(state->properties);
+        if (!apply_state(properties)) {
+            return false;
+        }
+        state->restore_properties = false;
+    }
+
+    // a restore that was never picked up is superseded
+    std::lock_guard<std::mutex> guard(restore_mutex);
+    pending_restore = std::move(state);
+    restore_pending.store(true, std::memory_order_release);
+    return true;
+}
+
+bool Lv2Host::has_pending_restore() const {
+    return restore_pending.load(std::memory_order_acquire);
+}
+
+bool Lv2Host::apply_pending_restore() {
+    if (!restore_pending.load(std::memory_order_acquire)) {
+        return true;
+    }
+
+    // only held by the caller to swap the pointer; if it is, the newer state is picked up before the next block
+    std::unique_lock<std::mutex> guard(restore_mutex, std::try_to_lock);
+    if (!guard.owns_lock()) {
+        return true;
+    }
+
+    restore_pending.store(false, std::memory_order_relaxed);
+    return apply_state(*pending_restore);
+}
+
 int Lv2Host::perform(int p_frames) {
+    if (remote) {
+        perform_remote(p_frames);
+        return p_frames;
+    }
     if (!inst) {
         return p_frames;
     }
 
     rt_deliver_worker_responses();
 
+    const auto block_start = std::chrono::steady_clock::now();
+
+    if (bindings_dirty) {
+        connect_frame_ports(0);
+        bindings_dirty = false;
+    }
+
+    // 1) Drain MIDI input rings, kept per bus so each sub-block forges only its own events
+    for (int i = 0; i < atom_inputs.size(); i++) {
+        std::vector<MidiEvent> &events = midi_input_events[i];
+        events.clear();
+
+        MidiEvent midi_event{};
+        while (read_midi_in(i, midi_event)) {
+            midi_event.frame = std::min(std::max(midi_event.frame, 0), p_frames - 1);
+            events.push_back(midi_event);
+        }
+        for (MidiEvent &queued_event : queued_midi_events[i]) {
+            queued_event.frame = std::min(std::max(queued_event.frame, 0), p_frames - 1);
+            events.push_back(queued_event);
+        }
+        queued_midi_events[i].clear();
+        if (pending_notes_off) {
+            for (uint8_t channel = 0; channel < 16; channel++) {
+                MidiEvent notes_off{};
+                notes_off.data[0] = LV2_MIDI_MSG_CONTROLLER | channel;
+                notes_off.data[1] = LV2_MIDI_CTL_ALL_NOTES_OFF;
+                notes_off.data[2] = 0;
+                events.push_back(notes_off);
+            }
+        }
+        sort_by_frame(events);
+        if (midi_map != nullptr) {
+            // mapped CCs join the control changes drained below, at the frame they arrived
+            for (const MidiEvent &event : events) {
+                midi_map->process(event, this);
+            }
+        }
+    }
+    pending_notes_off = false;
+
+    // 2) Drain timestamped control changes
+    control_events.clear();
+    ControlEvent control_event{};
+    while (read_control_in(control_event)) {
+        control_event.frame = std::min(std::max(control_event.frame, 0), p_frames - 1);
+        control_events.push_back(control_event);
+    }
+    for (ControlEvent &queued_event : queued_control_events) {
+        queued_event.frame = std::min(std::max(queued_event.frame, 0), p_frames - 1);
+        control_events.push_back(queued_event);
+    }
+    queued_control_events.clear();
+    sort_by_frame(control_events);
+
+    // 3) Run DSP, split at control timestamps but never into sub-blocks shorter than min_sub_block
+    //    (late changes are quantized forward instead)
+    const int min_frames = (int)std::max<uint32_t>(min_sub_block.load(std::memory_order_relaxed), 1u);
+    double run_usec = 0.0;
+    uint32_t sub_runs = 0;
+    size_t next_event = 0;
+    int offset = 0;
+
+    while (offset < p_frames) {
+        while (next_event < control_events.size() && control_events[next_event].frame <= offset) {
+            apply_control_event(control_events[next_event++]);
+        }
+
+        int end = p_frames;
+        if (next_event < control_events.size()) {
+            end = std::max(control_events[next_event].frame, offset + min_frames);
+            if (p_frames - end < min_frames) {
+                end = p_frames;
+            }
+        }
+
+        // a bound buffer that wraps can't be handed to the plugin as one pointer, always split there
+        end = next_binding_split(offset, end);
+
+        run_usec += run_sub_block(offset, end - offset);
+        ++sub_runs;
+        offset = end;
+    }
+
+    // events quantized past the end of the block take effect from the next block
+    while (next_event < control_events.size()) {
+        apply_control_event(control_events[next_event++]);
+    }
+
+    if (connected_offset != 0) {
+        connect_frame_ports(0);
+    }
+
+    sub_block_stats.sub_runs = sub_runs;
+    sub_block_stats.run_usec = run_usec;
+    sub_block_stats.overhead_usec = std::max(elapsed_usec(block_start) - run_usec, 0.0);
+    sub_block_stats.max_overhead_usec = std::max(sub_block_stats.max_overhead_usec, sub_block_stats.overhead_usec);
+
+    // 4) Non-RT worker requests
+    non_rt_do_worker_requests();
+
+    return p_frames;
+}
+
+void Lv2Host::perform_remote(int p_frames) {
+    Lv2RemoteShared *shared = remote->get_shared();
+    const int frames = std::min(std::max(p_frames, 0), (int)REMOTE_MAX_BLOCK);
+    const int inputs = (int)std::min<size_t>(audio_in_ports.size(), REMOTE_MAX_CHANNELS);
+    const int outputs = (int)std::min<size_t>(audio_out_ports.size(), REMOTE_MAX_CHANNELS);
+
+    if (!remote->is_ready()) {
+        // the child is being restarted: the block is lost, keep the queues drained and the outputs quiet
+        for (int c = 0; c < outputs; c++) {
+            scatter_binding(port_bindings[audio_out_ports[c]], nullptr, frames);
+        }
+        skip(frames);
+        pending_notes_off = false;
+        return;
+    }
+
+    // 1) MIDI input, the child clamps the frames to the block
+    uint32_t midi_count = 0;
+    MidiEvent midi_event{};
+    auto forward_midi = [&](int p_bus, const MidiEvent &p_event) {
+        if (midi_map != nullptr) {
+            midi_map->process(p_event, this);
+        }
+        if (midi_count < REMOTE_MAX_EVENTS) {
+            Lv2RemoteMidiEvent &remote_event = shared->midi_in[midi_count++];
+            remote_event.bus = (uint32_t)p_bus;
+            remote_event.frame = p_event.frame;
+            remote_event.size = (uint32_t)p_event.size;
+            std::memcpy(remote_event.data, p_event.data, MidiEvent::DATA_SIZE);
+        }
+    };
+    for (int bus = 0; bus < (int)midi_input_buffer.size(); bus++) {
+        while (read_midi_in(bus, midi_event)) {
+            forward_midi(bus, midi_event);
+        }
+        for (const MidiEvent &queued_event : queued_midi_events[bus]) {
+            forward_midi(bus, queued_event);
+        }
+        queued_midi_events[bus].clear();
+    }
+    shared->midi_in_count = midi_count;
+    shared->notes_off = pending_notes_off ? 1 : 0;
+    pending_notes_off = false;
+
+    // 2) control values as of the start of the block, then the timestamped changes; those are also applied here
+    //    so get_input_control_value() stays current
+    const uint32_t control_count = std::min<uint32_t>((uint32_t)control_inputs.size(), REMOTE_MAX_CONTROLS);
+    for (uint32_t i = 0; i < control_count; i++) {
+        shared->control_in[i] = *port_buffers[control_inputs[i].index];
+    }
+    shared->control_in_count = control_count;
+
+    uint32_t event_count = 0;
+    auto post_control_event = [&](const ControlEvent &p_event) {
+        if (event_count < REMOTE_MAX_EVENTS) {
+            Lv2RemoteControlEvent &remote_event = shared->control_events[event_count++];
+            remote_event.frame = p_event.frame;
+            remote_event.index = p_event.index;
+            remote_event.value = p_event.value;
+        }
+        apply_control_event(p_event);
+    };
+    ControlEvent control_event{};
+    while (read_control_in(control_event)) {
+        post_control_event(control_event);
+    }
+    for (const ControlEvent &queued_event : queued_control_events) {
+        post_control_event(queued_event);
+    }
+    queued_control_events.clear();
+    shared->control_event_count = event_count;
+
+    // 3) audio: bindings inside the shared segment go over as offsets, anything else through scratch
+    bool direct_outputs[REMOTE_MAX_CHANNELS];
+    for (int c = 0; c < inputs; c++) {
+        bind_remote_channel(shared->audio_in[c], audio_in_ports[c], (uint32_t)c, frames, true);
+    }
+    for (int c = 0; c < outputs; c++) {
+        direct_outputs[c] =
+            bind_remote_channel(shared->audio_out[c], audio_out_ports[c], REMOTE_MAX_CHANNELS + c, frames, false);
+    }
+    shared->frames = (uint32_t)frames;
+    shared->min_sub_block = min_sub_block.load(std::memory_order_relaxed);
+
+    const auto block_start = std::chrono::steady_clock::now();
+    const bool done = remote->run_block();
+    const double round_trip_usec = elapsed_usec(block_start);
+
+    for (int c = 0; c < outputs; c++) {
+        const PortBinding &binding = port_bindings[audio_out_ports[c]];
+        if (!done) {
+            scatter_binding(binding, nullptr, frames);
+        } else if (!direct_outputs[c]) {
+            scatter_binding(binding, remote->get_scratch(REMOTE_MAX_CHANNELS + c), frames);
+        }
+    }
+    if (!done) {
+        return;
+    }
+
+    // 4) what the plugin sent back
+    const uint32_t midi_out_count = std::min(shared->midi_out_count, REMOTE_MAX_EVENTS);
+    for (uint32_t i = 0; i < midi_out_count; i++) {
+        const Lv2RemoteMidiEvent &remote_event = shared->midi_out[i];
+        midi_event.frame = remote_event.frame;
+        midi_event.size = (int)std::min<uint32_t>(remote_event.size, MidiEvent::DATA_SIZE);
+        std::memcpy(midi_event.data, remote_event.data, MidiEvent::DATA_SIZE);
+        write_midi_out((int)remote_event.bus, midi_event);
+    }
+    const uint32_t control_out_count =
+        std::min<uint32_t>(std::min(shared->control_out_count, REMOTE_MAX_CONTROLS), (uint32_t)control_outputs.size());
+    for (uint32_t i = 0; i < control_out_count; i++) {
+        *port_buffers[control_outputs[i].index] = shared->control_out[i];
+    }
+
+    // the child's run time isn't visible from here, the whole round trip counts as run time
+    sub_block_stats.sub_runs = 1;
+    sub_block_stats.run_usec = round_trip_usec;
+    sub_block_stats.overhead_usec = 0.0;
+}
+
+bool Lv2Host::bind_remote_channel(Lv2RemoteBinding &r_binding, uint32_t p_port, uint32_t p_slot, int p_frames,
+                                  bool p_input) {
+    const PortBinding &binding = port_bindings[p_port];
+    const uint32_t first_frames = std::min<uint32_t>(binding.first_frames, (uint32_t)p_frames);
+
+    uint64_t first = 0;
+    uint64_t second = REMOTE_NO_SECOND;
+    if (remote->arena_offset(binding.first, first_frames, first) &&
+        (first_frames == (uint32_t)p_frames ||
+         remote->arena_offset(binding.second, p_frames - first_frames, second))) {
+        r_binding.first = first;
+        r_binding.first_frames = first_frames;
+        r_binding.second = second;
+        return true;
+    }
+
+    float *scratch = remote->get_scratch(p_slot);
+    if (p_input) {
+        gather_binding(binding, scratch, p_frames);
+    }
+    remote->arena_offset(scratch, p_frames, first);
+    r_binding.first = first;
+    r_binding.first_frames = (uint32_t)p_frames;
+    r_binding.second = REMOTE_NO_SECOND;
+    return false;
+}
+
+void Lv2Host::sync_remote_controls(const std::vector<float> &p_values) {
+    const size_t count = std::min(p_values.size(), control_inputs.size());
+    for (size_t i = 0; i < count; i++) {
+        *port_buffers[control_inputs[i].index] = p_values[i];
+    }
+}
+
+void Lv2Host::set_remote_executable(const std::string &p_executable, const std::string &p_lv2_path) {
+    remote_executable = p_executable;
+    remote_lv2_path = p_lv2_path;
+}
+
+void Lv2Host::set_remote_realtime(uint32_t p_policy, int p_priority) {
+    remote_realtime_policy = p_policy;
+    remote_realtime_priority = p_priority;
+    if (remote) {
+        remote->set_realtime(p_policy, p_priority);
+    }
+}
+
+void Lv2Host::set_remote_timeout_usec(uint64_t p_usec) {
+    remote_timeout_usec = p_usec;
+    if (remote) {
+        remote->set_timeout_usec(p_usec);
+    }
+}
+
+void Lv2Host::set_remote_snapshot_interval_ms(int p_ms) {
+    remote_snapshot_interval_ms = p_ms;
+    if (remote) {
+        remote->set_snapshot_interval_ms(p_ms);
+    }
+}
+
+bool Lv2Host::is_remote() const {
+    return remote != nullptr;
+}
+
+float *Lv2Host::allocate_shared_frames(size_t p_count) {
+    return remote ? remote->allocate_frames(p_count) : nullptr;
+}
+
+uint32_t Lv2Host::get_remote_restarts() const {
+    return remote ? remote->get_restarts() : 0;
+}
+
+Lv2RemoteStats Lv2Host::get_remote_stats() {
+    return remote ? remote->get_stats() : Lv2RemoteStats();
+}
+
+void Lv2Host::skip(int p_frames) {
+    (void)p_frames;
+
+    // the plugin doesn't hear the MIDI, but mapped controls still follow it
+    MidiEvent midi_event{};
+    for (int i = 0; i < midi_input_buffer.size(); i++) {
+        while (read_midi_in(i, midi_event)) {
+            if (midi_map != nullptr) {
+                midi_map->process(midi_event, this);
+            }
+        }
+        if (midi_map != nullptr) {
+            for (const MidiEvent &queued_event : queued_midi_events[i]) {
+                midi_map->process(queued_event, this);
+            }
+        }
+        queued_midi_events[i].clear();
+    }
+
+    ControlEvent control_event{};
+    while (read_control_in(control_event)) {
+        apply_control_event(control_event);
+    }
+    for (const ControlEvent &queued_event : queued_control_events) {
+        apply_control_event(queued_event);
+    }
+    queued_control_events.clear();
+}
+
+bool Lv2Host::has_pending_events() const {
+    for (const Lv2CircularBuffer<int> &ring : midi_input_buffer) {
+        if (ring.get_available() > 0) {
+            return true;
+        }
+    }
+    for (const std::vector<MidiEvent> &events : queued_midi_events) {
+        if (!events.empty()) {
+            return true;
+        }
+    }
+    return control_input_buffer.get_available() > 0 || !queued_control_events.empty();
+}
+
+void Lv2Host::release_notes() {
+    pending_notes_off = true;
+}
+
+void Lv2Host::connect_frame_ports(uint32_t p_offset) {
+    for (uint32_t index : frame_ports) {
+        const PortBinding &binding = port_bindings[index];
+        float *buffer = p_offset < binding.first_frames ? binding.first + p_offset
+                                                        : binding.second + (p_offset - binding.first_frames);
+        lilv_instance_connect_port(inst, index, buffer);
+    }
+    connected_offset = p_offset;
+}
+
+void Lv2Host::bind_frame_port(uint32_t p_port, float *p_first, int p_first_frames, float *p_second) {
+    PortBinding &binding = port_bindings[p_port];
+    binding.first = p_first;
+    binding.first_frames = p_second != nullptr ? (uint32_t)p_first_frames : UINT32_MAX;
+    binding.second = p_second;
+    bindings_dirty = true;
+}
+
+int Lv2Host::next_binding_split(int p_offset, int p_end) const {
+    int end = p_end;
+    for (uint32_t port : audio_in_ports) {
+        const uint32_t split = port_bindings[port].first_frames;
+        if (split > (uint32_t)p_offset && split < (uint32_t)end) {
+            end = (int)split;
+        }
+    }
+    for (uint32_t port : audio_out_ports) {
+        const uint32_t split = port_bindings[port].first_frames;
+        if (split > (uint32_t)p_offset && split < (uint32_t)end) {
+            end = (int)split;
+        }
+    }
+    return end;
+}
+
+void Lv2Host::apply_control_event(const ControlEvent &p_event) {
+    if (p_event.index < control_inputs.size()) {
+        *port_buffers[control_inputs[p_event.index].index] = p_event.value;
+    }
+}
+
+double Lv2Host::run_sub_block(int p_offset, int p_frames) {
+    if ((uint32_t)p_offset != connected_offset) {
+        connect_frame_ports(p_offset);
+    }
+
+    // a) Forge MIDI input events that fall inside this sub-block, relative to its start
     for (int i = 0; i < atom_inputs.size(); i++) {
         AtomIn &atom_input = atom_inputs[i];
 
@@ -897,10 +1796,11 @@ int Lv2Host::perform(int p_frames) {
         LV2_Atom_Forge_Frame seq_frame;
         lv2_atom_forge_sequence_head(&atom_input.forge, &seq_frame, urids.atom_FrameTime);
 
-        MidiEvent midi_event{};
-
-        while (read_midi_in(i, midi_event)) {
-            lv2_atom_forge_frame_time(&atom_input.forge, midi_event.frame);
+        for (const MidiEvent &midi_event : midi_input_events[i]) {
+            if (midi_event.frame < p_offset || midi_event.frame >= p_offset + p_frames) {
+                continue;
+            }
+            lv2_atom_forge_frame_time(&atom_input.forge, midi_event.frame - p_offset);
             lv2_atom_forge_atom(&atom_input.forge, midi_event.size, urids.midi_MidiEvent);
             lv2_atom_forge_write(&atom_input.forge, midi_event.data, midi_event.size);
         }
@@ -910,7 +1810,7 @@ int Lv2Host::perform(int p_frames) {
         atom_input.seq = reinterpret_cast<LV2_Atom_Sequence *>(atom_input.buf.data());
     }
 
-    // 3) Prepare Atom OUTPUTS: mark empty for this block
+    // b) Prepare Atom OUTPUTS: mark empty for this sub-block
     for (auto &atom_output : atom_outputs) {
         if (!atom_output.midi) {
             continue;
@@ -929,11 +1829,13 @@ int Lv2Host::perform(int p_frames) {
         body->pad = 0;
     }
 
-    // 4) Run DSP for this block
+    // c) Run DSP for this sub-block
+    const auto run_start = std::chrono::steady_clock::now();
     lilv_instance_run(inst, p_frames);
+    const double run_usec = elapsed_usec(run_start);
 
     // TODO: reading is not working right now... or is it?
-    //  5) Collect OUTPUT events → ABSOLUTE time → out ring
+    //  d) Collect OUTPUT events → ABSOLUTE time → out ring
     for (int i = 0; i < atom_outputs.size(); i++) {
         AtomOut &atom_output = atom_outputs[i];
 
@@ -955,7 +1857,7 @@ int Lv2Host::perform(int p_frames) {
                 continue;
             }
             MidiEvent midi_event{};
-            midi_event.frame = ev->time.frames;
+            midi_event.frame = (int)ev->time.frames + p_offset;
             midi_event.size = std::min<uint32_t>(ev->body.size, 3u);
             for (uint32_t j = 0; j < midi_event.size; ++j) {
                 midi_event.data[j] = body[j];
@@ -964,10 +1866,7 @@ int Lv2Host::perform(int p_frames) {
         }
     }
 
-    // 6) Non-RT worker requests
-    non_rt_do_worker_requests();
-
-    return p_frames;
+    return run_usec;
 }
 
 int Lv2Host::get_input_channel_count() {
@@ -1003,18 +1902,81 @@ float *Lv2Host::get_output_channel_buffer(int p_channel) {
     return audio_out_ptrs[p_channel];
 }
 
+void Lv2Host::bind_input_channel(int p_channel, float *p_first, int p_first_frames, float *p_second) {
+    if (p_channel < 0 || p_channel >= (int)audio_in_ports.size()) {
+        return;
+    }
+    bind_frame_port(audio_in_ports[p_channel], p_first, p_first_frames, p_second);
+}
+
+void Lv2Host::bind_output_channel(int p_channel, float *p_first, int p_first_frames, float *p_second) {
+    if (p_channel < 0 || p_channel >= (int)audio_out_ports.size()) {
+        return;
+    }
+    bind_frame_port(audio_out_ports[p_channel], p_first, p_first_frames, p_second);
+}
+
+void Lv2Host::unbind_channels() {
+    for (uint32_t port : audio_in_ports) {
+        bind_frame_port(port, port_buffers[port], 0, nullptr);
+    }
+    for (uint32_t port : audio_out_ports) {
+        bind_frame_port(port, port_buffers[port], 0, nullptr);
+    }
+}
+
 void Lv2Host::write_midi_in(int p_bus, const MidiEvent &p_midi_event) {
+    std::lock_guard<std::mutex> guard(input_write_mutex);
     if (p_bus >= midi_input_buffer.size()) {
         return;
     }
 
-    int event[MidiEvent::DATA_SIZE];
+    int event[MidiEvent::RING_SIZE];
 
+    event[0] = p_midi_event.frame;
+    event[1] = p_midi_event.size;
     for (int i = 0; i < MidiEvent::DATA_SIZE; i++) {
-        event[i] = p_midi_event.data[i];
+        event[i + 2] = p_midi_event.data[i];
     }
 
-    midi_input_buffer[p_bus].write_channel(event, MidiEvent::DATA_SIZE);
+    midi_input_buffer[p_bus].write_channel(event, MidiEvent::RING_SIZE);
+}
+
+int Lv2Host::write_midi_in_batch(int p_bus, const MidiEvent *p_events, int p_count) {
+    std::lock_guard<std::mutex> guard(input_write_mutex);
+    if (p_bus < 0 || p_bus >= midi_input_buffer.size() || p_count <= 0) {
+        return 0;
+    }
+
+    // unlike write_midi_in, a batch never overwrites events the DSP thread hasn't read yet
+    Lv2CircularBuffer<int> &ring = midi_input_buffer[p_bus];
+    const int free = ring.get_capacity() - 1 - ring.get_available();
+    const int count = std::min(p_count, free / (int)MidiEvent::RING_SIZE);
+    if (count <= 0) {
+        return 0;
+    }
+
+    Lv2RingSpan<int> span = ring.reserve(count * MidiEvent::RING_SIZE);
+    int index = 0;
+    for (int i = 0; i < count; i++) {
+        const MidiEvent &midi_event = p_events[i];
+        int event[MidiEvent::RING_SIZE];
+        event[0] = midi_event.frame;
+        event[1] = midi_event.size;
+        for (int j = 0; j < MidiEvent::DATA_SIZE; j++) {
+            event[j + 2] = midi_event.data[j];
+        }
+        for (int j = 0; j < MidiEvent::RING_SIZE; j++, index++) {
+            if (index < span.first_frames) {
+                span.first[index] = event[j];
+            } else {
+                span.second[index - span.first_frames] = event[j];
+            }
+        }
+    }
+    ring.commit(count * MidiEvent::RING_SIZE);
+
+    return count;
 }
 
 bool Lv2Host::read_midi_in(int p_bus, MidiEvent &p_midi_event) {
@@ -1022,14 +1984,16 @@ bool Lv2Host::read_midi_in(int p_bus, MidiEvent &p_midi_event) {
         return 0;
     }
 
-    int event[MidiEvent::DATA_SIZE];
-    int read = midi_input_buffer[p_bus].read_channel(event, MidiEvent::DATA_SIZE);
+    int event[MidiEvent::RING_SIZE];
+    int read = midi_input_buffer[p_bus].read_channel(event, MidiEvent::RING_SIZE);
 
-    if (read == MidiEvent::DATA_SIZE) {
+    if (read == MidiEvent::RING_SIZE) {
+        p_midi_event.frame = event[0];
+        p_midi_event.size = std::min<int>(event[1], MidiEvent::DATA_SIZE);
         for (int i = 0; i < MidiEvent::DATA_SIZE; i++) {
-            p_midi_event.data[i] = event[i];
+            p_midi_event.data[i] = event[i + 2];
         }
-        midi_input_buffer[p_bus].update_read_index(MidiEvent::DATA_SIZE);
+        midi_input_buffer[p_bus].update_read_index(MidiEvent::RING_SIZE);
     }
 
     return read > 0;
@@ -1040,13 +2004,15 @@ void Lv2Host::write_midi_out(int p_bus, const MidiEvent &p_midi_event) {
         return;
     }
 
-    int event[MidiEvent::DATA_SIZE];
+    int event[MidiEvent::RING_SIZE];
 
+    event[0] = p_midi_event.frame;
+    event[1] = p_midi_event.size;
     for (int i = 0; i < MidiEvent::DATA_SIZE; i++) {
-        event[i] = p_midi_event.data[i];
+        event[i + 2] = p_midi_event.data[i];
     }
 
-    midi_output_buffer[p_bus].write_channel(event, MidiEvent::DATA_SIZE);
+    midi_output_buffer[p_bus].write_channel(event, MidiEvent::RING_SIZE);
 }
 
 bool Lv2Host::read_midi_out(int p_bus, MidiEvent &p_midi_event) {
@@ -1054,20 +2020,115 @@ bool Lv2Host::read_midi_out(int p_bus, MidiEvent &p_midi_event) {
         return 0;
     }
 
-    int event[MidiEvent::DATA_SIZE];
-    int read = midi_output_buffer[p_bus].read_channel(event, MidiEvent::DATA_SIZE);
+    int event[MidiEvent::RING_SIZE];
+    int read = midi_output_buffer[p_bus].read_channel(event, MidiEvent::RING_SIZE);
 
-    if (read == MidiEvent::DATA_SIZE) {
+    if (read == MidiEvent::RING_SIZE) {
+        p_midi_event.frame = event[0];
+        p_midi_event.size = std::min<int>(event[1], MidiEvent::DATA_SIZE);
         for (int i = 0; i < MidiEvent::DATA_SIZE; i++) {
-            p_midi_event.data[i] = event[i];
+            p_midi_event.data[i] = event[i + 2];
         }
     }
 
-    midi_output_buffer[p_bus].update_read_index(MidiEvent::DATA_SIZE);
+    midi_output_buffer[p_bus].update_read_index(MidiEvent::RING_SIZE);
 
     return read > 0;
 }
 
+void Lv2Host::write_control_in(const ControlEvent &p_control_event) {
+    int event[ControlEvent::DATA_SIZE];
+
+    event[0] = p_control_event.frame;
+    event[1] = (int)p_control_event.index;
+    std::memcpy(&event[2], &p_control_event.value, sizeof(float));
+
+    std::lock_guard<std::mutex> guard(input_write_mutex);
+    control_input_buffer.write_channel(event, ControlEvent::DATA_SIZE);
+}
+
+bool Lv2Host::read_control_in(ControlEvent &p_control_event) {
+    int event[ControlEvent::DATA_SIZE];
+    int read = control_input_buffer.read_channel(event, ControlEvent::DATA_SIZE);
+
+    if (read != ControlEvent::DATA_SIZE) {
+        return false;
+    }
+
+    p_control_event.frame = event[0];
+    p_control_event.index = (uint32_t)event[1];
+    std::memcpy(&p_control_event.value, &event[2], sizeof(float));
+    control_input_buffer.update_read_index(ControlEvent::DATA_SIZE);
+
+    return true;
+}
+
+bool Lv2Host::queue_control_event(const ControlEvent &p_control_event) {
+    // producers queue in frame order, so only the tail can hold the same frame
+    for (size_t i = queued_control_events.size(); i > 0; i--) {
+        ControlEvent &queued = queued_control_events[i - 1];
+        if (queued.frame != p_control_event.frame) {
+            break;
+        }
+        if (queued.index == p_control_event.index) {
+            queued.value = p_control_event.value;
+            return true;
+        }
+    }
+
+    if (queued_control_events.size() >= queued_control_events.capacity()) {
+        control_events_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    queued_control_events.push_back(p_control_event);
+    return true;
+}
+
+bool Lv2Host::queue_midi_event(int p_bus, const MidiEvent &p_midi_event) {
+    if (p_bus < 0 || p_bus >= (int)queued_midi_events.size()) {
+        return false;
+    }
+    std::vector<MidiEvent> &events = queued_midi_events[p_bus];
+    if (events.size() >= events.capacity()) {
+        midi_events_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    events.push_back(p_midi_event);
+    return true;
+}
+
+void Lv2Host::reserve_control_events(int p_events) {
+    const size_t queue = CONTROL_QUEUE_SIZE + (size_t)std::max(p_events, 0);
+    queued_control_events.reserve(queue);
+    control_events.reserve(control_input_buffer.get_capacity() / ControlEvent::DATA_SIZE + queue);
+}
+
+uint32_t Lv2Host::get_control_events_dropped() const {
+    return control_events_dropped.load(std::memory_order_relaxed);
+}
+
+uint32_t Lv2Host::get_midi_events_dropped() const {
+    return midi_events_dropped.load(std::memory_order_relaxed);
+}
+
+void Lv2Host::set_min_sub_block(uint32_t p_frames) {
+    min_sub_block.store(std::max<uint32_t>(p_frames, 1u), std::memory_order_relaxed);
+}
+
+void Lv2Host::set_midi_map(Lv2MidiMap *p_map) {
+    midi_map = p_map;
+}
+
+uint32_t Lv2Host::get_min_sub_block() const {
+    return min_sub_block.load(std::memory_order_relaxed);
+}
+
+const SubBlockStats &Lv2Host::get_sub_block_stats() const {
+    return sub_block_stats;
+}
+
 const LilvControl *Lv2Host::get_input_control(int p_index) {
     if (p_index < control_inputs.size()) {
         return &control_inputs[p_index];
@@ -1113,14 +2174,38 @@ void Lv2Host::set_output_control_value(int p_index, float p_value) {
 }
 
 // worker plumbing
+namespace {
+
+const size_t WORKER_ENTRY_HEADER = 8;
+
+size_t worker_entry_bytes(uint32_t p_size) {
+    return (WORKER_ENTRY_HEADER + p_size + 7) & ~(size_t)7;
+}
+
+} // namespace
+
+bool Lv2Host::WorkerQueue::push(uint32_t p_size, const void *p_data) {
+    const size_t bytes = worker_entry_bytes(p_size);
+    if (used + bytes > data.size()) {
+        return false;
+    }
+    std::memcpy(data.data() + used, &p_size, sizeof(p_size));
+    std::memcpy(data.data() + used + WORKER_ENTRY_HEADER, p_data, p_size);
+    used += bytes;
+    return true;
+}
+
 void Lv2Host::rt_deliver_worker_responses() {
     if (!worker.iface || !worker.handle) {
         return;
     }
-    for (auto &r : worker.responses) {
-        worker.iface->work_response(worker.handle, (uint32_t)r.size(), r.data());
+    for (size_t offset = 0; offset < worker.responses.used;) {
+        uint32_t size;
+        std::memcpy(&size, worker.responses.data.data() + offset, sizeof(size));
+        worker.iface->work_response(worker.handle, size, worker.responses.data.data() + offset + WORKER_ENTRY_HEADER);
+        offset += worker_entry_bytes(size);
     }
-    worker.responses.clear();
+    worker.responses.used = 0;
     if (worker.iface->end_run) {
         worker.iface->end_run(worker.handle);
     }
@@ -1129,22 +2214,75 @@ void Lv2Host::non_rt_do_worker_requests() {
     if (!worker.iface || !worker.handle) {
         return;
     }
-    for (auto &q : worker.requests) {
-        worker.iface->work(worker.handle, &Lv2Host::s_worker_respond, &worker, (uint32_t)q.size(), q.data());
+    for (size_t offset = 0; offset < worker.requests.used;) {
+        uint32_t size;
+        std::memcpy(&size, worker.requests.data.data() + offset, sizeof(size));
+        worker.iface->work(worker.handle, &Lv2Host::s_worker_respond, &worker, size,
+                           worker.requests.data.data() + offset + WORKER_ENTRY_HEADER);
+        offset += worker_entry_bytes(size);
     }
-    worker.requests.clear();
+    worker.requests.used = 0;
 }
 LV2_Worker_Status Lv2Host::s_schedule_work(LV2_Worker_Schedule_Handle h, uint32_t size, const void *data) {
     auto *ws = static_cast<WorkerState *>(h);
-    const uint8_t *b = static_cast<const uint8_t *>(data);
-    ws->requests.emplace_back(b, b + size);
-    return LV2_WORKER_SUCCESS;
+    return ws->requests.push(size, data) ? LV2_WORKER_SUCCESS : LV2_WORKER_ERR_NO_SPACE;
 }
 LV2_Worker_Status Lv2Host::s_worker_respond(LV2_Worker_Respond_Handle h, uint32_t size, const void *data) {
     auto *ws = static_cast<WorkerState *>(h);
-    const uint8_t *b = static_cast<const uint8_t *>(data);
-    ws->responses.emplace_back(b, b + size);
-    return LV2_WORKER_SUCCESS;
+    return ws->responses.push(size, data) ? LV2_WORKER_SUCCESS : LV2_WORKER_ERR_NO_SPACE;
+}
+
+void Lv2Host::collect_rt_memory(Lv2MemoryLock &r_lock) {
+    for (uint32_t index : control_scalar_ports) {
+        r_lock.add(port_buffers[index], sizeof(float));
+    }
+    for (float *buffer : cv_heap) {
+        if (buffer) {
+            r_lock.add(buffer, max * sizeof(float));
+        }
+    }
+    for (const std::vector<float> &buffer : audio) {
+        r_lock.add_vector(buffer);
+    }
+    r_lock.add_vector(port_buffers);
+    r_lock.add_vector(port_bindings);
+    r_lock.add_vector(frame_ports);
+
+    for (const AtomIn &atom : atom_inputs) {
+        r_lock.add_vector(atom.buf);
+    }
+    for (const AtomOut &atom : atom_outputs) {
+        r_lock.add_vector(atom.buf);
+    }
+
+    for (Lv2CircularBuffer<int> &ring : midi_input_buffer) {
+        r_lock.add(ring.get_data(), ring.get_capacity() * sizeof(int));
+    }
+    for (Lv2CircularBuffer<int> &ring : midi_output_buffer) {
+        r_lock.add(ring.get_data(), ring.get_capacity() * sizeof(int));
+    }
+    for (const std::vector<MidiEvent> &events : midi_input_events) {
+        r_lock.add_vector(events);
+    }
+    for (const std::vector<MidiEvent> &events : queued_midi_events) {
+        r_lock.add_vector(events);
+    }
+    r_lock.add(control_input_buffer.get_data(), control_input_buffer.get_capacity() * sizeof(int));
+    r_lock.add_vector(control_events);
+    r_lock.add_vector(queued_control_events);
+
+    r_lock.add_vector(worker.requests.data);
+    r_lock.add_vector(worker.responses.data);
+
+    if (remote) {
+        r_lock.add(remote->get_shared(), sizeof(Lv2RemoteShared));
+        for (uint32_t c = 0; c < audio_in_ports.size() && c < REMOTE_MAX_CHANNELS; c++) {
+            r_lock.add(remote->get_scratch(c), max * sizeof(float));
+        }
+        for (uint32_t c = 0; c < audio_out_ports.size() && c < REMOTE_MAX_CHANNELS; c++) {
+            r_lock.add(remote->get_scratch(REMOTE_MAX_CHANNELS + c), max * sizeof(float));
+        }
+    }
 }
 
 // URID map/unmap
@@ -1153,21 +2291,43 @@ LV2_URID Lv2Host::s_map_cb(LV2_URID_Map_Handle h, const char *uri) {
 }
 const char *Lv2Host::s_unmap_cb(LV2_URID_Unmap_Handle h, LV2_URID urid) {
     auto *self = static_cast<Lv2Host *>(h);
-    auto it = self->rev.find(urid);
-    return (it != self->rev.end()) ? it->second.c_str() : "";
+    const UridTable *table = self->urid_table.load(std::memory_order_acquire);
+    if (!table || urid == 0 || urid > table->rev.size()) {
+        return "";
+    }
+    return table->rev[urid - 1];
 }
 LV2_URID Lv2Host::map_uri(const char *uri) {
     if (!uri) {
         return 0;
     }
-    auto it = dict.find(uri);
-    if (it != dict.end()) {
-        return it->second;
+    const UridTable *table = urid_table.load(std::memory_order_acquire);
+    if (table) {
+        auto it = table->dict.find(uri);
+        if (it != table->dict.end()) {
+            return it->second;
+        }
+    }
+
+    // a new URI: plugins map theirs when instantiated and state restores map theirs on the calling thread, so
+    // this is not reached from run() in practice
+    std::lock_guard<std::mutex> guard(urid_mutex);
+    table = urid_table.load(std::memory_order_relaxed);
+    if (table) {
+        auto it = table->dict.find(uri);
+        if (it != table->dict.end()) {
+            return it->second;
+        }
     }
-    LV2_URID id = next_urid++;
-    const std::string key = to_string_safe(uri);
-    dict.emplace(key, id);
-    rev.emplace(id, key);
+
+    urid_strings.emplace_back(uri);
+    const std::string &key = urid_strings.back();
+    std::unique_ptr<UridTable> next = table ? std::make_unique<UridTable>(*table) : std::make_unique<UridTable>();
+    LV2_URID id = (LV2_URID)next->rev.size() + 1;
+    next->dict.emplace(key, id);
+    next->rev.push_back(key.c_str());
+    urid_table.store(next.get(), std::memory_order_release);
+    urid_tables.push_back(std::move(next));
     return id;
 }
 void Lv2Host::premap_common_uris() {
@@ -1236,21 +2396,31 @@ int Lv2Host::s_log_vprintf(LV2_Log_Handle h, LV2_URID type, const char *fmt, va_
 }
 
 // lv2:state helpers
-char *Lv2Host::s_state_abs_path(LV2_State_Map_Path_Handle, const char *p) {
+std::string Lv2Host::state_path(const char *leaf) const {
+    std::error_code ec;
+    std::filesystem::path base = state_dir;
+    if (base.empty()) {
+        base = std::filesystem::temp_directory_path(ec) / "lv2-host";
+    }
+    std::filesystem::path out = base / (leaf ? leaf : "");
+    std::filesystem::create_directories(out.parent_path(), ec);
+    return out.string();
+}
+char *Lv2Host::s_state_abs_path(LV2_State_Map_Path_Handle h, const char *p) {
     if (!p || !*p) {
         return strdup("");
     }
     if (p[0] == '/' || (std::strlen(p) > 1 && p[1] == ':')) {
         return strdup(p);
     }
-    std::string out = std::string("/tmp/") + p;
+    std::string out = static_cast<Lv2Host *>(h)->state_path(p);
     return strdup(out.c_str());
 }
 char *Lv2Host::s_state_abspath_to_abstract(LV2_State_Map_Path_Handle, const char *abs) {
     return strdup((!abs || !*abs) ? "" : abs);
 }
-char *Lv2Host::s_state_make_path(LV2_State_Make_Path_Handle, const char *leaf) {
-    std::string out = std::string("/tmp/") + (leaf ? leaf : "");
+char *Lv2Host::s_state_make_path(LV2_State_Make_Path_Handle h, const char *leaf) {
+    std::string out = static_cast<Lv2Host *>(h)->state_path(leaf);
     return strdup(out.c_str());
 }
 void Lv2Host::s_state_free_path(LV2_State_Free_Path_Handle, char *p) {
@@ -1259,6 +2429,42 @@ void Lv2Host::s_state_free_path(LV2_State_Free_Path_Handle, char *p) {
     }
 }
 
+LV2_State_Status Lv2Host::s_state_store(LV2_State_Handle h, uint32_t key, const void *value, size_t size,
+                                        uint32_t type, uint32_t flags) {
+    auto *context = static_cast<StateContext *>(h);
+    if (!key || !type) {
+        return LV2_STATE_ERR_UNKNOWN;
+    }
+    for (StateProperty &property : *context->properties) {
+        if (property.key == key) {
+            return LV2_STATE_ERR_UNKNOWN;
+        }
+    }
+    const uint8_t *b = static_cast<const uint8_t *>(value);
+    StateProperty property{key, type, flags, std::vector<uint8_t>(b, b + size)};
+    context->properties->push_back(std::move(property));
+    return LV2_STATE_SUCCESS;
+}
+const void *Lv2Host::s_state_retrieve(LV2_State_Handle h, uint32_t key, size_t *size, uint32_t *type,
+                                      uint32_t *flags) {
+    auto *context = static_cast<StateContext *>(h);
+    for (const StateProperty &property : *context->properties) {
+        if (property.key == key) {
+            if (size) {
+                *size = property.value.size();
+            }
+            if (type) {
+                *type = property.type;
+            }
+            if (flags) {
+                *flags = property.flags;
+            }
+            return property.value.data();
+        }
+    }
+    return nullptr;
+}
+
 void Lv2Host::s_set_port_value(const char *port_symbol, void *user_data, const void *value, uint32_t size,
                                uint32_t type_urid) {
     auto *self = static_cast<Lv2Host *>(user_data);
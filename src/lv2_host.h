@@ -20,16 +20,28 @@
 
 #include <cstdarg>
 #include <cstddef>
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "lv2_circular_buffer.h"
+#include "lv2_memory.h"
+#include "lv2_remote.h"
 
 namespace godot {
 
 const int MIDI_BUFFER_SIZE = 2048;
+const int CONTROL_QUEUE_SIZE = 1024;
+const int MIDI_QUEUE_SIZE = 1024;
+const int WORKER_QUEUE_BYTES = 64 * 1024;
+// link-map namespaces handed to isolated plugins: glibc has 16 (DL_NNS) and the first one is the application's
+const int ISOLATED_NAMESPACE_LIMIT = 15;
 
 struct URIDs {
     LV2_URID atom_Int{}, atom_Float{};
@@ -61,12 +73,36 @@ struct AtomOut {
 
 struct MidiEvent {
     static constexpr const uint32_t DATA_SIZE = 3;
+    // ints per event in the MIDI rings: frame, size, data
+    static constexpr const uint32_t RING_SIZE = DATA_SIZE + 2;
 
     int frame{};
     uint8_t data[DATA_SIZE];
     int size = DATA_SIZE;
 };
 
+struct ControlEvent {
+    static constexpr const uint32_t DATA_SIZE = 3;
+
+    int frame{};
+    uint32_t index{};
+    float value{};
+};
+
+struct SubBlockStats {
+    uint32_t sub_runs{};
+    double run_usec{};
+    double overhead_usec{};
+    double max_overhead_usec{};
+};
+
+// where a frame port (audio/CV) reads or writes: first_frames frames at first, the rest at second
+struct PortBinding {
+    float *first{nullptr};
+    uint32_t first_frames{UINT32_MAX};
+    float *second{nullptr};
+};
+
 struct LilvControl {
     int index;
     std::string symbol;
@@ -87,6 +123,15 @@ struct LilvPluginInfo {
     std::string name;
 };
 
+struct StateProperty {
+    LV2_URID key{};
+    LV2_URID type{};
+    uint32_t flags{};
+    std::vector<uint8_t> value;
+};
+
+class Lv2MidiMap;
+
 class Lv2Host {
 private:
     // lv2:state helpers
@@ -94,6 +139,21 @@ private:
     static char *s_state_abspath_to_abstract(LV2_State_Map_Path_Handle, const char *abs);
     static char *s_state_make_path(LV2_State_Make_Path_Handle, const char *leaf);
     static void s_state_free_path(LV2_State_Free_Path_Handle, char *p);
+    static LV2_State_Status s_state_store(LV2_State_Handle, uint32_t key, const void *value, size_t size,
+                                          uint32_t type, uint32_t flags);
+    static const void *s_state_retrieve(LV2_State_Handle, uint32_t key, size_t *size, uint32_t *type,
+                                        uint32_t *flags);
+    std::string state_path(const char *leaf) const;
+    // a parsed state: control values by port index and the plugin's own properties, URIDs already mapped
+    struct ParsedState {
+        std::vector<std::pair<uint32_t, float>> controls;
+        std::vector<StateProperty> properties;
+        bool restore_properties{true};
+    };
+    bool parse_state(const std::vector<uint8_t> &p_blob, std::vector<std::pair<std::string, float>> &r_controls,
+                     std::vector<StateProperty> &r_properties);
+    bool prepare_state(const std::vector<uint8_t> &p_blob, ParsedState &r_state);
+    bool apply_state(ParsedState &p_state);
 
     // helpers
     std::string port_symbol(const LilvPort *cport) const;
@@ -122,9 +182,17 @@ private:
     // URID map + storage
     LV2_URID_Map map{};
     LV2_Feature feat_map{};
-    LV2_URID next_urid{1};
-    std::unordered_map<std::string, LV2_URID> dict;
-    std::unordered_map<LV2_URID, std::string> rev;
+    // plugins map from any thread, run() and work responses included, so lookups never lock: a new URID is added
+    // to a copy of the table, which is then published whole. Every copy is kept (a lookup may still be reading an
+    // old one) and the URI strings live in urid_strings, whose elements never move
+    struct UridTable {
+        std::unordered_map<std::string_view, LV2_URID> dict;
+        std::vector<const char *> rev;
+    };
+    std::mutex urid_mutex;
+    std::deque<std::string> urid_strings;
+    std::vector<std::unique_ptr<UridTable>> urid_tables;
+    std::atomic<const UridTable *> urid_table{nullptr};
     std::unordered_map<std::string, uint32_t> symbol_to_index;
 
     // URID unmap
@@ -155,6 +223,15 @@ private:
     LV2_Feature feat_state_make{};
     LV2_Feature feat_state_free{};
 
+    // lv2:state interface + snapshots
+    const LV2_State_Interface *state_iface{nullptr};
+    bool thread_safe_restore{false};
+    std::string state_dir;
+    // handed over by queue_restore_state(), applied by the instance thread; only ever freed by the caller side
+    std::mutex restore_mutex;
+    std::unique_ptr<ParsedState> pending_restore;
+    std::atomic<bool> restore_pending{false};
+
     const LV2_Feature *features[12]{};
 
     // Ports / buffers
@@ -166,6 +243,10 @@ private:
     std::vector<float *> audio_ptrs;
     std::vector<float *> audio_in_ptrs;
     std::vector<float *> audio_out_ptrs;
+    std::vector<uint32_t> audio_in_ports;
+    std::vector<uint32_t> audio_out_ports;
+    std::vector<PortBinding> port_bindings;
+    bool bindings_dirty{false};
     uint32_t channels{};
 
     // Atom ports
@@ -174,8 +255,56 @@ private:
     uint32_t seq_capacity_hint{}; // BYTES
 
     // Midi buffers
+    // the input rings take one producer at a time, but scripts, the MIDI router and the server node all write them
+    std::mutex input_write_mutex;
     std::vector<Lv2CircularBuffer<int>> midi_input_buffer;
     std::vector<Lv2CircularBuffer<int>> midi_output_buffer;
+    std::vector<std::vector<MidiEvent>> midi_input_events;
+    // events queued from the DSP thread itself (instance routing), merged with the input rings per bus
+    std::vector<std::vector<MidiEvent>> queued_midi_events;
+
+    // timestamped control changes, applied at sub-block boundaries
+    Lv2CircularBuffer<int> control_input_buffer;
+    std::vector<ControlEvent> control_events;
+    std::vector<ControlEvent> queued_control_events;
+    // queue entries refused because the reserved space was full, read from any thread
+    std::atomic<uint32_t> control_events_dropped{0};
+    std::atomic<uint32_t> midi_events_dropped{0};
+    std::vector<uint32_t> frame_ports;
+    uint32_t connected_offset{};
+    // set from script threads while perform() reads it
+    std::atomic<uint32_t> min_sub_block{16};
+    bool pending_notes_off{false};
+    SubBlockStats sub_block_stats{};
+    // CC/NRPN to control mappings, owned by the caller; fed every drained MIDI input event
+    Lv2MidiMap *midi_map{nullptr};
+
+    // out-of-process hosting: the plugin runs in a `lv2-host --serve` child, this side only keeps the ports,
+    // rings and control values and forwards every block
+    Lv2RemoteLink *remote{nullptr};
+    std::string remote_executable;
+    std::string remote_lv2_path;
+    std::string remote_uri;
+    uint32_t remote_realtime_policy{};
+    int remote_realtime_priority{};
+    uint64_t remote_timeout_usec{100000};
+    int remote_snapshot_interval_ms{1000};
+
+    // in-process isolation: the plugin library is loaded into its own link-map namespace (dlmopen) so its
+    // globals are not shared with other instances of the same plugin
+    bool isolation_requested{false};
+    bool isolated{false};
+
+    void perform_remote(int p_frames);
+    bool bind_remote_channel(Lv2RemoteBinding &r_binding, uint32_t p_port, uint32_t p_slot, int p_frames,
+                             bool p_input);
+    void sync_remote_controls(const std::vector<float> &p_values);
+
+    void connect_frame_ports(uint32_t p_offset);
+    void bind_frame_port(uint32_t p_port, float *p_first, int p_first_frames, float *p_second);
+    int next_binding_split(int p_offset, int p_end) const;
+    void apply_control_event(const ControlEvent &p_event);
+    double run_sub_block(int p_offset, int p_frames);
 
     std::vector<LilvControl> control_inputs;
     std::vector<LilvControl> control_outputs;
@@ -194,13 +323,21 @@ private:
     static int s_log_printf(LV2_Log_Handle, LV2_URID type, const char *fmt, ...);
     static int s_log_vprintf(LV2_Log_Handle, LV2_URID type, const char *fmt, va_list ap);
 
-    // lv2:worker proxy
+    // lv2:worker proxy, requests and responses are packed into preallocated byte queues
+    // ([size][payload] entries, 8-byte aligned) so scheduling work from run() never allocates
+    struct WorkerQueue {
+        std::vector<uint8_t> data;
+        size_t used = 0;
+
+        bool push(uint32_t p_size, const void *p_data);
+    };
+
     struct WorkerState {
         const LV2_Worker_Interface *iface = nullptr;
         LV2_Handle handle = nullptr;
         LV2_Worker_Schedule sched{};
-        std::vector<std::vector<uint8_t>> requests;
-        std::vector<std::vector<uint8_t>> responses;
+        WorkerQueue requests;
+        WorkerQueue responses;
     } worker{};
 
     static LV2_Worker_Status s_schedule_work(LV2_Worker_Schedule_Handle, uint32_t size, const void *data);
@@ -220,6 +357,26 @@ public:
 
     bool find_plugin(const std::string &plugin_uri);
     bool instantiate();
+
+    // instantiate() starts the plugin in a child process running p_executable (the lv2-host tool) instead of
+    // loading it here; an empty path goes back to in-process hosting. p_lv2_path overrides LV2_PATH in the child.
+    void set_remote_executable(const std::string &p_executable, const std::string &p_lv2_path = "");
+    void set_remote_realtime(uint32_t p_policy, int p_priority);
+    void set_remote_timeout_usec(uint64_t p_usec);
+    void set_remote_snapshot_interval_ms(int p_ms);
+    bool is_remote() const;
+    // frames inside the memory shared with the child (handed to it without a copy), nullptr when not remote
+    float *allocate_shared_frames(size_t p_count);
+    uint32_t get_remote_restarts() const;
+    Lv2RemoteStats get_remote_stats();
+
+    // asks instantiate() to load the plugin library into a new link-map namespace (Linux, patched lilv only);
+    // it falls back to the shared namespace once ISOLATED_NAMESPACE_LIMIT of them are in use
+    void set_isolated(bool p_isolated);
+    // whether the running instance actually got its own namespace
+    bool is_isolated() const;
+    // namespaces held by isolated instances of every host in the process
+    static int get_isolated_namespace_count();
     void set_cli_control_overrides(const std::vector<std::pair<std::string, float>> &name_value_pairs);
 
     void dump_plugin_features() const;
@@ -233,10 +390,30 @@ public:
     std::vector<std::string> get_presets();
     void load_preset(std::string preset);
 
+    // in-memory snapshots of control ports + LV2_State_Interface data
+    void set_state_dir(const std::string &p_dir);
+    const std::string &get_state_dir() const;
+    bool has_thread_safe_restore() const;
+    bool save_state(std::vector<uint8_t> &r_blob);
+    bool restore_state(const std::vector<uint8_t> &p_blob);
+    // parses the blob on the calling thread and hands it over to apply_pending_restore(); plugins with
+    // state:threadSafeRestore restore their properties here, their control values still go through the hand-over
+    bool queue_restore_state(const std::vector<uint8_t> &p_blob);
+    bool has_pending_restore() const;
+    // instance thread, between blocks: never concurrently with run(). false if the plugin refused the state
+    bool apply_pending_restore();
+
     void wire_worker_interface();
 
     int perform(int p_frames);
 
+    // DSP thread: stands in for perform() while the plugin is not run, drains the event queues and keeps the
+    // control values current
+    void skip(int p_frames);
+    bool has_pending_events() const;
+    // DSP thread: all notes off on every channel of every MIDI input at the start of the next perform()
+    void release_notes();
+
     int get_input_channel_count();
     int get_output_channel_count();
 
@@ -249,12 +426,42 @@ public:
     float *get_input_channel_buffer(int p_channel);
     float *get_output_channel_buffer(int p_channel);
 
+    // DSP thread: read/render a channel straight from/into caller memory (e.g. a ring span) for the next
+    // perform(), p_first_frames frames at p_first and the rest at p_second; runs are split at that point
+    void bind_input_channel(int p_channel, float *p_first, int p_first_frames, float *p_second);
+    void bind_output_channel(int p_channel, float *p_first, int p_first_frames, float *p_second);
+    void unbind_channels();
+
+    // any thread but the DSP thread (which queues instead), writers are serialized on input_write_mutex
     void write_midi_in(int p_bus, const MidiEvent &p_midi_event);
+    // writes as many of p_events as the ring has room for with a single publish, returns that count
+    int write_midi_in_batch(int p_bus, const MidiEvent *p_events, int p_count);
     bool read_midi_in(int p_bus, MidiEvent &p_midi_event);
 
     void write_midi_out(int p_bus, const MidiEvent &p_midi_event);
     bool read_midi_out(int p_bus, MidiEvent &p_midi_event);
 
+    // any thread but the DSP thread, like write_midi_in()
+    void write_control_in(const ControlEvent &p_control_event);
+    bool read_control_in(ControlEvent &p_control_event);
+
+    // DSP thread only: control changes for the next perform(), a change of a control already queued at the same
+    // frame replaces it; dropped (and counted) when the reserved space is full
+    bool queue_control_event(const ControlEvent &p_control_event);
+    // DSP thread only: a MIDI event for the next perform(), dropped (and counted) when the reserved space is full
+    bool queue_midi_event(int p_bus, const MidiEvent &p_midi_event);
+    // room for p_events queued control changes per block on top of CONTROL_QUEUE_SIZE; allocates, so never while
+    // perform() may run
+    void reserve_control_events(int p_events);
+    uint32_t get_control_events_dropped() const;
+    uint32_t get_midi_events_dropped() const;
+
+    void set_min_sub_block(uint32_t p_frames);
+    // p_map must outlive the host or be reset to nullptr first
+    void set_midi_map(Lv2MidiMap *p_map);
+    uint32_t get_min_sub_block() const;
+    const SubBlockStats &get_sub_block_stats() const;
+
     const LilvControl *get_input_control(int p_index);
     const LilvControl *get_output_control(int p_index);
 
@@ -267,6 +474,9 @@ public:
     void rt_deliver_worker_responses();
     void non_rt_do_worker_requests();
 
+    // adds every buffer perform() touches (port buffers, atom sequences, event rings and queues, worker queues)
+    void collect_rt_memory(Lv2MemoryLock &r_lock);
+
     static void s_set_port_value(const char *port_symbol, void *user_data, const void *value, uint32_t size,
                                  uint32_t type_urid);
 
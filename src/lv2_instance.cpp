@@ -2,23 +2,246 @@
 #include "godot_cpp/classes/audio_server.hpp"
 #include "godot_cpp/classes/audio_stream_mp3.hpp"
 #include "godot_cpp/classes/audio_stream_wav.hpp"
+#include "godot_cpp/classes/dir_access.hpp"
+#include "godot_cpp/classes/file_access.hpp"
 #include "godot_cpp/classes/os.hpp"
 #include "godot_cpp/classes/project_settings.hpp"
 #include "godot_cpp/classes/time.hpp"
 #include "godot_cpp/variant/utility_functions.hpp"
 #include "godot_cpp/variant/variant.hpp"
 #include "lv2_control.h"
+#include "lv2_dsp.h"
 #include "lv2_server.h"
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 using namespace godot;
 
+namespace {
+
+static_assert(sizeof(AudioFrame) == 2 * sizeof(float), "AudioFrame is expected to be two packed floats");
+
+// stands in for missing or starved channels so the kernels never see a null source
+const float silence[BUFFER_FRAME_SIZE] = {};
+
+struct RingCursor {
+    const float *data;
+    int index;
+    int capacity;
+};
+
+RingCursor ring_read_cursor(Lv2CircularBuffer<float> *p_ring, int p_index) {
+    if (p_ring == NULL || p_index < 0) {
+        return {silence, 0, BUFFER_FRAME_SIZE};
+    }
+    return {p_ring->get_data(), p_index, p_ring->get_capacity()};
+}
+
+// rings -> interleaved frames straight from ring storage starting at p_index, optionally mixed over p_dry;
+// a null ring or a negative index reads silence
+void read_interleaved(AudioFrame *p_dst, const AudioFrame *p_dry, Lv2CircularBuffer<float> *p_left,
+                      Lv2CircularBuffer<float> *p_right, int p_index, int p_frames, float p_dry_gain,
+                      float p_wet_gain) {
+    RingCursor left = ring_read_cursor(p_left, p_index);
+    RingCursor right = ring_read_cursor(p_right, p_index);
+    float *dst = reinterpret_cast<float *>(p_dst);
+    const float *dry = reinterpret_cast<const float *>(p_dry);
+
+    int done = 0;
+    while (done < p_frames) {
+        int frames = MIN(p_frames - done, MIN(left.capacity - left.index, right.capacity - right.index));
+
+        if (dry != NULL) {
+            lv2_dsp_interleave_mix(dst + 2 * done, dry + 2 * done, left.data + left.index, right.data + right.index,
+                                   frames, p_dry_gain, p_wet_gain);
+        } else {
+            lv2_dsp_interleave(dst + 2 * done, left.data + left.index, right.data + right.index, frames, p_wet_gain);
+        }
+
+        left.index = (left.index + frames) % left.capacity;
+        right.index = (right.index + frames) % right.capacity;
+        done += frames;
+    }
+}
+
+float ring_sample(Lv2CircularBuffer<float> *p_ring, int p_index) {
+    if (p_ring == NULL || p_index < 0) {
+        return 0.0f;
+    }
+    return p_ring->get_data()[p_index % p_ring->get_capacity()];
+}
+
+// ramps the wet part of frames that were just read from 0 back up to full gain
+void fade_in(AudioFrame *p_dst, Lv2CircularBuffer<float> *p_left, Lv2CircularBuffer<float> *p_right, int p_index,
+             int p_frames, float p_wet_gain) {
+    for (int frame = 0; frame < p_frames; frame++) {
+        float cut = (1.0f - (frame + 1) / (float)p_frames) * p_wet_gain;
+        p_dst[frame].left -= ring_sample(p_left, p_index + frame) * cut;
+        p_dst[frame].right -= ring_sample(p_right, p_index + frame) * cut;
+    }
+}
+
+// decays the last sample that was read down to 0 instead of dropping straight to silence
+void fade_out(AudioFrame *p_dst, float p_left, float p_right, int p_frames, float p_wet_gain) {
+    for (int frame = 0; frame < p_frames; frame++) {
+        float gain = (1.0f - (frame + 1) / (float)p_frames) * p_wet_gain;
+        p_dst[frame].left += p_left * gain;
+        p_dst[frame].right += p_right * gain;
+    }
+}
+
+// interleaved frames -> rings, either ring may be null; drops the block rather than overwrite unread frames
+bool write_deinterleaved(Lv2CircularBuffer<float> *p_left, Lv2CircularBuffer<float> *p_right,
+                         const AudioFrame *p_src, int p_frames) {
+    if ((p_left != NULL && p_left->get_capacity() - 1 - p_left->get_available() < p_frames) ||
+        (p_right != NULL && p_right->get_capacity() - 1 - p_right->get_available() < p_frames)) {
+        return false;
+    }
+
+    const float *src = reinterpret_cast<const float *>(p_src);
+    int left_index = p_left != NULL ? p_left->get_write_index() : 0;
+    int right_index = p_right != NULL ? p_right->get_write_index() : 0;
+
+    int done = 0;
+    while (done < p_frames) {
+        int frames = p_frames - done;
+        if (p_left != NULL) {
+            frames = MIN(frames, p_left->get_capacity() - left_index);
+        }
+        if (p_right != NULL) {
+            frames = MIN(frames, p_right->get_capacity() - right_index);
+        }
+
+        lv2_dsp_deinterleave(p_left != NULL ? p_left->get_data() + left_index : NULL,
+                             p_right != NULL ? p_right->get_data() + right_index : NULL, src + 2 * done, frames, 1.0f);
+
+        if (p_left != NULL) {
+            left_index = (left_index + frames) % p_left->get_capacity();
+        }
+        if (p_right != NULL) {
+            right_index = (right_index + frames) % p_right->get_capacity();
+        }
+        done += frames;
+    }
+
+    if (p_left != NULL) {
+        p_left->commit(p_frames);
+    }
+    if (p_right != NULL) {
+        p_right->commit(p_frames);
+    }
+
+    return true;
+}
+
+float *span_at(const Lv2RingSpan<float> &p_span, int p_frame, int &r_contiguous) {
+    if (p_frame < p_span.first_frames) {
+        r_contiguous = p_span.first_frames - p_frame;
+        return p_span.first + p_frame;
+    }
+    r_contiguous = p_span.second_frames - (p_frame - p_span.first_frames);
+    return p_span.second + (p_frame - p_span.first_frames);
+}
+
+// spans of the same length that may wrap at different points
+void copy_span(const Lv2RingSpan<float> &p_dst, const Lv2RingSpan<float> &p_src, int p_frames) {
+    int done = 0;
+    while (done < p_frames) {
+        int dst_frames, src_frames;
+        float *dst = span_at(p_dst, done, dst_frames);
+        const float *src = span_at(p_src, done, src_frames);
+        int frames = MIN(p_frames - done, MIN(dst_frames, src_frames));
+        std::memcpy(dst, src, frames * sizeof(float));
+        done += frames;
+    }
+}
+
+// p_dst (p_frames contiguous) += p_src
+void add_span(float *p_dst, const Lv2RingSpan<float> &p_src, int p_frames) {
+    int done = 0;
+    while (done < p_frames) {
+        int src_frames;
+        const float *src = span_at(p_src, done, src_frames);
+        int frames = MIN(p_frames - done, src_frames);
+        for (int i = 0; i < frames; i++) {
+            p_dst[done + i] += src[i];
+        }
+        done += frames;
+    }
+}
+
+void silence_span(const Lv2RingSpan<float> &p_span) {
+    std::memset(p_span.first, 0, p_span.first_frames * sizeof(float));
+    std::memset(p_span.second, 0, p_span.second_frames * sizeof(float));
+}
+
+void scale_span(const Lv2RingSpan<float> &p_span, float p_gain) {
+    lv2_dsp_scale(p_span.first, p_span.first, p_span.first_frames, p_gain);
+    lv2_dsp_scale(p_span.second, p_span.second, p_span.second_frames, p_gain);
+}
+
+void span_peak_sum_squares(const Lv2RingSpan<float> &p_span, float &r_peak, float &r_sum_squares) {
+    float second_peak = 0.0f;
+    float second_sum = 0.0f;
+    lv2_dsp_peak_sum_squares(p_span.first, p_span.first_frames, r_peak, r_sum_squares);
+    if (p_span.second_frames > 0) {
+        lv2_dsp_peak_sum_squares(p_span.second, p_span.second_frames, second_peak, second_sum);
+    }
+    r_peak = MAX(r_peak, second_peak);
+    r_sum_squares += second_sum;
+}
+
+float span_true_peak(const Lv2RingSpan<float> &p_span, float *p_history, float *p_scratch) {
+    float peak = lv2_dsp_true_peak(p_span.first, p_span.first_frames, p_history, p_scratch);
+    if (p_span.second_frames > 0) {
+        peak = MAX(peak, lv2_dsp_true_peak(p_span.second, p_span.second_frames, p_history, p_scratch));
+    }
+    return peak;
+}
+
+// out = out * (1 - g) + dry * g with g ramping from p_from to p_to over the block, no dry span means silence
+void crossfade_span(const Lv2RingSpan<float> &p_out, const Lv2RingSpan<float> *p_dry, float p_from, float p_to,
+                    int p_frames) {
+    float step = (p_to - p_from) / p_frames;
+    int done = 0;
+    while (done < p_frames) {
+        int out_frames;
+        int dry_frames = p_frames - done;
+        float *out = span_at(p_out, done, out_frames);
+        const float *dry = p_dry != NULL ? span_at(*p_dry, done, dry_frames) : NULL;
+        int frames = MIN(p_frames - done, MIN(out_frames, dry_frames));
+        for (int i = 0; i < frames; i++) {
+            float gain = p_from + step * (done + i);
+            out[i] = out[i] * (1.0f - gain) + (dry != NULL ? dry[i] * gain : 0.0f);
+        }
+        done += frames;
+    }
+}
+
+// below this a block counts as silent for tail skipping (-100 dB)
+const float GOVERNOR_SILENCE = 0.00001f;
+
+// upper edges of the slack histogram bins in block periods, the first bin counts missed deadlines
+const double DEADLINE_SLACK_EDGES[DEADLINE_HISTOGRAM_BINS - 1] = {0.0, 0.125, 0.25, 0.5, 1.0, 2.0, 4.0};
+const double DEADLINE_NEAR_MISS = 0.25;
+const int DEADLINE_NEAR_MISSES_PER_WINDOW = 4;
+
+} // namespace
+
 namespace godot {
 
 using Lv2Instance = godot::Lv2Instance;
 
+String Lv2Instance::get_global_lv2_path() {
+    String lv2_path = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/lv2_path");
+    if (lv2_path.length() > 0 && lv2_path.is_absolute_path()) {
+        return ProjectSettings::get_singleton()->globalize_path(lv2_path);
+    }
+    return String();
+}
+
 Lv2Instance::Lv2Instance() {
     lv2_host = NULL;
     initialized = false;
@@ -31,33 +254,128 @@ Lv2Instance::Lv2Instance() {
     world = lilv_world_new();
     mix_rate = AudioServer::get_singleton()->get_mix_rate();
 
-    // TODO: update block size
-    int p_frames = 512;
-    lv2_host = new Lv2Host(world, mix_rate, p_frames);
-
-    String lv2_path = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/lv2_path");
-
-    if (lv2_path.length() > 0 && lv2_path.is_absolute_path()) {
-        lv2_path = ProjectSettings::get_singleton()->globalize_path(lv2_path);
+    String lv2_path = get_global_lv2_path();
 
+    if (lv2_path.length() > 0) {
         LilvNode *lv2_node_path = lilv_new_string(world, lv2_path.ascii());
         lilv_world_set_option(world, LILV_OPTION_LV2_PATH, lv2_node_path);
         lilv_node_free(lv2_node_path);
     }
 
+    watchdog_blocks = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/watchdog_blocks", 8);
+    loading_policy = LOADING_POLICY_SHARED;
+    effective_loading_policy = LOADING_POLICY_SHARED;
+    remote_restarts_seen = 0;
+    midi_learned_seen = 0;
+    ring_memory = NULL;
+    ring_floats = 0;
+
+    int policy = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/realtime_policy", 0);
+    realtime_policy = (Lv2RealtimePolicy)CLAMP(policy, (int)LV2_REALTIME_POLICY_NONE, (int)LV2_REALTIME_POLICY_RR);
+    realtime_priority = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/realtime_priority", 50);
+
+    int min_sub_block = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/min_sub_block_frames", 16);
+    create_host(min_sub_block);
+
+    output_level = std::make_shared<std::atomic<float>>(0.0f);
+    reset_output_consumers();
+
+    double ring_latency_ms = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/ring_latency_ms", 20.0);
+    // mix reads and rendered blocks are both BUFFER_FRAME_SIZE, the mix rate turns the latency target into frames
+    ring_capacity = compute_ring_capacity(BUFFER_FRAME_SIZE, ring_latency_ms, mix_rate);
+
+    int jitter_target = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/jitter_target_frames",
+                                                                      BUFFER_FRAME_SIZE);
+    int jitter_max = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/jitter_max_frames",
+                                                                   BUFFER_FRAME_SIZE * 2);
+    // keep a block of headroom for the writer and one for the reader
+    jitter_max = MIN(jitter_max, ring_capacity - BUFFER_FRAME_SIZE * 2);
+    jitter.min_frames = CLAMP(jitter_target, BUFFER_FRAME_SIZE, MAX(jitter_max, BUFFER_FRAME_SIZE));
+    jitter.max_frames = MAX(jitter_max, jitter.min_frames);
+    jitter.stable_blocks = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/jitter_stable_blocks", 256);
+    jitter.fade_frames = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/underrun_fade_frames", 64);
+    jitter.target_frames = jitter.min_frames;
+    true_peak_enabled = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/true_peak_metering", false);
+
+    String cpu_list = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/dsp_cpu_affinity", "");
+    realtime_cpus = lv2_realtime_parse_cpus(cpu_list.ascii().get_data());
+    realtime_dirty = true;
+
+    lock_memory = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/lock_memory", false);
+    page_faults.enabled = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/page_fault_tracking", false);
+    deadline.enabled = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/deadline_scheduling", false);
+
+    priority = PRIORITY_NORMAL;
+    degrade_level = DEGRADE_NONE;
+    busy_usec = 0;
+    quality_control = -1;
+    quality_saved_value = 0.0f;
+    governor_bypass_fade = 0.0f;
+    silent_blocks = 0;
+    applied_degrade_level = DEGRADE_NONE;
+    governor_busy_seen = 0;
+    governor_missed_seen = 0;
+
+    perform_started_usec = 0;
+    quarantined = false;
+    hang_count = 0;
+    thread_mutex = NULL;
+
+    graph_driver = NULL;
+    rack.resize(1);
+
+    block_midi_out.reserve(MIDI_QUEUE_SIZE);
+    output_control_values.resize(OUTPUT_CONTROL_MAX_VALUES);
+    output_control_count = 0;
+    midi_out_queue.resize(MIDI_OUT_QUEUE_SIZE);
+    midi_out_written = 0;
+    midi_out_read = 0;
+    midi_out_dropped = 0;
+    block_started_usec = 0;
+
+    mutex.instantiate();
+    io_mutex.instantiate();
+    semaphore.instantiate();
+    graph_mutex.instantiate();
+}
+
+void Lv2Instance::create_host(uint32_t p_min_sub_block) {
+    int p_frames = BUFFER_FRAME_SIZE;
+    lv2_host = new Lv2Host(world, mix_rate, p_frames);
+
     if (!lv2_host->load_world()) {
         // TODO: log to godot
         std::cerr << "Failed to create/load lv2 world\n";
     }
 
-    mutex.instantiate();
-    semaphore.instantiate();
-
-    temp_buffer.resize(BUFFER_FRAME_SIZE);
+    lv2_host->set_min_sub_block(p_min_sub_block);
+    remote_restarts_seen = 0;
+}
 
-    for (int i = 0; i < BUFFER_FRAME_SIZE; i++) {
-        temp_buffer.ptrw()[i] = 0;
+int Lv2Instance::apply_loading_policy(Lv2Host *p_host, const String &p_uri) {
+    int policy = Lv2Server::get_singleton()->get_loading_policy(p_uri);
+
+    p_host->set_isolated(policy == LOADING_POLICY_ISOLATED);
+
+    if (policy == LOADING_POLICY_OUT_OF_PROCESS) {
+        String executable = ProjectSettings::get_singleton()->get_setting(
+            "audio/lv2-host/host_executable", "res://addons/lv2-host/bin/linux/release/bin/lv2-host");
+        executable = ProjectSettings::get_singleton()->globalize_path(executable);
+        p_host->set_remote_executable(std::string(executable.utf8().get_data()),
+                                      std::string(get_global_lv2_path().utf8().get_data()));
+        p_host->set_remote_realtime(realtime_policy, realtime_priority);
+        p_host->set_remote_timeout_usec(get_remote_timeout_usec());
+        p_host->set_remote_snapshot_interval_ms(
+            ProjectSettings::get_singleton()->get_setting("audio/lv2-host/remote_snapshot_ms", 1000));
+    } else {
+        p_host->set_remote_executable("");
     }
+    return policy;
+}
+
+uint64_t Lv2Instance::get_remote_timeout_usec() const {
+    // well inside the watchdog period, a child stuck in run() is restarted before the instance would be quarantined
+    return (uint64_t)(watchdog_blocks * BUFFER_FRAME_SIZE * 1000000.0 / mix_rate / 2.0);
 }
 
 void Lv2Instance::configure() {
@@ -68,22 +386,55 @@ void Lv2Instance::configure() {
         std::cerr << "Plugin not found: " << uri.ascii() << "\n";
     }
 
+    // before instantiate(), an out-of-process plugin gets it at startup. Keyed by the instance name (unique within
+    // the server) so a relaunch reuses the files a saved state refers to instead of leaving a directory per run
+    String state_name = instance_name.validate_filename();
+    if (state_name.is_empty()) {
+        state_name = "unnamed";
+    }
+    String state_dir =
+        OS::get_singleton()->get_user_data_dir().path_join("lv2-host").path_join("state").path_join(state_name);
+    DirAccess::make_dir_recursive_absolute(state_dir);
+    lv2_host->set_state_dir(std::string(state_dir.utf8().get_data()));
+
+    loading_policy = apply_loading_policy(lv2_host, uri);
+    remote_restarts_seen = 0;
+
     if (!lv2_host->instantiate()) {
         std::cerr << "Failed to instantiate plugin\n";
     }
 
+    effective_loading_policy = lv2_host->is_remote()     ? LOADING_POLICY_OUT_OF_PROCESS
+                               : lv2_host->is_isolated() ? LOADING_POLICY_ISOLATED
+                                                         : LOADING_POLICY_SHARED;
+    if (loading_policy == LOADING_POLICY_ISOLATED && effective_loading_policy != LOADING_POLICY_ISOLATED) {
+        WARN_PRINT(vformat("Lv2Instance %s: no link-map namespace left for %s (%d in use), loaded it shared",
+                           instance_name, uri, Lv2Host::get_isolated_namespace_count()));
+    }
+
     std::vector<std::pair<std::string, float>> cli_sets;
 
     lv2_host->wire_worker_interface();
     lv2_host->set_cli_control_overrides(cli_sets);
 
-    // TODO: use the block from godot instead of 512
-    int p_frames = 512;
+    // the old buffers are about to be freed
+    memory_lock.clear();
+
+    int p_frames = BUFFER_FRAME_SIZE;
     if (!lv2_host->prepare_ports_and_buffers(p_frames)) {
         std::cerr << "Failed to prepare/connect ports\n";
     }
 
+    configure_rack(p_frames);
+    midi_map.resolve(lv2_host);
+    modulation.resolve(lv2_host);
+    reserve_modulation_events();
+    lv2_host->set_midi_map(&midi_map);
+    // the rack's last slot renders into the output rings
+    Lv2Host *tail = get_slot_host(rack.size() - 1);
+
     input_controls.clear();
+    input_control_map.clear();
 
     for (int i = 0; i < lv2_host->get_input_control_count(); i++) {
         const LilvControl *control = lv2_host->get_input_control(i);
@@ -105,9 +456,11 @@ void Lv2Instance::configure() {
         }
 
         input_controls.append(lv2_control);
+        input_control_map[control->symbol.c_str()] = i;
     }
 
     output_controls.clear();
+    output_control_map.clear();
 
     for (int i = 0; i < lv2_host->get_output_control_count(); i++) {
         const LilvControl *control = lv2_host->get_output_control(i);
@@ -129,10 +482,61 @@ void Lv2Instance::configure() {
         }
 
         output_controls.append(lv2_control);
+        output_control_map[control->symbol.c_str()] = i;
+    }
+
+    // the instance thread is parked by the lock, this is the only writer
+    output_control_seqlock.write_begin();
+    int output_control_total = MIN(lv2_host->get_output_control_count(), OUTPUT_CONTROL_MAX_VALUES);
+    for (int i = 0; i < output_control_total; i++) {
+        output_control_values[i] = 0.0f;
+    }
+    output_control_count.store(output_control_total, std::memory_order_relaxed);
+    output_control_seqlock.write_end();
+
+    quality_control = -1;
+    for (int i = 0; i < lv2_host->get_input_control_count() && quality_control < 0; i++) {
+        String symbol = String(lv2_host->get_input_control(i)->symbol.c_str()).to_lower();
+        if (symbol.contains("quality") || symbol.contains("oversampl") || symbol.contains("precision")) {
+            quality_control = i;
+        }
+    }
+    silent_blocks = 0;
+
+    true_peak_history.assign(tail->get_output_channel_count() * TRUE_PEAK_HISTORY, 0.0f);
+    true_peak_scratch.assign(TRUE_PEAK_HISTORY + BUFFER_FRAME_SIZE, 0.0f);
+
+    // the mix thread may still be reading the old rings, it is kept out while they are swapped
+    io_mutex->lock();
+
+    input_channels.resize(lv2_host->get_input_channel_count(), Lv2CircularBuffer<float>(0));
+    output_channels.resize(tail->get_output_channel_count());
+
+    input_spans.resize(input_channels.size());
+    output_spans.resize(output_channels.size());
+
+    // out of process the plugin reads and renders the rings in place, without a copy per block
+    ring_floats = (input_channels.size() + output_channels.size()) * ring_capacity;
+    ring_memory = lv2_host->allocate_shared_frames(ring_floats);
+    if (ring_memory != NULL) {
+        ring_arena.clear();
+        std::memset(ring_memory, 0, ring_floats * sizeof(float));
+    } else {
+        ring_arena.assign(ring_floats, 0.0f);
+        ring_memory = ring_arena.data();
+    }
+    float *channel_memory = ring_memory;
+    for (int channel = 0; channel < input_channels.size(); channel++) {
+        input_channels[channel].attach(channel_memory, ring_capacity);
+        channel_memory += ring_capacity;
+    }
+    for (int channel = 0; channel < output_channels.size(); channel++) {
+        output_channels[channel].buffer.attach(channel_memory, ring_capacity);
+        channel_memory += ring_capacity;
     }
+    reset_output_consumers();
 
-    input_channels.resize(lv2_host->get_input_channel_count());
-    output_channels.resize(lv2_host->get_output_channel_count());
+    io_mutex->unlock();
 
     std::vector<std::string> host_presets = lv2_host->get_presets();
 
@@ -142,16 +546,160 @@ void Lv2Instance::configure() {
         presets.push_back(host_presets[i].c_str());
     }
 
-    /*
-    for (int channel = 0; channel < output_channels.size(); channel++) {
-        output_channels[channel].buffer.write_channel(temp_buffer.ptrw(), p_frames);
-    }
-    */
+    lock_rt_memory();
 
     unlock();
 }
 
+Lv2Host *Lv2Instance::get_slot_host(int p_slot) const {
+    return p_slot == 0 ? lv2_host : rack[p_slot].host;
+}
+
+void Lv2Instance::configure_rack(int p_frames) {
+    for (int slot = 1; slot < rack.size(); slot++) {
+        RackSlot &rack_slot = rack[slot];
+        delete rack_slot.host;
+        rack_slot.host = new Lv2Host(world, mix_rate, p_frames);
+
+        Lv2Host *host = rack_slot.host;
+        if (!host->load_world()) {
+            std::cerr << "Failed to create/load lv2 world\n";
+        }
+        host->set_min_sub_block(lv2_host->get_min_sub_block());
+
+        if (!host->find_plugin(std::string(rack_slot.uri.ascii()))) {
+            std::cerr << "Plugin not found: " << rack_slot.uri.ascii() << "\n";
+        }
+
+        apply_loading_policy(host, rack_slot.uri);
+
+        if (!host->instantiate()) {
+            std::cerr << "Failed to instantiate plugin\n";
+        }
+
+        host->wire_worker_interface();
+
+        if (!host->prepare_ports_and_buffers(p_frames)) {
+            std::cerr << "Failed to prepare/connect ports\n";
+        }
+    }
+
+    for (int slot = 0; slot < rack.size(); slot++) {
+        rack[slot].output_spans.resize(get_slot_host(slot)->get_output_channel_count());
+    }
+}
+
+void Lv2Instance::clear_rack() {
+    for (int slot = 1; slot < rack.size(); slot++) {
+        delete rack[slot].host;
+        rack[slot].host = NULL;
+    }
+}
+
+int Lv2Instance::perform_rack(int p_frames, const std::shared_ptr<std::atomic<bool>> &p_abandoned) {
+    // the signal entering the next slot: the instance inputs (bound to slot 0 already), then the buffers the
+    // previous running slot rendered into; a bypassed slot passes on what it was given
+    const Lv2RingSpan<float> *stage = input_spans.data();
+    int stage_channels = input_spans.size();
+    int last = rack.size() - 1;
+    int result = p_frames;
+
+    for (int slot = 0; slot <= last; slot++) {
+        RackSlot &rack_slot = rack[slot];
+        Lv2Host *host = get_slot_host(slot);
+
+        if (slot > 0) {
+            // channel counts may differ from slot to slot, e.g. a mono plugin feeding a stereo one
+            for (int channel = 0; channel < host->get_input_channel_count(); channel++) {
+                if (stage_channels == 0) {
+                    float *silence = host->get_input_channel_buffer(channel);
+                    std::memset(silence, 0, p_frames * sizeof(float));
+                    host->bind_input_channel(channel, silence, p_frames, NULL);
+                    continue;
+                }
+                const Lv2RingSpan<float> &span = stage[channel % stage_channels];
+                host->bind_input_channel(channel, span.first, span.first_frames,
+                                         span.second_frames > 0 ? span.second : NULL);
+            }
+        }
+
+        if (rack_slot.bypass) {
+            host->skip(p_frames);
+            rack_slot.bypassed_blocks++;
+            continue;
+        }
+
+        if (slot < last) {
+            for (int channel = 0; channel < rack_slot.output_spans.size(); channel++) {
+                Lv2RingSpan<float> &span = rack_slot.output_spans[channel];
+                span.first = host->get_output_channel_buffer(channel);
+                span.first_frames = p_frames;
+                host->bind_output_channel(channel, span.first, p_frames, NULL);
+            }
+        }
+
+        uint64_t started = Time::get_singleton()->get_ticks_usec();
+        int slot_result = host->perform(p_frames);
+        if (p_abandoned != nullptr && p_abandoned->load(std::memory_order_acquire)) {
+            return result;
+        }
+        double elapsed = (double)(Time::get_singleton()->get_ticks_usec() - started);
+
+        rack_slot.runs++;
+        rack_slot.total_usec += elapsed;
+        rack_slot.last_usec = elapsed;
+        rack_slot.max_usec = MAX(rack_slot.max_usec, elapsed);
+
+        if (slot == 0) {
+            result = slot_result;
+        }
+
+        stage = slot < last ? rack_slot.output_spans.data() : output_spans.data();
+        stage_channels = slot < last ? rack_slot.output_spans.size() : output_spans.size();
+    }
+
+    if (stage != output_spans.data()) {
+        // the last slot is bypassed
+        for (int channel = 0; channel < output_spans.size(); channel++) {
+            if (stage_channels > 0) {
+                copy_span(output_spans[channel], stage[channel % stage_channels], p_frames);
+            } else {
+                silence_span(output_spans[channel]);
+            }
+        }
+    }
+
+    return result;
+}
+
+void Lv2Instance::skip_rack(int p_frames) {
+    for (int slot = 0; slot < rack.size(); slot++) {
+        get_slot_host(slot)->skip(p_frames);
+    }
+}
+
+int Lv2Instance::compute_ring_capacity(int p_block_frames, double p_latency_ms, double p_rate) {
+    // the latency target plus a block being written and a block being read, never below four blocks
+    int frames = (int)Math::ceil(MAX(p_latency_ms, 0.0) * p_rate / 1000.0) + p_block_frames * 2;
+    frames = MAX(frames, p_block_frames * 4);
+
+    int capacity = 1;
+    while (capacity < frames) {
+        capacity <<= 1;
+    }
+
+    return capacity;
+}
+
+int Lv2Instance::get_ring_capacity() {
+    return ring_capacity;
+}
+
 Lv2Instance::~Lv2Instance() {
+    stop_thread();
+    memory_lock.clear();
+    clear_rack();
+
     if (lv2_host != NULL) {
         delete lv2_host;
         lv2_host = NULL;
@@ -160,7 +708,11 @@ Lv2Instance::~Lv2Instance() {
 
 void Lv2Instance::start() {
     if (lv2_host != NULL) {
-        lv2_host->activate();
+        for (int slot = 0; slot < rack.size(); slot++) {
+            if (get_slot_host(slot) != NULL) {
+                get_slot_host(slot)->activate();
+            }
+        }
 
         initialized = true;
         start_thread();
@@ -175,7 +727,11 @@ void Lv2Instance::stop() {
     stop_thread();
 
     if (lv2_host != NULL) {
-        lv2_host->deactivate();
+        for (int slot = 0; slot < rack.size(); slot++) {
+            if (get_slot_host(slot) != NULL) {
+                get_slot_host(slot)->deactivate();
+            }
+        }
         if (prev_initialized) {
             cleanup_channels();
         }
@@ -204,397 +760,2175 @@ void Lv2Instance::reset() {
 void Lv2Instance::cleanup_channels() {
     lock();
 
+    io_mutex->lock();
     input_channels.clear();
     output_channels.clear();
+    reset_output_consumers();
+    io_mutex->unlock();
+
+    for (int slot = 0; slot < rack.size(); slot++) {
+        if (get_slot_host(slot) != NULL) {
+            get_slot_host(slot)->unbind_channels();
+        }
+    }
 
     unlock();
 }
 
-int Lv2Instance::process_sample(AudioFrame *p_buffer, float p_rate, int p_frames) {
-    if (finished) {
-        return 0;
+void Lv2Instance::reset_output_consumers() {
+    for (int i = 0; i < OUTPUT_MAX_CONSUMERS; i++) {
+        output_consumers[i] = OutputConsumer();
     }
+    output_write_position = 0;
+    output_render_position = 0;
+    output_read_serial = 0;
+    output_leader = NULL;
+    deadline.origin_usec = 0;
+    deadline.origin_position = 0;
+    deadline.read_frames = 0;
+    deadline.render_ahead_frames = 0;
+}
 
-    lock();
-
-    int read = p_frames;
-
-    if (Time::get_singleton()) {
-        last_mix_time = Time::get_singleton()->get_ticks_usec();
-    }
+Lv2Instance::OutputConsumer *Lv2Instance::acquire_output_consumer(uint64_t p_key) {
+    OutputConsumer *free_slot = NULL;
+    OutputConsumer *oldest = &output_consumers[0];
 
-    if (!initialized || output_channels.size() == 0) {
-        for (int frame = 0; frame < p_frames; frame++) {
-            p_buffer[frame].left = 0;
-            p_buffer[frame].right = 0;
+    for (int i = 0; i < OUTPUT_MAX_CONSUMERS; i++) {
+        OutputConsumer &consumer = output_consumers[i];
+        if (consumer.used && consumer.key == p_key) {
+            return &consumer;
         }
-    } else if (output_channels.size() > 1) {
-        output_channels[0].buffer.read_channel(temp_buffer.ptrw(), p_frames);
-        for (int frame = 0; frame < read; frame++) {
-            p_buffer[frame].left = temp_buffer[frame];
-        }
-
-        output_channels[1].buffer.read_channel(temp_buffer.ptrw(), p_frames);
-        for (int frame = 0; frame < read; frame++) {
-            p_buffer[frame].right = temp_buffer[frame];
+        if (!consumer.used && free_slot == NULL) {
+            free_slot = &consumer;
         }
-    } else if (output_channels.size() > 0) {
-        output_channels[0].buffer.read_channel(temp_buffer.ptrw(), p_frames);
-        for (int frame = 0; frame < read; frame++) {
-            p_buffer[frame].left = temp_buffer[frame];
-            p_buffer[frame].right = temp_buffer[frame];
+        if (consumer.last_read < oldest->last_read) {
+            oldest = &consumer;
         }
     }
 
-    for (int channel = 0; channel < output_channels.size(); channel++) {
-        output_channels[channel].buffer.update_read_index(p_frames);
+    // readers that vanished without releasing are recycled, least recently read first
+    OutputConsumer *consumer = free_slot != NULL ? free_slot : oldest;
+    if (consumer == output_leader) {
+        output_leader = NULL;
     }
+    *consumer = OutputConsumer();
+    consumer->used = true;
+    consumer->key = p_key;
 
-    unlock();
-
-    semaphore->post();
+    // new readers join one block behind the writer, like the first reader did
+    uint64_t latency = MIN(output_write_position, (uint64_t)BUFFER_FRAME_SIZE);
+    consumer->position = output_write_position - latency;
 
-    return p_frames;
+    return consumer;
 }
 
-void Lv2Instance::set_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right) {
-    bool has_left_channel = left >= 0 && left < input_channels.size();
-    bool has_right_channel = right >= 0 && right < input_channels.size();
+int Lv2Instance::advance_output_consumer(OutputConsumer *p_consumer, int p_frames, int &r_render_blocks) {
+    p_consumer->last_read = ++output_read_serial;
 
-    if (!has_left_channel && !has_right_channel && !active) {
-        return;
+    // the other readers see the same blocks later (or not at all): adapting on each of them would move the target
+    // once per reader instead of once per mix period
+    if (output_leader == NULL || p_consumer->position > output_leader->position) {
+        output_leader = p_consumer;
     }
+    bool leading = p_consumer == output_leader;
 
-    lock();
-
-    if (has_left_channel) {
-        for (int frame = 0; frame < p_frames; frame++) {
-            temp_buffer.ptrw()[frame] = p_buffer[frame].left;
-        }
+    int index = -1;
+    uint64_t available = output_write_position - p_consumer->position;
+    int capacity = output_channels[0].buffer.get_capacity();
 
-        input_channels[left].write_channel(temp_buffer.ptrw(), p_frames);
+    if (available > (uint64_t)(capacity - BUFFER_FRAME_SIZE)) {
+        // fell so far behind that the writer is about to overwrite what is left, skip to the newest block
+        p_consumer->position = output_write_position - MIN(available, (uint64_t)p_frames);
+        p_consumer->overruns++;
+        available = output_write_position - p_consumer->position;
     }
 
-    if (has_right_channel) {
-        for (int frame = 0; frame < p_frames; frame++) {
-            temp_buffer.ptrw()[frame] = p_buffer[frame].right;
-        }
+    if (available >= (uint64_t)p_frames) {
+        index = p_consumer->position % capacity;
+        p_consumer->position += p_frames;
+        p_consumer->frames_read += p_frames;
 
-        input_channels[right].write_channel(temp_buffer.ptrw(), p_frames);
+        if (++p_consumer->stable_count >= jitter.stable_blocks && leading &&
+            jitter.target_frames > jitter.min_frames) {
+            jitter.target_frames = MAX(jitter.target_frames - BUFFER_FRAME_SIZE, jitter.min_frames);
+            p_consumer->stable_count = 0;
+            jitter.shrinks++;
+        }
+    } else {
+        p_consumer->underruns++;
+        p_consumer->stable_count = 0;
+
+        if (leading) {
+            jitter.underruns++;
+            if (jitter.target_frames < jitter.max_frames) {
+                jitter.target_frames = MIN(jitter.target_frames + BUFFER_FRAME_SIZE, jitter.max_frames);
+                jitter.grows++;
+            }
+        }
     }
 
-    // TODO: does lv2 expect empty channels to be sent?
+    // the leading reader drives the instance thread, the others follow the blocks it already asked for;
+    // shrinking the target simply stops requests until the fill has drained
+    int ahead = MIN(deadline.render_ahead_frames, ring_capacity - BUFFER_FRAME_SIZE * 2 - jitter.target_frames);
+    r_render_blocks = 0;
+    while (output_render_position < p_consumer->position + jitter.target_frames + MAX(ahead, 0)) {
+        output_render_position += BUFFER_FRAME_SIZE;
+        r_render_blocks++;
+    }
 
-    unlock();
+    return index;
 }
 
-int Lv2Instance::get_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right) {
-    bool has_left_channel = left >= 0 && left < output_channels.size();
-    bool has_right_channel = right >= 0 && right < output_channels.size();
+int Lv2Instance::read_output(AudioFrame *p_dst, const AudioFrame *p_dry, int p_left, int p_right, int p_frames,
+                             float p_mix, uint64_t p_consumer) {
+    Lv2CircularBuffer<float> *left = p_left >= 0 ? &output_channels[p_left].buffer : NULL;
+    Lv2CircularBuffer<float> *right = p_right >= 0 ? &output_channels[p_right].buffer : NULL;
 
-    if (finished) {
-        return 0;
+    OutputConsumer *consumer = acquire_output_consumer(p_consumer);
+
+    int render_blocks = 0;
+    int index = advance_output_consumer(consumer, p_frames, render_blocks);
+
+    // the leading reader sets the deadlines of the blocks still to be rendered
+    if (consumer->position >= deadline.origin_position) {
+        deadline.origin_usec = Time::get_singleton()->get_ticks_usec();
+        deadline.origin_position = consumer->position;
+        deadline.read_frames = p_frames;
     }
 
-    lock();
+    read_interleaved(p_dst, p_dry, left, right, index, p_frames, 1.0f - p_mix, p_mix);
 
-    if (has_left_channel && active) {
-        output_channels[left].buffer.read_channel(temp_buffer.ptrw(), p_frames);
-        for (int frame = 0; frame < p_frames; frame++) {
-            p_buffer[frame].left = temp_buffer[frame];
+    int fade_frames = MIN(jitter.fade_frames, p_frames);
+
+    if (index < 0) {
+        if (!consumer->starved && fade_frames > 0) {
+            fade_out(p_dst, consumer->last_left, consumer->last_right, fade_frames, p_mix);
         }
+        consumer->starved = true;
+        consumer->last_left = 0.0f;
+        consumer->last_right = 0.0f;
     } else {
-        for (int frame = 0; frame < p_frames; frame++) {
-            p_buffer[frame].left = 0;
+        if (consumer->starved && fade_frames > 0) {
+            fade_in(p_dst, left, right, index, fade_frames, p_mix);
         }
+        consumer->starved = false;
+        consumer->last_left = ring_sample(left, index + p_frames - 1);
+        consumer->last_right = ring_sample(right, index + p_frames - 1);
     }
-    if (has_right_channel && active) {
-        output_channels[right].buffer.read_channel(temp_buffer.ptrw(), p_frames);
-        for (int frame = 0; frame < p_frames; frame++) {
-            p_buffer[frame].right = temp_buffer[frame];
-        }
-    } else {
-        for (int frame = 0; frame < p_frames; frame++) {
-            p_buffer[frame].right = 0;
+
+    return render_blocks;
+}
+
+void Lv2Instance::release_output_consumer(uint64_t p_consumer) {
+    io_mutex->lock();
+
+    for (int i = 0; i < OUTPUT_MAX_CONSUMERS; i++) {
+        if (output_consumers[i].used && output_consumers[i].key == p_consumer) {
+            if (&output_consumers[i] == output_leader) {
+                output_leader = NULL;
+            }
+            output_consumers[i] = OutputConsumer();
         }
     }
 
-    unlock();
-
-    return p_frames;
+    io_mutex->unlock();
 }
 
-void Lv2Instance::program_select(int chan, int bank_num, int preset_num) {
-}
+Array Lv2Instance::get_output_consumer_stats() {
+    Array result;
 
-void Lv2Instance::note_on(int midi_bus, int chan, int key, int vel) {
-    if (!initialized) {
-        return;
-    }
+    io_mutex->lock();
 
-    MidiEvent event;
+    for (int i = 0; i < OUTPUT_MAX_CONSUMERS; i++) {
+        const OutputConsumer &consumer = output_consumers[i];
+        if (!consumer.used) {
+            continue;
+        }
 
-    // TODO: move the midi bit logic to a shared function
-    if (vel > 0) {
-        event.data[0] = (MIDIMessage::MIDI_MESSAGE_NOTE_ON << 4) | (chan & 0x0F);
-    } else {
-        event.data[0] = (MIDIMessage::MIDI_MESSAGE_NOTE_OFF << 4) | (chan & 0x0F);
+        Dictionary stats;
+        stats["consumer"] = consumer.key;
+        stats["latency_frames"] = (int64_t)(output_write_position - consumer.position);
+        stats["frames_read"] = consumer.frames_read;
+        stats["underruns"] = consumer.underruns;
+        stats["overruns"] = consumer.overruns;
+        result.push_back(stats);
     }
 
-    event.data[1] = key;
-    event.data[2] = vel;
+    io_mutex->unlock();
 
-    lv2_host->write_midi_in(midi_bus, event);
+    return result;
 }
 
-void Lv2Instance::note_off(int midi_bus, int chan, int key) {
-    if (!initialized) {
+void Lv2Instance::set_jitter_target_frames(int p_frames) {
+    io_mutex->lock();
+    jitter.min_frames = CLAMP(p_frames, BUFFER_FRAME_SIZE, jitter.max_frames);
+    jitter.target_frames = MAX(jitter.target_frames, jitter.min_frames);
+    io_mutex->unlock();
+}
+
+int Lv2Instance::get_jitter_target_frames() {
+    return jitter.min_frames;
+}
+
+int Lv2Instance::get_output_latency_frames() {
+    uint64_t latency = 0;
+
+    io_mutex->lock();
+
+    for (int i = 0; i < OUTPUT_MAX_CONSUMERS; i++) {
+        if (output_consumers[i].used) {
+            latency = MAX(latency, output_write_position - output_consumers[i].position);
+        }
+    }
+
+    io_mutex->unlock();
+
+    return (int)latency;
+}
+
+Dictionary Lv2Instance::get_jitter_stats() {
+    Dictionary stats;
+
+    io_mutex->lock();
+
+    stats["target_frames"] = jitter.target_frames;
+    stats["min_frames"] = jitter.min_frames;
+    stats["max_frames"] = jitter.max_frames;
+    stats["underruns"] = jitter.underruns;
+    stats["grows"] = jitter.grows;
+    stats["shrinks"] = jitter.shrinks;
+    stats["input_underruns"] = jitter.input_underruns;
+    stats["input_overruns"] = jitter.input_overruns;
+
+    io_mutex->unlock();
+
+    stats["latency_frames"] = get_output_latency_frames();
+
+    return stats;
+}
+
+int Lv2Instance::process_sample(AudioFrame *p_buffer, float p_rate, int p_frames, uint64_t p_consumer) {
+    if (finished) {
+        return 0;
+    }
+
+    if (quarantined.load(std::memory_order_acquire)) {
+        std::memset(p_buffer, 0, p_frames * sizeof(AudioFrame));
+        return p_frames;
+    }
+
+    io_mutex->lock();
+
+    if (Time::get_singleton()) {
+        last_mix_time = Time::get_singleton()->get_ticks_usec();
+    }
+
+    int render_blocks = 1;
+
+    if (!initialized || output_channels.size() == 0) {
+        for (int frame = 0; frame < p_frames; frame++) {
+            p_buffer[frame].left = 0;
+            p_buffer[frame].right = 0;
+        }
+    } else {
+        int right = output_channels.size() > 1 ? 1 : 0;
+        render_blocks = read_output(p_buffer, NULL, 0, right, p_frames, 1.0f, p_consumer);
+    }
+
+    request_blocks(render_blocks);
+
+    io_mutex->unlock();
+
+    return p_frames;
+}
+
+void Lv2Instance::set_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right) {
+    if (quarantined.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    io_mutex->lock();
+
+    bool has_left_channel = left >= 0 && left < input_channels.size();
+    bool has_right_channel = right >= 0 && right < input_channels.size();
+
+    if (!has_left_channel && !has_right_channel) {
+        io_mutex->unlock();
+        return;
+    }
+
+    if (!write_deinterleaved(has_left_channel ? &input_channels[left] : NULL,
+                             has_right_channel ? &input_channels[right] : NULL, p_buffer, p_frames)) {
+        jitter.input_overruns++;
+    }
+
+    // TODO: does lv2 expect empty channels to be sent?
+
+    io_mutex->unlock();
+}
+
+int Lv2Instance::get_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right,
+                                    uint64_t p_consumer) {
+    return mix_channel_sample(p_buffer, NULL, 1.0f, p_frames, left, right, p_consumer);
+}
+
+int Lv2Instance::mix_channel_sample(AudioFrame *p_dst, const AudioFrame *p_dry, float p_mix, int p_frames, int left,
+                                    int right, uint64_t p_consumer) {
+    if (finished) {
+        return 0;
+    }
+
+    if (quarantined.load(std::memory_order_acquire)) {
+        read_interleaved(p_dst, p_dry, NULL, NULL, -1, p_frames, 1.0f - p_mix, p_mix);
+        return p_frames;
+    }
+
+    io_mutex->lock();
+
+    bool has_left_channel = left >= 0 && left < output_channels.size();
+    bool has_right_channel = right >= 0 && right < output_channels.size();
+
+    int render_blocks = 0;
+    if (active && (has_left_channel || has_right_channel)) {
+        render_blocks = read_output(p_dst, p_dry, has_left_channel ? left : -1, has_right_channel ? right : -1,
+                                    p_frames, p_mix, p_consumer);
+    } else {
+        read_interleaved(p_dst, p_dry, NULL, NULL, -1, p_frames, 1.0f - p_mix, p_mix);
+    }
+
+    request_blocks(render_blocks);
+
+    io_mutex->unlock();
+
+    return p_frames;
+}
+
+void Lv2Instance::program_select(int chan, int bank_num, int preset_num) {
+}
+
+void Lv2Instance::note_on(int midi_bus, int chan, int key, int vel) {
+    if (!initialized) {
+        return;
+    }
+
+    MidiEvent event;
+
+    // TODO: move the midi bit logic to a shared function
+    if (vel > 0) {
+        event.data[0] = (MIDIMessage::MIDI_MESSAGE_NOTE_ON << 4) | (chan & 0x0F);
+    } else {
+        event.data[0] = (MIDIMessage::MIDI_MESSAGE_NOTE_OFF << 4) | (chan & 0x0F);
+    }
+
+    event.data[1] = key;
+    event.data[2] = vel;
+
+    lv2_host->write_midi_in(midi_bus, event);
+}
+
+void Lv2Instance::note_off(int midi_bus, int chan, int key) {
+    if (!initialized) {
+        return;
+    }
+
+    MidiEvent event;
+    event.data[0] = (MIDIMessage::MIDI_MESSAGE_NOTE_OFF << 4) | (chan & 0x0F);
+    event.data[1] = key;
+    event.data[2] = 0;
+
+    lv2_host->write_midi_in(midi_bus, event);
+}
+
+void Lv2Instance::send_midi_event(int p_bus, const MidiEvent &p_event, uint64_t p_stamp_usec) {
+    if (!initialized) {
+        return;
+    }
+
+    MidiEvent event = p_event;
+    uint64_t block_usec = block_started_usec.load(std::memory_order_relaxed);
+    int64_t frame = 0;
+    if (block_usec > 0 && p_stamp_usec > block_usec) {
+        frame = (int64_t)((p_stamp_usec - block_usec) * mix_rate / 1000000.0);
+    }
+    event.frame = (int)CLAMP(frame, (int64_t)0, (int64_t)BUFFER_FRAME_SIZE - 1);
+
+    lv2_host->write_midi_in(p_bus, event);
+}
+
+void Lv2Instance::control_change(int midi_bus, int chan, int control, int value) {
+    if (!initialized) {
+        return;
+    }
+
+    MidiEvent event;
+    event.data[0] = (MIDIMessage::MIDI_MESSAGE_CONTROL_CHANGE << 4) | (chan & 0x0F);
+    event.data[1] = control;
+    event.data[2] = value;
+
+    lv2_host->write_midi_in(midi_bus, event);
+}
+
+int Lv2Instance::send_midi_packed(const PackedByteArray &p_events, const PackedInt32Array &p_frame_offsets,
+                                  int p_bus) {
+    if (!initialized) {
+        return 0;
+    }
+    ERR_FAIL_INDEX_V(p_bus, lv2_host->get_input_midi_count(), 0);
+
+    // decode and validate everything first so a malformed batch is refused as a whole
+    const uint8_t *bytes = p_events.ptr();
+    const int64_t size = p_events.size();
+    const int32_t *frames = p_frame_offsets.ptr();
+    std::vector<MidiEvent> events;
+    events.reserve(p_frame_offsets.is_empty() ? size / 2 : p_frame_offsets.size());
+
+    int64_t offset = 0;
+    while (offset < size) {
+        const uint8_t status = bytes[offset];
+        ERR_FAIL_COND_V_MSG(status < 0x80 || (status >= 0xf0 && status < 0xf8), 0,
+                            vformat("Expected a channel or realtime status byte at offset %d.", offset));
+
+        MidiEvent event;
+        event.size = 3;
+        if (status >= 0xf8) {
+            event.size = 1;
+        } else if ((status & 0xf0) == 0xc0 || (status & 0xf0) == 0xd0) {
+            event.size = 2;
+        }
+        ERR_FAIL_COND_V_MSG(offset + event.size > size, 0, vformat("Truncated MIDI event at offset %d.", offset));
+
+        memset(event.data, 0, sizeof(event.data));
+        event.data[0] = status;
+        for (int i = 1; i < event.size; i++) {
+            ERR_FAIL_COND_V_MSG(bytes[offset + i] >= 0x80, 0, vformat("Invalid data byte at offset %d.", offset + i));
+            event.data[i] = bytes[offset + i];
+        }
+
+        const int index = events.size();
+        ERR_FAIL_COND_V_MSG(!p_frame_offsets.is_empty() && index >= p_frame_offsets.size(), 0,
+                            "More MIDI events than frame offsets.");
+        event.frame = p_frame_offsets.is_empty() ? 0 : CLAMP(frames[index], 0, BUFFER_FRAME_SIZE - 1);
+
+        events.push_back(event);
+        offset += event.size;
+    }
+    ERR_FAIL_COND_V_MSG(!p_frame_offsets.is_empty() && (int64_t)events.size() != p_frame_offsets.size(), 0,
+                        "Fewer MIDI events than frame offsets.");
+
+    return lv2_host->write_midi_in_batch(p_bus, events.data(), events.size());
+}
+
+void Lv2Instance::send_input_control_channel(int p_channel, float p_value) {
+    if (!initialized) {
+        return;
+    }
+
+    lv2_host->set_input_control_value(p_channel, p_value);
+}
+
+void Lv2Instance::send_input_control_channel_at(int p_channel, float p_value, int p_frame) {
+    if (!initialized) {
+        return;
+    }
+
+    ControlEvent event;
+    event.frame = p_frame;
+    event.index = p_channel;
+    event.value = p_value;
+
+    lv2_host->write_control_in(event);
+}
+
+float Lv2Instance::get_input_control_channel(int p_channel) {
+    if (!initialized) {
+        return 0;
+    }
+
+    return lv2_host->get_input_control_value(p_channel);
+}
+
+void Lv2Instance::send_output_control_channel(int p_channel, float p_value) {
+    if (!initialized) {
+        return;
+    }
+
+    lv2_host->set_output_control_value(p_channel, p_value);
+}
+
+float Lv2Instance::get_output_control_channel(int p_channel) {
+    if (!initialized) {
+        return 0;
+    }
+
+    return lv2_host->get_output_control_value(p_channel);
+}
+
+void Lv2Instance::pitch_bend(int chan, int val) {
+}
+
+void Lv2Instance::thread_func() {
+    int p_frames = 512;
+    std::shared_ptr<std::atomic<bool>> abandoned = thread_abandoned;
+
+    if (lock_memory) {
+        lv2_prefault_stack(STACK_PREFAULT_BYTES);
+    }
+
+    while (!exit_thread) {
+        if (realtime_dirty.exchange(false, std::memory_order_acquire)) {
+            apply_realtime();
+        }
+
+        // parked until a reader asks for a block or the thread is stopped
+        if (!initialized) {
+            semaphore->wait();
+            continue;
+        }
+
+        last_mix_frames = p_frames;
+
+        if (graph_driver.load(std::memory_order_acquire) != NULL) {
+            // rendered by the driver of its routing group
+            semaphore->wait();
+            continue;
+        }
+
+        graph_mutex->lock();
+        if (!graph_nodes.empty()) {
+            if (!render_graph(p_frames, abandoned)) {
+                return;
+            }
+            graph_mutex->unlock();
+            semaphore->wait();
+            continue;
+        }
+        graph_mutex->unlock();
+
+        // held across the block so scripts can't reconfigure the plugin under it; the mix thread never takes it,
+        // it meets this thread on io_mutex at the block boundaries only
+        lock();
+
+        if (!render_block(p_frames, abandoned, NULL, NULL)) {
+            return;
+        }
+
+        unlock();
+
+        semaphore->wait();
+    }
+}
+
+bool Lv2Instance::render_block(int p_frames, const std::shared_ptr<std::atomic<bool>> &p_abandoned,
+                               const GraphNode *p_node, const GraphNode *p_nodes) {
+    Lv2PageFaults faults_before;
+    bool faults_sampled = page_faults.enabled && lv2_thread_page_faults(faults_before);
+
+    // never concurrently with run(), and ahead of the block so it isn't counted against the deadline
+    if (lv2_host->has_pending_restore() && !lv2_host->apply_pending_restore()) {
+        WARN_PRINT(vformat("Lv2Instance %s: plugin %s refused the restored state", instance_name, uri));
+    }
+
+    uint64_t block_start = Time::get_singleton()->get_ticks_usec();
+    block_started_usec.store(block_start, std::memory_order_relaxed);
+
+    float volume = godot::UtilityFunctions::db_to_linear(volume_db);
+
+    if (Lv2Server::get_singleton()->get_solo_mode()) {
+        if (!solo) {
+            volume = 0.0;
+        }
+    } else {
+        if (mute) {
+            volume = 0.0;
+        }
+    }
+
+    float channel_peak[METER_MAX_CHANNELS] = {};
+    float channel_rms[METER_MAX_CHANNELS] = {};
+    float channel_true_peak[METER_MAX_CHANNELS] = {};
+    int meter_channels = MIN((int)output_channels.size(), METER_MAX_CHANNELS);
+
+    // the mix thread writes the input rings and sets the deadlines under io_mutex, taken here only to pick up
+    // their state; the plugin then reads straight from the input rings and renders straight into the output
+    // rings, perform() splits the run where a ring wraps
+    io_mutex->lock();
+
+    // boosts change the calling thread, which inside a routing group belongs to the driver
+    int64_t due = deadline.enabled && p_node == NULL ? get_block_deadline_usec(output_write_position) : -1;
+
+    for (int channel = 0; channel < input_channels.size(); channel++) {
+        if (p_node != NULL && channel < GRAPH_MAX_PORTS && (p_node->routed_inputs & (1ull << channel))) {
+            continue;
+        }
+        Lv2RingSpan<float> span = input_channels[channel].peek(p_frames);
+        if (span.first_frames + span.second_frames < p_frames) {
+            // starved, feed silence from the host's own buffer
+            if (channel == 0) {
+                jitter.input_underruns++;
+            }
+            span = Lv2RingSpan<float>();
+            span.first = lv2_host->get_input_channel_buffer(channel);
+            span.first_frames = p_frames;
+            std::memset(span.first, 0, p_frames * sizeof(float));
+        }
+        input_spans[channel] = span;
+        lv2_host->bind_input_channel(channel, span.first, span.first_frames,
+                                     span.second_frames > 0 ? span.second : NULL);
+    }
+
+    io_mutex->unlock();
+
+    if (due >= 0) {
+        update_deadline_boost(due);
+    }
+
+    Lv2Host *tail = get_slot_host(rack.size() - 1);
+    for (int channel = 0; channel < output_channels.size(); channel++) {
+        Lv2RingSpan<float> span = output_channels[channel].buffer.reserve(p_frames);
+        output_spans[channel] = span;
+        tail->bind_output_channel(channel, span.first, span.first_frames,
+                                  span.second_frames > 0 ? span.second : NULL);
+    }
+
+    if (p_node != NULL) {
+        bind_graph_inputs(*p_node, p_nodes, p_frames);
+    }
+
+    modulation.process(lv2_host, p_frames, mix_rate);
+    midi_player.process(lv2_host, p_frames, mix_rate);
+
+    // governor degradation: mute, bypass once crossfaded out, or skip blocks while input and output stay silent
+    int degrade = degrade_level.load(std::memory_order_relaxed);
+    if (degrade < DEGRADE_BYPASS && applied_degrade_level >= DEGRADE_BYPASS) {
+        // note offs dropped while the plugin wasn't running would leave notes hanging
+        lv2_host->release_notes();
+    }
+    applied_degrade_level = degrade;
+
+    bool inputs_silent = false;
+    if (degrade >= DEGRADE_SKIP_TAILS) {
+        inputs_silent = !lv2_host->has_pending_events() && modulation.is_empty() && midi_player.is_idle();
+        for (int channel = 0; channel < input_channels.size() && inputs_silent; channel++) {
+            float peak, sum_squares;
+            span_peak_sum_squares(input_spans[channel], peak, sum_squares);
+            inputs_silent = peak < GOVERNOR_SILENCE;
+        }
+        silent_blocks = inputs_silent ? silent_blocks : 0;
+    } else {
+        silent_blocks = 0;
+    }
+
+    bool governor_muted = degrade >= DEGRADE_MUTE;
+    bool governor_bypassed = degrade >= DEGRADE_BYPASS && governor_bypass_fade >= 1.0f;
+    bool tail_skipped = degrade >= DEGRADE_SKIP_TAILS && silent_blocks >= GOVERNOR_TAIL_BLOCKS;
+    bool run_plugin = !governor_muted && !governor_bypassed && !tail_skipped;
+
+    if (run_plugin) {
+        // a group's driver keeps the watchdog running for every member while it holds them
+        if (p_node == NULL) {
+            Lv2Server::get_singleton()->watch_block();
+            perform_started_usec.store(block_start, std::memory_order_release);
+        }
+        int result = perform_rack(p_frames, p_abandoned);
+        if (p_abandoned != nullptr && p_abandoned->load(std::memory_order_acquire)) {
+            // given up on while the plugin was stuck, nothing but locals may be touched from here on
+            return false;
+        }
+        if (p_node == NULL) {
+            perform_started_usec.store(0, std::memory_order_release);
+        }
+        if (result == 0) {
+            finished = true;
+        }
+
+        uint32_t restarts = lv2_host->get_remote_restarts();
+        if (restarts != remote_restarts_seen) {
+            remote_restarts_seen = restarts;
+            call_deferred("emit_signal", "plugin_restarted", instance_name, (int64_t)restarts);
+        }
+
+        uint32_t learned = midi_map.get_learned_count();
+        if (learned != midi_learned_seen) {
+            midi_learned_seen = learned;
+            call_deferred("emit_signal", "midi_learned", instance_name, (int64_t)midi_map.get_last_learned());
+        }
+
+        float fade_target = degrade >= DEGRADE_BYPASS ? 1.0f : 0.0f;
+        if (governor_bypass_fade != fade_target) {
+            for (int channel = 0; channel < output_channels.size(); channel++) {
+                const Lv2RingSpan<float> *dry = channel < input_channels.size() ? &input_spans[channel] : NULL;
+                crossfade_span(output_spans[channel], dry, governor_bypass_fade, fade_target, p_frames);
+            }
+            governor_bypass_fade = fade_target;
+        }
+    } else {
+        skip_rack(p_frames);
+
+        if (governor_muted || !governor_bypassed) {
+            for (int channel = 0; channel < output_channels.size(); channel++) {
+                silence_span(output_spans[channel]);
+            }
+        }
+    }
+
+    float block_peak = 0.0f;
+
+    if (!governor_muted && (bypass || governor_bypassed)) {
+        for (int channel = 0; channel < output_channels.size(); channel++) {
+            if (channel < input_channels.size()) {
+                copy_span(output_spans[channel], input_spans[channel], p_frames);
+            } else {
+                silence_span(output_spans[channel]);
+            }
+        }
+    } else {
+        for (int channel = 0; channel < output_channels.size(); channel++) {
+            const Lv2RingSpan<float> &output = output_spans[channel];
+
+            if (channel < meter_channels) {
+                float peak, sum_squares;
+                span_peak_sum_squares(output, peak, sum_squares);
+                block_peak = MAX(block_peak, peak);
+                channel_peak[channel] = peak * volume;
+                channel_rms[channel] = Math::sqrt(sum_squares / p_frames) * volume;
+                channel_true_peak[channel] = channel_peak[channel];
+
+                if (true_peak_enabled) {
+                    float true_peak = span_true_peak(output, true_peak_history.data() + channel * TRUE_PEAK_HISTORY,
+                                                     true_peak_scratch.data());
+                    channel_true_peak[channel] = MAX(true_peak * volume, channel_peak[channel]);
+                }
+            }
+
+            if (volume != 1.0f) {
+                scale_span(output, volume);
+            }
+        }
+    }
+
+    if (degrade >= DEGRADE_SKIP_TAILS) {
+        silent_blocks = inputs_silent && block_peak < GOVERNOR_SILENCE ? silent_blocks + 1 : 0;
+    }
+
+    collect_midi_output(output_write_position);
+
+    uint64_t block_end = Time::get_singleton()->get_ticks_usec();
+    busy_usec.fetch_add(block_end - block_start, std::memory_order_relaxed);
+
+    // hand the block over to the readers
+    io_mutex->lock();
+    for (int channel = 0; channel < input_channels.size(); channel++) {
+        input_channels[channel].update_read_index(p_frames);
+    }
+    for (int channel = 0; channel < output_channels.size(); channel++) {
+        output_channels[channel].buffer.commit(p_frames);
+    }
+    record_deadline(output_write_position, block_end, (double)(block_end - block_start));
+    output_write_position += p_frames;
+    io_mutex->unlock();
+
+    output_control_seqlock.write_begin();
+    int output_control_total = output_control_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < output_control_total; i++) {
+        output_control_values[i] = lv2_host->get_output_control_value(i);
+    }
+    output_control_seqlock.write_end();
+
+    float level = 0;
+    meter_seqlock.write_begin();
+    meter.channels = meter_channels;
+    for (int channel = 0; channel < meter_channels; channel++) {
+        meter.peak_db[channel] = Math::linear_to_db(channel_peak[channel] + AUDIO_PEAK_OFFSET);
+        meter.rms_db[channel] = Math::linear_to_db(channel_rms[channel] + AUDIO_PEAK_OFFSET);
+        meter.true_peak_db[channel] = Math::linear_to_db(channel_true_peak[channel] + AUDIO_PEAK_OFFSET);
+        meter.active[channel] = channel_peak[channel] > 0;
+        level = MAX(level, channel_peak[channel]);
+    }
+    meter_seqlock.write_end();
+    output_level->store(level, std::memory_order_relaxed);
+
+    Lv2PageFaults faults_after;
+    if (faults_sampled && lv2_thread_page_faults(faults_after)) {
+        uint32_t minor = (uint32_t)(faults_after.minor - faults_before.minor);
+        uint32_t major = (uint32_t)(faults_after.major - faults_before.major);
+        page_faults.blocks++;
+        page_faults.faulting_blocks += (minor + major) > 0 ? 1 : 0;
+        page_faults.minor += minor;
+        page_faults.major += major;
+        page_faults.last_minor = minor;
+        page_faults.last_major = major;
+        page_faults.max_minor = MAX(page_faults.max_minor, minor);
+        page_faults.max_major = MAX(page_faults.max_major, major);
+    }
+
+    return true;
+}
+
+bool Lv2Instance::render_graph(int p_frames, const std::shared_ptr<std::atomic<bool>> &p_abandoned) {
+    // every member stays locked until the whole group is rendered: later members read straight from the output
+    // rings of earlier ones, which must not be reconfigured in between
+    uint64_t started = Time::get_singleton()->get_ticks_usec();
+    bool needed = false;
+
+    Lv2Server::get_singleton()->watch_block();
+
+    for (GraphNode &node : graph_nodes) {
+        Lv2Instance *member = node.instance;
+        node.rendered = false;
+        node.held = NULL;
+        node.output_count = 0;
+
+        if (member->quarantined.load(std::memory_order_acquire)) {
+            continue;
+        }
+        member->mutex->lock();
+        node.held = member->mutex.ptr();
+        node.abandoned = member == this ? p_abandoned : member->thread_abandoned;
+        member->perform_started_usec.store(started, std::memory_order_release);
+
+        // every reader of every member asks the driver, a block is rendered once at least one of them needs it
+        member->io_mutex->lock();
+        if (member->initialized && member->output_render_position > member->output_write_position) {
+            needed = true;
+        }
+        member->io_mutex->unlock();
+    }
+
+    for (int i = 0; i < graph_nodes.size() && needed; i++) {
+        GraphNode &node = graph_nodes[i];
+        Lv2Instance *member = node.instance;
+        if (node.held == NULL || !member->initialized) {
+            continue;
+        }
+
+        member->last_mix_frames = p_frames;
+        if (!member->render_block(p_frames, node.abandoned, &node, graph_nodes.data())) {
+            // the member was given up on, its old mutex stays with its abandoned state
+            node.held = NULL;
+        } else {
+            node.rendered = true;
+            node.output_count = MIN((int)member->output_spans.size(), GRAPH_MAX_PORTS);
+            for (int channel = 0; channel < node.output_count; channel++) {
+                node.outputs[channel] = member->output_spans[channel];
+            }
+        }
+
+        if (p_abandoned->load(std::memory_order_acquire)) {
+            // this instance was given up on while a member was stuck, let the others go
+            for (GraphNode &other : graph_nodes) {
+                if (other.instance != this && other.held != NULL) {
+                    other.instance->perform_started_usec.store(0, std::memory_order_release);
+                    other.held->unlock();
+                }
+            }
+            graph_mutex->unlock();
+            return false;
+        }
+    }
+
+    release_graph();
+    return true;
+}
+
+void Lv2Instance::release_graph() {
+    for (GraphNode &node : graph_nodes) {
+        if (node.held != NULL) {
+            node.instance->perform_started_usec.store(0, std::memory_order_release);
+            node.held->unlock();
+            node.held = NULL;
+        }
+    }
+}
+
+void Lv2Instance::bind_graph_inputs(const GraphNode &p_node, const GraphNode *p_nodes, int p_frames) {
+    for (int channel = 0; channel < input_channels.size() && channel < GRAPH_MAX_PORTS; channel++) {
+        if (!(p_node.routed_inputs & (1ull << channel))) {
+            continue;
+        }
+
+        // a single source is read in place, several are summed into the host's own buffer
+        Lv2RingSpan<float> span;
+        float *mix = lv2_host->get_input_channel_buffer(channel);
+        int sources = 0;
+        for (const GraphRoute &route : p_node.routes) {
+            if (route.midi || route.to_port != channel) {
+                continue;
+            }
+            const GraphNode &source = p_nodes[route.source];
+            if (!source.rendered || route.from_port >= source.output_count) {
+                continue;
+            }
+            const Lv2RingSpan<float> &output = source.outputs[route.from_port];
+            if (sources == 0) {
+                span = output;
+            } else {
+                if (sources == 1) {
+                    Lv2RingSpan<float> first = span;
+                    span = Lv2RingSpan<float>();
+                    span.first = mix;
+                    span.first_frames = p_frames;
+                    copy_span(span, first, p_frames);
+                }
+                add_span(mix, output, p_frames);
+            }
+            sources++;
+        }
+
+        if (sources == 0) {
+            span = Lv2RingSpan<float>();
+            span.first = mix;
+            span.first_frames = p_frames;
+            std::memset(mix, 0, p_frames * sizeof(float));
+        }
+
+        input_spans[channel] = span;
+        lv2_host->bind_input_channel(channel, span.first, span.first_frames,
+                                     span.second_frames > 0 ? span.second : NULL);
+    }
+
+    for (const GraphRoute &route : p_node.routes) {
+        if (!route.midi || !p_nodes[route.source].rendered) {
+            continue;
+        }
+        for (const GraphMidiEvent &event : p_nodes[route.source].instance->block_midi_out) {
+            if (event.bus == route.from_port) {
+                lv2_host->queue_midi_event(route.to_port, event.event);
+            }
+        }
+    }
+}
+
+void Lv2Instance::collect_midi_output(uint64_t p_position) {
+    // drained once per block for both readers: routes to other instances and scripts
+    block_midi_out.clear();
+
+    uint64_t read = midi_out_read.load(std::memory_order_acquire);
+    uint64_t written = midi_out_written.load(std::memory_order_relaxed);
+
+    GraphMidiEvent event;
+    for (int bus = 0; bus < lv2_host->get_output_midi_count(); bus++) {
+        event.bus = bus;
+        while (lv2_host->read_midi_out(bus, event.event)) {
+            if (block_midi_out.size() < block_midi_out.capacity()) {
+                block_midi_out.push_back(event);
+            }
+
+            if (written - read >= midi_out_queue.size()) {
+                read = midi_out_read.load(std::memory_order_acquire);
+                if (written - read >= midi_out_queue.size()) {
+                    midi_out_dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+            }
+            MidiOutRecord &record = midi_out_queue[written & (midi_out_queue.size() - 1)];
+            record.position = p_position + MAX(event.event.frame, 0);
+            record.bus = bus;
+            record.event = event.event;
+            written++;
+        }
+    }
+
+    midi_out_written.store(written, std::memory_order_release);
+}
+
+void Lv2Instance::request_blocks(int p_blocks) {
+    // called with io_mutex held: Lv2Server::update_graph() changes graph_driver under it before an instance that
+    // was a driver can go away
+    Lv2Instance *driver = graph_driver.load(std::memory_order_acquire);
+    Semaphore *target = driver != NULL ? driver->semaphore.ptr() : semaphore.ptr();
+    for (int i = 0; i < p_blocks; i++) {
+        target->post();
+    }
+}
+
+Error Lv2Instance::start_thread() {
+    if (thread.is_null()) {
+        thread.instantiate();
+        exit_thread = false;
+        realtime_dirty = true;
+        thread_abandoned = std::make_shared<std::atomic<bool>>(false);
+        thread_mutex.store(mutex.ptr(), std::memory_order_release);
+        thread->start(callable_mp(this, &Lv2Instance::thread_func), Thread::PRIORITY_HIGH);
+    }
+    return (Error)OK;
+}
+
+void Lv2Instance::stop_thread() {
+    if (thread.is_valid()) {
+        exit_thread = true;
+        semaphore->post();
+        // a plugin stuck in run() would never let the thread finish, give up on it once it overruns the watchdog
+        while (thread->is_alive()) {
+            if (check_watchdog()) {
+                abandon_thread();
+                return;
+            }
+            OS::get_singleton()->delay_usec(WATCHDOG_POLL_USEC);
+        }
+        thread->wait_to_finish();
+        thread_mutex.store(NULL, std::memory_order_release);
+        thread.unref();
+    }
+
+    // a member of a routing group is rendered on its driver's thread: wait for that thread to leave it
+    // (initialized is already false, it won't come back) or give up on the plugin it is stuck in
+    if (graph_driver.load(std::memory_order_acquire) != NULL) {
+        while (!mutex->try_lock()) {
+            if (check_watchdog()) {
+                abandon_thread();
+                return;
+            }
+            OS::get_singleton()->delay_usec(WATCHDOG_POLL_USEC);
+        }
+        mutex->unlock();
+    }
+}
+
+bool Lv2Instance::check_watchdog() {
+    uint64_t started = perform_started_usec.load(std::memory_order_acquire);
+    if (started == 0) {
+        return false;
+    }
+
+    uint64_t stalled = Time::get_singleton()->get_ticks_usec() - started;
+    if (stalled < (uint64_t)(watchdog_blocks * BUFFER_FRAME_SIZE * 1000000.0 / mix_rate)) {
+        return false;
+    }
+
+    if (!quarantined.exchange(true, std::memory_order_acq_rel)) {
+        hang_count++;
+        call_deferred("emit_signal", "plugin_hung", instance_name, (int64_t)stalled);
+    }
+    return true;
+}
+
+bool Lv2Instance::lock_watched() {
+    Mutex *held = thread_mutex.load(std::memory_order_acquire);
+    if (held == NULL) {
+        return true;
+    }
+
+    // polls instead of blocking so a plugin hanging in perform() (with the mutex held) can't take the caller along
+    while (!held->try_lock()) {
+        if (quarantined.load(std::memory_order_acquire) || check_watchdog()) {
+            return false;
+        }
+        OS::get_singleton()->delay_usec(WATCHDOG_POLL_USEC);
+    }
+
+    if (quarantined.load(std::memory_order_acquire)) {
+        held->unlock();
+        return false;
+    }
+    return true;
+}
+
+void Lv2Instance::abandon_thread() {
+    // the thread can't be stopped, so it keeps its mutex, its plugin and every buffer the plugin was given;
+    // this instance carries on with fresh ones
+    AbandonedThread *abandoned = new AbandonedThread;
+    abandoned->thread = thread;
+    abandoned->mutex = mutex;
+    abandoned->semaphore = semaphore;
+    abandoned->lv2_host = lv2_host;
+    for (int slot = 1; slot < rack.size(); slot++) {
+        abandoned->rack_hosts.push_back(rack[slot].host);
+        rack[slot].host = NULL;
+    }
+    thread_abandoned->store(true, std::memory_order_release);
+
+    WARN_PRINT(vformat("Lv2Instance %s: plugin %s never returned from run(), abandoning its thread", instance_name,
+                       uri));
+
+    memory_lock.clear();
+
+    // the stuck thread is inside run() and never holds io_mutex there, the mix thread is kept out of the swap
+    io_mutex->lock();
+    abandoned->ring_arena = std::move(ring_arena);
+    abandoned->input_channels = std::move(input_channels);
+    abandoned->output_channels = std::move(output_channels);
+    ring_arena.clear();
+    ring_memory = NULL;
+    ring_floats = 0;
+    input_channels.clear();
+    output_channels.clear();
+    input_spans.clear();
+    output_spans.clear();
+    reset_output_consumers();
+
+    thread_mutex.store(NULL, std::memory_order_release);
+    thread.unref();
+    mutex.instantiate();
+    semaphore.instantiate();
+    io_mutex->unlock();
+    perform_started_usec = 0;
+    initialized = false;
+
+    create_host(abandoned->lv2_host->get_min_sub_block());
+}
+
+void Lv2Instance::lock() {
+    Mutex *held = thread_mutex.load(std::memory_order_acquire);
+    if (held == NULL) {
+        return;
+    }
+    held->lock();
+}
+
+void Lv2Instance::unlock() {
+    Mutex *held = thread_mutex.load(std::memory_order_acquire);
+    if (held == NULL) {
+        return;
+    }
+    held->unlock();
+}
+
+void Lv2Instance::set_watchdog_blocks(int p_blocks) {
+    ERR_FAIL_COND(p_blocks < 1);
+    watchdog_blocks = p_blocks;
+    if (lv2_host != NULL) {
+        lv2_host->set_remote_timeout_usec(get_remote_timeout_usec());
+    }
+}
+
+int Lv2Instance::get_watchdog_blocks() {
+    return watchdog_blocks;
+}
+
+bool Lv2Instance::is_quarantined() {
+    return quarantined.load(std::memory_order_acquire);
+}
+
+int Lv2Instance::get_hang_count() {
+    return hang_count;
+}
+
+void Lv2Instance::recover() {
+    // reloads the plugin from scratch (its state is lost, restore_state() can bring back a saved one); a thread
+    // still stuck in run() is abandoned by stop_thread()
+    reset();
+    quarantined = false;
+    perform_started_usec = 0;
+    if (uri.length() > 0) {
+        configure();
+        start();
+    }
+}
+
+Lv2Instance::LoadingPolicy Lv2Instance::get_loading_policy() {
+    return (LoadingPolicy)loading_policy;
+}
+
+Lv2Instance::LoadingPolicy Lv2Instance::get_effective_loading_policy() {
+    return (LoadingPolicy)effective_loading_policy;
+}
+
+bool Lv2Instance::is_out_of_process() {
+    return effective_loading_policy == LOADING_POLICY_OUT_OF_PROCESS;
+}
+
+Dictionary Lv2Instance::get_remote_stats() {
+    Dictionary result;
+    result["enabled"] = loading_policy == LOADING_POLICY_OUT_OF_PROCESS;
+    if (lv2_host == NULL || !lv2_host->is_remote()) {
+        result["running"] = false;
+        return result;
+    }
+
+    // the link is thread safe, no need to hold up the instance thread
+    Lv2RemoteStats stats = lv2_host->get_remote_stats();
+    result["running"] = stats.running;
+    result["pid"] = stats.pid;
+    result["restarts"] = stats.restarts;
+    result["failures"] = stats.failures;
+    result["last_exit_status"] = stats.last_exit_status;
+    result["round_trips"] = (int64_t)stats.round_trips;
+    result["mean_round_trip_usec"] = stats.mean_round_trip_usec;
+    result["max_round_trip_usec"] = stats.max_round_trip_usec;
+    result["snapshot_bytes"] = (int64_t)stats.snapshot_bytes;
+    result["error"] = String(stats.error.c_str());
+    return result;
+}
+
+PackedByteArray Lv2Instance::drain_midi_output(int p_max_events) {
+    PackedByteArray result;
+
+    // the instance thread only ever writes past midi_out_read, so the records below stay put while they are
+    // copied; concurrent drains race for them and the loser copies again
+    while (true) {
+        uint64_t read = midi_out_read.load(std::memory_order_acquire);
+        uint64_t written = midi_out_written.load(std::memory_order_acquire);
+        uint64_t count = written - read;
+        if (p_max_events >= 0) {
+            count = MIN(count, (uint64_t)p_max_events);
+        }
+
+        result.resize(count * MIDI_OUT_RECORD_BYTES);
+        uint8_t *bytes = result.ptrw();
+        for (uint64_t i = 0; i < count; i++) {
+            const MidiOutRecord &record = midi_out_queue[(read + i) & (midi_out_queue.size() - 1)];
+            uint8_t *out = bytes + i * MIDI_OUT_RECORD_BYTES;
+            std::memset(out, 0, MIDI_OUT_RECORD_BYTES);
+            int64_t position = (int64_t)record.position;
+            std::memcpy(out, &position, sizeof(position));
+            out[8] = (uint8_t)record.bus;
+            out[9] = (uint8_t)CLAMP(record.event.size, 0, (int)MidiEvent::DATA_SIZE);
+            std::memcpy(out + 10, record.event.data, MidiEvent::DATA_SIZE);
+        }
+
+        if (midi_out_read.compare_exchange_weak(read, read + count, std::memory_order_acq_rel)) {
+            return result;
+        }
+    }
+}
+
+int Lv2Instance::get_midi_output_dropped() {
+    return midi_out_dropped.load(std::memory_order_relaxed);
+}
+
+int Lv2Instance::get_control_events_dropped() {
+    return lv2_host != NULL ? (int)lv2_host->get_control_events_dropped() : 0;
+}
+
+int Lv2Instance::get_midi_input_dropped() {
+    return lv2_host != NULL ? (int)lv2_host->get_midi_events_dropped() : 0;
+}
+
+void Lv2Instance::set_rack(const PackedStringArray &p_uris) {
+    reset();
+    assign_rack(p_uris);
+
+    if (uri.length() > 0) {
+        configure();
+        start();
+    }
+}
+
+void Lv2Instance::assign_rack(const PackedStringArray &p_uris) {
+    lock();
+    memory_lock.clear();
+    clear_rack();
+
+    std::vector<RackSlot> slots(p_uris.size() + 1);
+    slots[0] = rack[0];
+    for (int slot = 1; slot < slots.size(); slot++) {
+        slots[slot].uri = p_uris[slot - 1];
+        // a plugin staying in its slot stays bypassed
+        if (slot < rack.size() && rack[slot].uri == slots[slot].uri) {
+            slots[slot].bypass = rack[slot].bypass;
+        }
+    }
+    rack.swap(slots);
+    unlock();
+}
+
+PackedStringArray Lv2Instance::get_rack() {
+    PackedStringArray result;
+    for (int slot = 1; slot < rack.size(); slot++) {
+        result.push_back(rack[slot].uri);
+    }
+    return result;
+}
+
+int Lv2Instance::get_slot_count() {
+    return rack.size();
+}
+
+void Lv2Instance::set_slot_bypass(int p_slot, bool p_bypass) {
+    ERR_FAIL_INDEX(p_slot, (int)rack.size());
+
+    lock();
+    if (p_slot == 0 && rack[0].bypass && !p_bypass && lv2_host != NULL) {
+        // note offs dropped while the plugin wasn't running would leave notes hanging
+        lv2_host->release_notes();
+    }
+    rack[p_slot].bypass = p_bypass;
+    unlock();
+}
+
+bool Lv2Instance::is_slot_bypassed(int p_slot) {
+    ERR_FAIL_INDEX_V(p_slot, (int)rack.size(), false);
+    return rack[p_slot].bypass;
+}
+
+void Lv2Instance::set_slot_control_value(int p_slot, int p_index, float p_value) {
+    ERR_FAIL_INDEX(p_slot, (int)rack.size());
+    if (!initialized) {
         return;
     }
 
-    MidiEvent event;
-    event.data[0] = (MIDIMessage::MIDI_MESSAGE_NOTE_OFF << 4) | (chan & 0x0F);
-    event.data[1] = key;
-    event.data[2] = 0;
+    Lv2Host *host = get_slot_host(p_slot);
+    ERR_FAIL_INDEX(p_index, host->get_input_control_count());
+    host->set_input_control_value(p_index, p_value);
+}
+
+float Lv2Instance::get_slot_control_value(int p_slot, int p_index) {
+    ERR_FAIL_INDEX_V(p_slot, (int)rack.size(), 0);
+    if (!initialized) {
+        return 0;
+    }
+
+    Lv2Host *host = get_slot_host(p_slot);
+    ERR_FAIL_INDEX_V(p_index, host->get_input_control_count(), 0);
+    return host->get_input_control_value(p_index);
+}
+
+Dictionary Lv2Instance::get_slot_stats(int p_slot) {
+    ERR_FAIL_INDEX_V(p_slot, (int)rack.size(), Dictionary());
+
+    lock();
+    RackSlot slot = rack[p_slot];
+    Lv2Host *host = get_slot_host(p_slot);
+    PackedStringArray controls;
+    int input_count = 0;
+    int output_count = 0;
+    if (host != NULL) {
+        for (int i = 0; i < host->get_input_control_count(); i++) {
+            controls.push_back(String(host->get_input_control(i)->symbol.c_str()));
+        }
+        input_count = host->get_input_channel_count();
+        output_count = host->get_output_channel_count();
+    }
+    unlock();
+
+    Dictionary result;
+    result["uri"] = p_slot == 0 ? uri : slot.uri;
+    result["bypass"] = slot.bypass;
+    result["runs"] = (int64_t)slot.runs;
+    result["bypassed_blocks"] = (int64_t)slot.bypassed_blocks;
+    result["mean_usec"] = slot.runs > 0 ? slot.total_usec / slot.runs : 0.0;
+    result["max_usec"] = slot.max_usec;
+    result["last_usec"] = slot.last_usec;
+    result["input_channels"] = input_count;
+    result["output_channels"] = output_count;
+    result["controls"] = controls;
+    return result;
+}
+
+void Lv2Instance::reset_slot_stats() {
+    lock();
+    for (RackSlot &slot : rack) {
+        slot.runs = 0;
+        slot.bypassed_blocks = 0;
+        slot.total_usec = 0.0;
+        slot.max_usec = 0.0;
+        slot.last_usec = 0.0;
+    }
+    unlock();
+}
+
+void Lv2Instance::initialize() {
+    if (uri.length() > 0) {
+        configure();
+        start();
+    }
+}
+
+void Lv2Instance::set_instance_name(const String &name) {
+    instance_name = name;
+}
+
+const String &Lv2Instance::get_instance_name() {
+    return instance_name;
+}
+
+void Lv2Instance::set_uri(const String &p_uri) {
+    reset();
+    uri = p_uri;
+    configure();
+    start();
+}
+
+int Lv2Instance::get_input_channel_count() {
+    if (lv2_host != NULL) {
+        return lv2_host->get_input_channel_count();
+    } else {
+        return 0;
+    }
+}
+
+int Lv2Instance::get_output_channel_count() {
+    if (lv2_host != NULL) {
+        Lv2Host *tail = get_slot_host(rack.size() - 1);
+        return tail != NULL ? tail->get_output_channel_count() : 0;
+    } else {
+        return 0;
+    }
+}
+
+int Lv2Instance::get_input_midi_count() {
+    if (lv2_host != NULL) {
+        return lv2_host->get_input_midi_count();
+    } else {
+        return 0;
+    }
+}
+
+int Lv2Instance::get_output_midi_count() {
+    if (lv2_host != NULL) {
+        return lv2_host->get_output_midi_count();
+    } else {
+        return 0;
+    }
+}
+
+TypedArray<Lv2Control> Lv2Instance::get_input_controls() {
+    return input_controls;
+}
+
+TypedArray<Lv2Control> Lv2Instance::get_output_controls() {
+    return output_controls;
+}
+
+int Lv2Instance::resolve_control(const String &p_symbol) {
+    HashMap<String, int>::ConstIterator it = input_control_map.find(p_symbol);
+    return it ? it->value : -1;
+}
+
+int Lv2Instance::resolve_output_control(const String &p_symbol) {
+    HashMap<String, int>::ConstIterator it = output_control_map.find(p_symbol);
+    return it ? it->value : -1;
+}
+
+PackedFloat32Array Lv2Instance::get_output_controls_packed() {
+    PackedFloat32Array result;
+
+    uint32_t sequence;
+    do {
+        sequence = output_control_seqlock.read_begin();
+        int count = output_control_count.load(std::memory_order_relaxed);
+        if (result.size() != count) {
+            result.resize(count);
+        }
+        memcpy(result.ptrw(), output_control_values.data(), count * sizeof(float));
+    } while (output_control_seqlock.read_retry(sequence));
+
+    return result;
+}
+
+int Lv2Instance::set_input_controls_packed(const PackedInt32Array &p_indices, const PackedFloat32Array &p_values) {
+    ERR_FAIL_COND_V(p_indices.size() != p_values.size(), 0);
+
+    if (!initialized) {
+        return 0;
+    }
+
+    const int32_t *indices = p_indices.ptr();
+    const float *values = p_values.ptr();
+    int count = lv2_host->get_input_control_count();
+    int written = 0;
+
+    for (int i = 0; i < p_indices.size(); i++) {
+        if (indices[i] >= 0 && indices[i] < count) {
+            lv2_host->set_input_control_value(indices[i], values[i]);
+            written++;
+        }
+    }
+
+    return written;
+}
+
+TypedArray<String> Lv2Instance::get_presets() {
+    return presets;
+}
+
+void Lv2Instance::load_preset(String p_preset) {
+    lv2_host->load_preset(std::string(p_preset.ascii()));
+}
+
+MeterSnapshot Lv2Instance::get_meter_snapshot() const {
+    MeterSnapshot snapshot;
+    uint32_t sequence;
+    do {
+        sequence = meter_seqlock.read_begin();
+        snapshot = meter;
+    } while (meter_seqlock.read_retry(sequence));
+    return snapshot;
+}
+
+void Lv2Instance::set_true_peak_enabled(bool p_enabled) {
+    true_peak_enabled = p_enabled;
+}
+
+bool Lv2Instance::is_true_peak_enabled() {
+    return true_peak_enabled;
+}
+
+int Lv2Instance::add_modulation_lfo(LfoShape p_shape, float p_rate_hz) {
+    lock();
+    int source = modulation.add_lfo((ModulationLfoShape)p_shape, p_rate_hz);
+    unlock();
+    return source;
+}
+
+int Lv2Instance::add_modulation_envelope(float p_attack, float p_decay, float p_sustain, float p_release) {
+    lock();
+    int source = modulation.add_envelope(p_attack, p_decay, p_sustain, p_release);
+    unlock();
+    return source;
+}
+
+int Lv2Instance::add_modulation_curve(const Ref<Curve> &p_curve, float p_duration, bool p_loop) {
+    ERR_FAIL_COND_V(p_curve.is_null(), -1);
+
+    // bake on the calling thread so the DSP thread only does a table lookup
+    std::vector<float> table(MODULATION_CURVE_TABLE_SIZE);
+    float min_domain = p_curve->get_min_domain();
+    float max_domain = p_curve->get_max_domain();
+    float min_value = p_curve->get_min_value();
+    float value_range = MAX(p_curve->get_max_value() - min_value, 0.0001f);
+
+    for (int i = 0; i < MODULATION_CURVE_TABLE_SIZE; i++) {
+        float offset = min_domain + (max_domain - min_domain) * i / (MODULATION_CURVE_TABLE_SIZE - 1);
+        table[i] = CLAMP((p_curve->sample_baked(offset) - min_value) / value_range, 0.0f, 1.0f);
+    }
+
+    lock();
+    int source = modulation.add_curve(table, p_duration, p_loop);
+    unlock();
+    return source;
+}
+
+int Lv2Instance::add_modulation_follower(const String &p_instance_name, float p_attack, float p_release) {
+    Lv2Instance *instance = Lv2Server::get_singleton()->get_instance(p_instance_name);
+    ERR_FAIL_NULL_V_MSG(instance, -1, "Unknown lv2 instance: " + p_instance_name);
+
+    lock();
+    int source = modulation.add_follower(instance->output_level, p_attack, p_release);
+    unlock();
+    return source;
+}
+
+int Lv2Instance::add_modulation_route(int p_source, int p_control, float p_min, float p_max) {
+    ERR_FAIL_COND_V_MSG(lv2_host == NULL, -1, "The plugin is not loaded yet.");
+    ERR_FAIL_INDEX_V(p_control, lv2_host->get_input_control_count(), -1);
+
+    std::string symbol = lv2_host->get_input_control(p_control)->symbol;
+
+    lock();
+    int route = modulation.add_route(p_source, symbol, p_control, p_min, p_max);
+    reserve_modulation_events();
+    unlock();
+    return route;
+}
+
+void Lv2Instance::set_modulation_gate(int p_source, bool p_gate) {
+    lock();
+    modulation.set_gate(p_source, p_gate);
+    unlock();
+}
+
+void Lv2Instance::clear_modulation() {
+    lock();
+    modulation.clear();
+    unlock();
+}
+
+void Lv2Instance::set_modulation_step_frames(int p_frames) {
+    lock();
+    modulation.set_step_frames(p_frames);
+    reserve_modulation_events();
+    unlock();
+}
+
+int Lv2Instance::get_modulation_step_frames() {
+    return modulation.get_step_frames();
+}
+
+void Lv2Instance::reserve_modulation_events() {
+    // called with the lock held, so the host's queue isn't reallocated under perform()
+    if (lv2_host != NULL) {
+        lv2_host->reserve_control_events(modulation.get_max_events(BUFFER_FRAME_SIZE));
+    }
+}
+
+Error Lv2Instance::load_midi_file(const String &p_path) {
+    PackedByteArray data = FileAccess::get_file_as_bytes(p_path);
+    ERR_FAIL_COND_V_MSG(data.is_empty(), ERR_FILE_CANT_OPEN, "Cannot read MIDI file: " + p_path);
+    return load_midi_data(data);
+}
+
+Error Lv2Instance::load_midi_data(const PackedByteArray &p_data) {
+    // parse on the calling thread, the DSP thread only ever walks the flat event list
+    Lv2MidiSequence sequence;
+    std::string error;
+    ERR_FAIL_COND_V_MSG(!sequence.parse(p_data.ptr(), p_data.size(), error), ERR_INVALID_DATA,
+                        "Invalid MIDI file: " + String(error.c_str()));
+
+    lock();
+    midi_player.set_sequence(sequence);
+    unlock();
+    // the previous sequence is freed here, outside of the lock
+    return OK;
+}
+
+void Lv2Instance::play_midi() {
+    lock();
+    midi_player.play();
+    unlock();
+}
+
+void Lv2Instance::stop_midi() {
+    lock();
+    midi_player.stop();
+    unlock();
+}
+
+bool Lv2Instance::is_midi_playing() {
+    return midi_player.is_playing();
+}
+
+void Lv2Instance::seek_midi(double p_seconds) {
+    lock();
+    midi_player.seek(p_seconds);
+    unlock();
+}
+
+double Lv2Instance::get_midi_position() {
+    return midi_player.get_position();
+}
 
-    lv2_host->write_midi_in(midi_bus, event);
+double Lv2Instance::get_midi_length() {
+    lock();
+    double length = midi_player.get_length();
+    unlock();
+    return length;
 }
 
-void Lv2Instance::control_change(int midi_bus, int chan, int control, int value) {
-    if (!initialized) {
-        return;
-    }
+double Lv2Instance::get_midi_tempo() {
+    lock();
+    double tempo = midi_player.get_tempo_at(midi_player.get_position()) * midi_player.get_tempo_scale();
+    unlock();
+    return tempo;
+}
 
-    MidiEvent event;
-    event.data[0] = (MIDIMessage::MIDI_MESSAGE_CONTROL_CHANGE << 4) | (chan & 0x0F);
-    event.data[1] = control;
-    event.data[2] = value;
+void Lv2Instance::set_midi_loop(bool p_enabled, double p_start, double p_end) {
+    lock();
+    midi_player.set_loop(p_enabled, p_start, p_end);
+    unlock();
+}
 
-    lv2_host->write_midi_in(midi_bus, event);
+bool Lv2Instance::is_midi_looping() {
+    return midi_player.is_looping();
 }
 
-void Lv2Instance::send_input_control_channel(int p_channel, float p_value) {
-    if (!initialized) {
-        return;
-    }
+void Lv2Instance::set_midi_tempo_scale(double p_scale) {
+    lock();
+    midi_player.set_tempo_scale(p_scale);
+    unlock();
+}
 
-    lv2_host->set_input_control_value(p_channel, p_value);
+double Lv2Instance::get_midi_tempo_scale() {
+    return midi_player.get_tempo_scale();
 }
 
-float Lv2Instance::get_input_control_channel(int p_channel) {
-    if (!initialized) {
-        return 0;
-    }
+void Lv2Instance::set_midi_player_bus(int p_bus) {
+    ERR_FAIL_INDEX(p_bus, get_input_midi_count());
 
-    return lv2_host->get_input_control_value(p_channel);
+    lock();
+    midi_player.set_bus(p_bus);
+    unlock();
 }
 
-void Lv2Instance::send_output_control_channel(int p_channel, float p_value) {
-    if (!initialized) {
-        return;
-    }
+int Lv2Instance::get_midi_player_bus() {
+    return midi_player.get_bus();
+}
 
-    lv2_host->set_output_control_value(p_channel, p_value);
+int Lv2Instance::get_midi_player_dropped() {
+    return (int)midi_player.get_dropped_events();
 }
 
-float Lv2Instance::get_output_control_channel(int p_channel) {
-    if (!initialized) {
-        return 0;
-    }
+int Lv2Instance::insert_midi_mapping(const MidiMapping &p_mapping) {
+    lock();
+    int index = midi_map.add(p_mapping);
+    unlock();
+    return index;
+}
 
-    return lv2_host->get_output_control_value(p_channel);
+int Lv2Instance::add_midi_mapping(MidiSource p_source, int p_channel, int p_number, int p_control, MidiCurve p_curve,
+                                  float p_min, float p_max) {
+    ERR_FAIL_COND_V_MSG(lv2_host == NULL, -1, "The plugin is not loaded yet.");
+    ERR_FAIL_INDEX_V(p_control, lv2_host->get_input_control_count(), -1);
+    ERR_FAIL_COND_V(p_channel < -1 || p_channel > 15, -1);
+    ERR_FAIL_INDEX_V(p_number, p_source == MIDI_SOURCE_NRPN ? 16384 : 128, -1);
+
+    const LilvControl *control = lv2_host->get_input_control(p_control);
+    MidiMapping mapping;
+    mapping.source = (MidiMapSource)p_source;
+    mapping.channel = p_channel;
+    mapping.number = p_number;
+    mapping.symbol = control->symbol;
+    mapping.control = (uint32_t)p_control;
+    mapping.curve = (MidiMapCurve)p_curve;
+    // an empty range follows the control's own
+    mapping.min = p_min != p_max ? p_min : (float)control->min;
+    mapping.max = p_min != p_max ? p_max : (float)control->max;
+
+    int index = insert_midi_mapping(mapping);
+    ERR_FAIL_COND_V_MSG(index < 0, -1, vformat("No more than %d MIDI mappings per instance.", MIDI_MAP_MAX_MAPPINGS));
+    return index;
 }
 
-void Lv2Instance::pitch_bend(int chan, int val) {
+int Lv2Instance::learn_midi_mapping(int p_control, MidiCurve p_curve, float p_min, float p_max) {
+    ERR_FAIL_COND_V_MSG(lv2_host == NULL, -1, "The plugin is not loaded yet.");
+    ERR_FAIL_INDEX_V(p_control, lv2_host->get_input_control_count(), -1);
+
+    const LilvControl *control = lv2_host->get_input_control(p_control);
+    MidiMapping mapping;
+    mapping.symbol = control->symbol;
+    mapping.control = (uint32_t)p_control;
+    mapping.curve = (MidiMapCurve)p_curve;
+    mapping.min = p_min != p_max ? p_min : (float)control->min;
+    mapping.max = p_min != p_max ? p_max : (float)control->max;
+    mapping.learning = true;
+
+    // one control learns at a time
+    lock();
+    midi_map.cancel_learn();
+    int index = midi_map.add(mapping);
+    unlock();
+    ERR_FAIL_COND_V_MSG(index < 0, -1, vformat("No more than %d MIDI mappings per instance.", MIDI_MAP_MAX_MAPPINGS));
+    return index;
 }
 
-void Lv2Instance::thread_func() {
-    int p_frames = 512;
+void Lv2Instance::cancel_midi_learn() {
+    lock();
+    midi_map.cancel_learn();
+    unlock();
+}
 
-    while (!exit_thread) {
-        if (!initialized) {
-            continue;
-        }
+bool Lv2Instance::is_midi_learning() {
+    lock();
+    bool learning = midi_map.is_learning();
+    unlock();
+    return learning;
+}
 
-        last_mix_frames = p_frames;
+void Lv2Instance::remove_midi_mapping(int p_index) {
+    lock();
+    midi_map.remove(p_index);
+    unlock();
+}
 
-        lock();
+void Lv2Instance::clear_midi_mappings() {
+    lock();
+    midi_map.clear();
+    unlock();
+}
 
-        float volume = godot::UtilityFunctions::db_to_linear(volume_db);
+Array Lv2Instance::get_midi_mappings() {
+    Array result;
 
-        if (Lv2Server::get_singleton()->get_solo_mode()) {
-            if (!solo) {
-                volume = 0.0;
-            }
-        } else {
-            if (mute) {
-                volume = 0.0;
-            }
-        }
+    lock();
+    for (const MidiMapping &mapping : midi_map.get_mappings()) {
+        Dictionary entry;
+        entry["source"] = (int)mapping.source;
+        entry["channel"] = mapping.channel;
+        entry["number"] = mapping.number;
+        entry["control"] = mapping.control == MIDI_MAP_UNRESOLVED ? -1 : (int)mapping.control;
+        entry["symbol"] = String(mapping.symbol.c_str());
+        entry["curve"] = (int)mapping.curve;
+        entry["min"] = mapping.min;
+        entry["max"] = mapping.max;
+        entry["learning"] = mapping.learning;
+        result.push_back(entry);
+    }
+    unlock();
 
-        Vector<float> channel_peak;
-        channel_peak.resize(output_channels.size());
-        for (int i = 0; i < output_channels.size(); i++) {
-            channel_peak.ptrw()[i] = 0;
-        }
+    return result;
+}
 
-        for (int channel = 0; channel < lv2_host->get_input_channel_count(); channel++) {
-            input_channels[channel].read_channel(temp_buffer.ptrw(), p_frames);
+PackedByteArray Lv2Instance::save_state() {
+    PackedByteArray result;
+    if (!initialized) {
+        return result;
+    }
 
-            for (int frame = 0; frame < p_frames; frame++) {
-                lv2_host->get_input_channel_buffer(channel)[frame] = temp_buffer[frame];
-            }
+    std::vector<uint8_t> state;
+    if (!lv2_host->save_state(state)) {
+        return result;
+    }
 
-            input_channels[channel].update_read_index(p_frames);
-        }
+    result.resize(state.size());
+    memcpy(result.ptrw(), state.data(), state.size());
+    return result;
+}
 
-        int result = lv2_host->perform(p_frames);
-        if (result == 0) {
-            finished = true;
-        }
+bool Lv2Instance::restore_state(const PackedByteArray &p_state) {
+    if (!initialized || p_state.size() == 0) {
+        return false;
+    }
 
-        if (bypass) {
-            for (int channel = 0; channel < lv2_host->get_output_channel_count(); channel++) {
-                if (channel < input_channels.size()) {
-                    input_channels[channel].read_channel(temp_buffer.ptrw(), p_frames);
-                } else {
-                    for (int frame = 0; frame < p_frames; frame++) {
-                        temp_buffer.ptrw()[frame] = 0;
-                    }
-                }
-                output_channels[channel].buffer.write_channel(temp_buffer.ptr(), p_frames);
-            }
-        } else {
-            for (int channel = 0; channel < lv2_host->get_output_channel_count(); channel++) {
-                for (int frame = 0; frame < p_frames; frame++) {
-                    float value = lv2_host->get_output_channel_buffer(channel)[frame] * volume;
-                    float p = Math::abs(value);
-                    if (p > channel_peak[channel]) {
-                        channel_peak.ptrw()[channel] = p;
-                    }
-                    temp_buffer.ptrw()[frame] = value;
-                }
-                output_channels[channel].buffer.write_channel(temp_buffer.ptr(), p_frames);
-            }
-        }
+    std::vector<uint8_t> state(p_state.ptr(), p_state.ptr() + p_state.size());
 
-        for (int channel = 0; channel < output_channels.size(); channel++) {
-            output_channels[channel].peak_volume =
-                godot::UtilityFunctions::linear_to_db(channel_peak[channel] + AUDIO_PEAK_OFFSET);
+    // parsed and URID-mapped here; the control values (and, for plugins without state:threadSafeRestore, the
+    // plugin's own restore) are applied by the rendering thread before its next block, see render_block()
+    return lv2_host->queue_restore_state(state);
+}
 
-            if (channel_peak[channel] > 0) {
-                output_channels[channel].active = true;
-            } else {
-                output_channels[channel].active = false;
-            }
-        }
+void Lv2Instance::set_min_sub_block_frames(int p_frames) {
+    lv2_host->set_min_sub_block(MAX(p_frames, 1));
+}
 
-        unlock();
+int Lv2Instance::get_min_sub_block_frames() {
+    return lv2_host->get_min_sub_block();
+}
 
-        semaphore->wait();
+Dictionary Lv2Instance::get_sub_block_stats() {
+    const SubBlockStats &stats = lv2_host->get_sub_block_stats();
+
+    Dictionary result;
+    result["sub_runs"] = stats.sub_runs;
+    result["run_usec"] = stats.run_usec;
+    result["overhead_usec"] = stats.overhead_usec;
+    result["max_overhead_usec"] = stats.max_overhead_usec;
+    return result;
+}
+
+void Lv2Instance::apply_realtime() {
+    lock();
+    realtime_status = lv2_realtime_apply(realtime_policy, realtime_priority, realtime_cpus);
+    deadline.boost = 0;
+    deadline.boost_refused = false;
+    Lv2RealtimeStatus status = realtime_status;
+    bool wants_affinity = !realtime_cpus.empty();
+    unlock();
+
+    if (!status.policy_applied || (wants_affinity && !status.affinity_applied)) {
+        WARN_PRINT(vformat("Lv2 instance %s: realtime scheduling not fully applied (%s), see get_realtime_status()",
+                           instance_name, String(std::strerror(status.error))));
     }
 }
 
-Error Lv2Instance::start_thread() {
-    if (thread.is_null()) {
-        thread.instantiate();
-        exit_thread = false;
-        thread->start(callable_mp(this, &Lv2Instance::thread_func), Thread::PRIORITY_HIGH);
+void Lv2Instance::set_realtime_policy(RealtimePolicy p_policy, int p_priority) {
+    lock();
+    realtime_policy = (Lv2RealtimePolicy)p_policy;
+    realtime_priority = p_priority;
+    // an out-of-process plugin picks it up when its process is next (re)started
+    lv2_host->set_remote_realtime(realtime_policy, realtime_priority);
+    unlock();
+    realtime_dirty.store(true, std::memory_order_release);
+}
+
+Lv2Instance::RealtimePolicy Lv2Instance::get_realtime_policy() {
+    return (RealtimePolicy)realtime_policy;
+}
+
+int Lv2Instance::get_realtime_priority() {
+    return realtime_priority;
+}
+
+void Lv2Instance::set_cpu_affinity(const PackedInt32Array &p_cpus) {
+    lock();
+    realtime_cpus.assign(p_cpus.ptr(), p_cpus.ptr() + p_cpus.size());
+    unlock();
+    realtime_dirty.store(true, std::memory_order_release);
+}
+
+PackedInt32Array Lv2Instance::get_cpu_affinity() {
+    PackedInt32Array cpus;
+    lock();
+    for (int cpu : realtime_cpus) {
+        cpus.push_back(cpu);
     }
-    return (Error)OK;
+    unlock();
+    return cpus;
 }
 
-void Lv2Instance::stop_thread() {
-    if (thread.is_valid()) {
-        exit_thread = true;
-        semaphore->post();
-        thread->wait_to_finish();
-        thread.unref();
+Dictionary Lv2Instance::get_realtime_status() {
+    static const char *fallbacks[] = {"none", "rtprio_limit", "nice", "failed"};
+
+    lock();
+    Lv2RealtimeStatus status = realtime_status;
+    bool pending = realtime_dirty.load(std::memory_order_acquire);
+    unlock();
+
+    Dictionary result;
+    result["pending"] = pending;
+    result["requested_policy"] = (int)status.requested_policy;
+    result["requested_priority"] = status.requested_priority;
+    result["policy"] = (int)status.policy;
+    result["priority"] = status.priority;
+    result["nice"] = status.nice;
+    result["fallback"] = fallbacks[status.fallback];
+    result["policy_applied"] = status.policy_applied;
+    result["affinity_applied"] = status.affinity_applied;
+    result["error"] = status.error;
+    result["error_message"] = status.error != 0 ? String(std::strerror(status.error)) : String();
+    return result;
+}
+
+int64_t Lv2Instance::get_block_deadline_usec(uint64_t p_position) const {
+    if (deadline.read_frames <= 0) {
+        return -1;
     }
+
+    // the block is due at the first read of the leading reader that covers its last frame
+    int64_t ahead = (int64_t)(p_position + BUFFER_FRAME_SIZE) - (int64_t)deadline.origin_position;
+    if (ahead <= 0) {
+        return (int64_t)deadline.origin_usec;
+    }
+    int64_t reads = (ahead + deadline.read_frames - 1) / deadline.read_frames;
+    return (int64_t)deadline.origin_usec + (int64_t)(reads * deadline.read_frames * 1000000.0 / mix_rate);
 }
 
-void Lv2Instance::lock() {
-    if (thread.is_null() || mutex.is_null()) {
+void Lv2Instance::update_deadline_boost(int64_t p_due) {
+    if (realtime_status.policy == LV2_REALTIME_POLICY_NONE || deadline.boost_refused) {
         return;
     }
-    mutex->lock();
+
+    double period = BUFFER_FRAME_SIZE * 1000000.0 / mix_rate;
+    double slack = (double)(p_due - (int64_t)Time::get_singleton()->get_ticks_usec()) - deadline.render_usec;
+    int level = slack < period * DEADLINE_NEAR_MISS ? DEADLINE_BOOST_LEVELS : slack < period * 0.5 ? 1 : 0;
+
+    if (level != deadline.boost) {
+        int priority = MIN(realtime_status.priority + level, 99);
+        if (lv2_realtime_set_priority(realtime_status.policy, priority)) {
+            deadline.boost = level;
+        } else {
+            // typically capped by RLIMIT_RTPRIO, stop trying until the policy is applied again
+            deadline.boost_refused = true;
+        }
+    }
 }
 
-void Lv2Instance::unlock() {
-    if (thread.is_null() || mutex.is_null()) {
+void Lv2Instance::record_deadline(uint64_t p_position, uint64_t p_finished_usec, double p_render_usec) {
+    deadline.render_usec =
+        deadline.render_usec == 0.0 ? p_render_usec : deadline.render_usec * 0.9 + p_render_usec * 0.1;
+
+    int64_t due = get_block_deadline_usec(p_position);
+    if (due < 0) {
         return;
     }
-    mutex->unlock();
-}
 
-void Lv2Instance::initialize() {
-    if (uri.length() > 0) {
-        configure();
-        start();
+    double period = BUFFER_FRAME_SIZE * 1000000.0 / mix_rate;
+    int64_t slack = due - (int64_t)p_finished_usec;
+    double fraction = slack / period;
+
+    int bin = 0;
+    while (bin < DEADLINE_HISTOGRAM_BINS - 1 && fraction >= DEADLINE_SLACK_EDGES[bin]) {
+        bin++;
+    }
+    deadline.histogram[bin]++;
+
+    bool missed = slack < 0;
+    bool near_miss = !missed && fraction < DEADLINE_NEAR_MISS;
+
+    deadline.blocks++;
+    deadline.missed += missed ? 1 : 0;
+    deadline.near_misses += near_miss ? 1 : 0;
+    deadline.min_slack_usec = MIN(deadline.min_slack_usec, slack);
+    deadline.mean_slack_usec += (slack - deadline.mean_slack_usec) / deadline.blocks;
+
+    deadline.window_blocks++;
+    deadline.window_near_misses += (missed || near_miss) ? 1 : 0;
+
+    if (deadline.enabled && deadline.render_ahead_frames == 0 &&
+        (missed || deadline.window_near_misses >= DEADLINE_NEAR_MISSES_PER_WINDOW)) {
+        deadline.render_ahead_frames = BUFFER_FRAME_SIZE;
+        deadline.render_ahead_changes++;
+        deadline.window_blocks = DEADLINE_WINDOW_BLOCKS;
+    }
+
+    if (deadline.window_blocks >= DEADLINE_WINDOW_BLOCKS) {
+        deadline.clean_windows = deadline.window_near_misses == 0 ? deadline.clean_windows + 1 : 0;
+        deadline.window_blocks = 0;
+        deadline.window_near_misses = 0;
+
+        bool stable = deadline.clean_windows >= deadline.stable_windows;
+        if (deadline.render_ahead_frames > 0 && (!deadline.enabled || stable)) {
+            deadline.render_ahead_frames = 0;
+            deadline.render_ahead_changes++;
+            deadline.clean_windows = 0;
+        }
     }
 }
 
-void Lv2Instance::set_instance_name(const String &name) {
-    instance_name = name;
+void Lv2Instance::set_priority(Priority p_priority) {
+    priority = p_priority;
 }
 
-const String &Lv2Instance::get_instance_name() {
-    return instance_name;
+Lv2Instance::Priority Lv2Instance::get_priority() {
+    return (Priority)priority;
 }
 
-void Lv2Instance::set_uri(const String &p_uri) {
-    reset();
-    uri = p_uri;
-    configure();
-    start();
+Lv2Instance::DegradeLevel Lv2Instance::get_degrade_level() {
+    return (DegradeLevel)degrade_level.load(std::memory_order_relaxed);
 }
 
-int Lv2Instance::get_input_channel_count() {
-    if (lv2_host != NULL) {
-        return lv2_host->get_input_channel_count();
-    } else {
-        return 0;
+String Lv2Instance::apply_degrade_level(int p_level) {
+    int previous = degrade_level.load(std::memory_order_relaxed);
+    bool was_reduced = previous >= DEGRADE_REDUCE_QUALITY;
+    bool reduce = p_level >= DEGRADE_REDUCE_QUALITY;
+    String detail;
+
+    if (reduce != was_reduced) {
+        if (quality_control < 0 || !initialized) {
+            detail = reduce ? "no quality control" : "";
+        } else {
+            const LilvControl *control = lv2_host->get_input_control(quality_control);
+            if (reduce) {
+                quality_saved_value = get_input_control_channel(quality_control);
+                send_input_control_channel(quality_control, control->min);
+                detail = String(control->symbol.c_str()) + " = " + rtos(control->min);
+            } else {
+                send_input_control_channel(quality_control, quality_saved_value);
+                detail = String(control->symbol.c_str()) + " = " + rtos(quality_saved_value);
+            }
+        }
     }
+
+    degrade_level.store(p_level, std::memory_order_relaxed);
+    return detail;
 }
 
-int Lv2Instance::get_output_channel_count() {
-    if (lv2_host != NULL) {
-        return lv2_host->get_output_channel_count();
-    } else {
-        return 0;
+void Lv2Instance::set_deadline_scheduling(bool p_enabled) {
+    lock();
+    io_mutex->lock();
+    deadline.enabled = p_enabled;
+    io_mutex->unlock();
+    unlock();
+}
+
+bool Lv2Instance::is_deadline_scheduling() {
+    return deadline.enabled;
+}
+
+Dictionary Lv2Instance::get_deadline_stats() {
+    lock();
+    io_mutex->lock();
+    DeadlineStats stats = deadline;
+    io_mutex->unlock();
+    unlock();
+
+    PackedInt32Array histogram;
+    PackedFloat32Array edges;
+    for (int bin = 0; bin < DEADLINE_HISTOGRAM_BINS; bin++) {
+        histogram.push_back(stats.histogram[bin]);
     }
+    for (int edge = 0; edge < DEADLINE_HISTOGRAM_BINS - 1; edge++) {
+        edges.push_back(DEADLINE_SLACK_EDGES[edge]);
+    }
+
+    Dictionary result;
+    result["enabled"] = stats.enabled;
+    result["blocks"] = stats.blocks;
+    result["missed"] = stats.missed;
+    result["near_misses"] = stats.near_misses;
+    result["min_slack_usec"] = stats.blocks > 0 ? stats.min_slack_usec : (int64_t)0;
+    result["mean_slack_usec"] = stats.mean_slack_usec;
+    result["render_usec"] = stats.render_usec;
+    result["block_usec"] = BUFFER_FRAME_SIZE * 1000000.0 / mix_rate;
+    result["slack_histogram"] = histogram;
+    result["slack_histogram_edges"] = edges;
+    result["render_ahead_frames"] = stats.render_ahead_frames;
+    result["render_ahead_changes"] = stats.render_ahead_changes;
+    result["boost"] = stats.boost;
+    result["boost_refused"] = stats.boost_refused;
+    return result;
 }
 
-int Lv2Instance::get_input_midi_count() {
-    if (lv2_host != NULL) {
-        return lv2_host->get_input_midi_count();
-    } else {
-        return 0;
+void Lv2Instance::reset_deadline_stats() {
+    lock();
+    io_mutex->lock();
+    deadline.blocks = 0;
+    deadline.missed = 0;
+    deadline.near_misses = 0;
+    deadline.min_slack_usec = INT64_MAX;
+    deadline.mean_slack_usec = 0.0;
+    for (int bin = 0; bin < DEADLINE_HISTOGRAM_BINS; bin++) {
+        deadline.histogram[bin] = 0;
     }
+    deadline.render_ahead_changes = 0;
+    io_mutex->unlock();
+    unlock();
 }
 
-int Lv2Instance::get_output_midi_count() {
-    if (lv2_host != NULL) {
-        return lv2_host->get_output_midi_count();
-    } else {
-        return 0;
+void Lv2Instance::lock_rt_memory() {
+    memory_lock.clear();
+    if (!lock_memory || lv2_host == NULL) {
+        return;
+    }
+
+    for (int slot = 0; slot < rack.size(); slot++) {
+        if (get_slot_host(slot) != NULL) {
+            get_slot_host(slot)->collect_rt_memory(memory_lock);
+        }
+        memory_lock.add_vector(rack[slot].output_spans);
     }
+    memory_lock.add_vector(block_midi_out);
+    memory_lock.add_vector(midi_out_queue);
+    memory_lock.add(ring_memory, ring_floats * sizeof(float));
+    memory_lock.add_vector(input_channels);
+    memory_lock.add_vector(output_channels);
+    memory_lock.add_vector(input_spans);
+    memory_lock.add_vector(output_spans);
+    memory_lock.add_vector(output_control_values);
+    memory_lock.add_vector(true_peak_history);
+    memory_lock.add_vector(true_peak_scratch);
+    // output consumers, jitter state and meters live inline
+    memory_lock.add(this, sizeof(*this));
+    memory_lock.lock();
 }
 
-TypedArray<Lv2Control> Lv2Instance::get_input_controls() {
-    return input_controls;
+void Lv2Instance::set_memory_locked(bool p_locked) {
+    lock();
+    lock_memory = p_locked;
+    lock_rt_memory();
+    unlock();
 }
 
-TypedArray<Lv2Control> Lv2Instance::get_output_controls() {
-    return output_controls;
+bool Lv2Instance::is_memory_locked() {
+    return lock_memory;
 }
 
-TypedArray<String> Lv2Instance::get_presets() {
-    return presets;
+Dictionary Lv2Instance::get_memory_lock_status() {
+    lock();
+    Dictionary result;
+    result["enabled"] = lock_memory;
+    result["regions"] = memory_lock.get_region_count();
+    result["locked_bytes"] = (int64_t)memory_lock.get_locked_bytes();
+    result["error"] = memory_lock.get_error();
+    result["error_message"] =
+        memory_lock.get_error() != 0 ? String(std::strerror(memory_lock.get_error())) : String();
+    unlock();
+    return result;
 }
 
-void Lv2Instance::load_preset(String p_preset) {
-    lv2_host->load_preset(std::string(p_preset.ascii()));
+void Lv2Instance::set_page_fault_tracking(bool p_enabled) {
+    lock();
+    page_faults.enabled = p_enabled;
+    unlock();
+}
+
+bool Lv2Instance::is_page_fault_tracking() {
+    return page_faults.enabled;
+}
+
+Dictionary Lv2Instance::get_page_fault_stats() {
+    lock();
+    PageFaultStats stats = page_faults;
+    unlock();
+
+    Dictionary result;
+    result["enabled"] = stats.enabled;
+    result["blocks"] = stats.blocks;
+    result["faulting_blocks"] = stats.faulting_blocks;
+    result["minor"] = stats.minor;
+    result["major"] = stats.major;
+    result["last_minor"] = stats.last_minor;
+    result["last_major"] = stats.last_major;
+    result["max_minor"] = stats.max_minor;
+    result["max_major"] = stats.max_major;
+    return result;
+}
+
+void Lv2Instance::reset_page_fault_stats() {
+    lock();
+    bool enabled = page_faults.enabled;
+    page_faults = PageFaultStats();
+    page_faults.enabled = enabled;
+    unlock();
 }
 
 double Lv2Instance::get_time_since_last_mix() {
@@ -630,9 +2964,13 @@ void Lv2Instance::_bind_methods() {
     ClassDB::bind_method(D_METHOD("note_on", "chan", "key", "vel"), &Lv2Instance::note_on);
     ClassDB::bind_method(D_METHOD("note_off", "chan", "key"), &Lv2Instance::note_off);
     ClassDB::bind_method(D_METHOD("control_change", "chan", "control", "key"), &Lv2Instance::control_change);
+    ClassDB::bind_method(D_METHOD("send_midi_packed", "events", "frame_offsets", "bus"),
+                         &Lv2Instance::send_midi_packed, DEFVAL(0));
 
     ClassDB::bind_method(D_METHOD("send_input_control_channel", "channel", "value"),
                          &Lv2Instance::send_input_control_channel);
+    ClassDB::bind_method(D_METHOD("send_input_control_channel_at", "channel", "value", "frame"),
+                         &Lv2Instance::send_input_control_channel_at);
     ClassDB::bind_method(D_METHOD("get_input_control_channel", "channel"), &Lv2Instance::get_input_control_channel);
 
     ClassDB::bind_method(D_METHOD("send_output_control_channel", "channel", "value"),
@@ -641,19 +2979,172 @@ void Lv2Instance::_bind_methods() {
 
     ClassDB::bind_method(D_METHOD("pitch_bend", "chan", "vel"), &Lv2Instance::pitch_bend);
 
+    ClassDB::bind_method(D_METHOD("release_output_consumer", "consumer"), &Lv2Instance::release_output_consumer);
+    ClassDB::bind_method(D_METHOD("get_output_consumer_stats"), &Lv2Instance::get_output_consumer_stats);
+    ClassDB::bind_method(D_METHOD("get_ring_capacity"), &Lv2Instance::get_ring_capacity);
+    ClassDB::bind_method(D_METHOD("set_jitter_target_frames", "frames"), &Lv2Instance::set_jitter_target_frames);
+    ClassDB::bind_method(D_METHOD("get_jitter_target_frames"), &Lv2Instance::get_jitter_target_frames);
+    ClassDB::bind_method(D_METHOD("get_output_latency_frames"), &Lv2Instance::get_output_latency_frames);
+    ClassDB::bind_method(D_METHOD("get_jitter_stats"), &Lv2Instance::get_jitter_stats);
+
     ClassDB::bind_method(D_METHOD("set_instance_name", "name"), &Lv2Instance::set_instance_name);
     ClassDB::bind_method(D_METHOD("get_instance_name"), &Lv2Instance::get_instance_name);
 
     ClassDB::bind_method(D_METHOD("get_input_controls"), &Lv2Instance::get_input_controls);
     ClassDB::bind_method(D_METHOD("get_output_controls"), &Lv2Instance::get_output_controls);
 
+    ClassDB::bind_method(D_METHOD("resolve_control", "symbol"), &Lv2Instance::resolve_control);
+    ClassDB::bind_method(D_METHOD("resolve_output_control", "symbol"), &Lv2Instance::resolve_output_control);
+    ClassDB::bind_method(D_METHOD("get_output_controls_packed"), &Lv2Instance::get_output_controls_packed);
+    ClassDB::bind_method(D_METHOD("set_input_controls_packed", "indices", "values"),
+                         &Lv2Instance::set_input_controls_packed);
+
     ClassDB::bind_method(D_METHOD("get_presets"), &Lv2Instance::get_presets);
     ClassDB::bind_method(D_METHOD("load_preset", "preset"), &Lv2Instance::load_preset);
 
+    ClassDB::bind_method(D_METHOD("set_min_sub_block_frames", "frames"), &Lv2Instance::set_min_sub_block_frames);
+    ClassDB::bind_method(D_METHOD("get_min_sub_block_frames"), &Lv2Instance::get_min_sub_block_frames);
+    ClassDB::bind_method(D_METHOD("get_sub_block_stats"), &Lv2Instance::get_sub_block_stats);
+
+    ClassDB::bind_method(D_METHOD("set_true_peak_enabled", "enabled"), &Lv2Instance::set_true_peak_enabled);
+    ClassDB::bind_method(D_METHOD("is_true_peak_enabled"), &Lv2Instance::is_true_peak_enabled);
+
+    ClassDB::bind_method(D_METHOD("add_modulation_lfo", "shape", "rate_hz"), &Lv2Instance::add_modulation_lfo);
+    ClassDB::bind_method(D_METHOD("add_modulation_envelope", "attack", "decay", "sustain", "release"),
+                         &Lv2Instance::add_modulation_envelope);
+    ClassDB::bind_method(D_METHOD("add_modulation_curve", "curve", "duration", "loop"),
+                         &Lv2Instance::add_modulation_curve);
+    ClassDB::bind_method(D_METHOD("add_modulation_follower", "instance_name", "attack", "release"),
+                         &Lv2Instance::add_modulation_follower);
+    ClassDB::bind_method(D_METHOD("add_modulation_route", "source", "control", "min", "max"),
+                         &Lv2Instance::add_modulation_route);
+    ClassDB::bind_method(D_METHOD("set_modulation_gate", "source", "gate"), &Lv2Instance::set_modulation_gate);
+    ClassDB::bind_method(D_METHOD("clear_modulation"), &Lv2Instance::clear_modulation);
+    ClassDB::bind_method(D_METHOD("set_modulation_step_frames", "frames"), &Lv2Instance::set_modulation_step_frames);
+    ClassDB::bind_method(D_METHOD("get_modulation_step_frames"), &Lv2Instance::get_modulation_step_frames);
+
+    ClassDB::bind_method(D_METHOD("load_midi_file", "path"), &Lv2Instance::load_midi_file);
+    ClassDB::bind_method(D_METHOD("load_midi_data", "data"), &Lv2Instance::load_midi_data);
+    ClassDB::bind_method(D_METHOD("play_midi"), &Lv2Instance::play_midi);
+    ClassDB::bind_method(D_METHOD("stop_midi"), &Lv2Instance::stop_midi);
+    ClassDB::bind_method(D_METHOD("is_midi_playing"), &Lv2Instance::is_midi_playing);
+    ClassDB::bind_method(D_METHOD("seek_midi", "seconds"), &Lv2Instance::seek_midi);
+    ClassDB::bind_method(D_METHOD("get_midi_position"), &Lv2Instance::get_midi_position);
+    ClassDB::bind_method(D_METHOD("get_midi_length"), &Lv2Instance::get_midi_length);
+    ClassDB::bind_method(D_METHOD("get_midi_tempo"), &Lv2Instance::get_midi_tempo);
+    ClassDB::bind_method(D_METHOD("set_midi_loop", "enabled", "start", "end"), &Lv2Instance::set_midi_loop,
+                         DEFVAL(0.0), DEFVAL(-1.0));
+    ClassDB::bind_method(D_METHOD("is_midi_looping"), &Lv2Instance::is_midi_looping);
+    ClassDB::bind_method(D_METHOD("set_midi_tempo_scale", "scale"), &Lv2Instance::set_midi_tempo_scale);
+    ClassDB::bind_method(D_METHOD("get_midi_tempo_scale"), &Lv2Instance::get_midi_tempo_scale);
+    ClassDB::bind_method(D_METHOD("set_midi_player_bus", "bus"), &Lv2Instance::set_midi_player_bus);
+    ClassDB::bind_method(D_METHOD("get_midi_player_bus"), &Lv2Instance::get_midi_player_bus);
+    ClassDB::bind_method(D_METHOD("get_midi_player_dropped"), &Lv2Instance::get_midi_player_dropped);
+
+    BIND_ENUM_CONSTANT(LFO_SINE);
+    BIND_ENUM_CONSTANT(LFO_TRIANGLE);
+    BIND_ENUM_CONSTANT(LFO_SAW);
+    BIND_ENUM_CONSTANT(LFO_SQUARE);
+
+    ClassDB::bind_method(D_METHOD("add_midi_mapping", "source", "channel", "number", "control", "curve", "min", "max"),
+                         &Lv2Instance::add_midi_mapping, DEFVAL(MIDI_CURVE_LINEAR), DEFVAL(0.0), DEFVAL(0.0));
+    ClassDB::bind_method(D_METHOD("learn_midi_mapping", "control", "curve", "min", "max"),
+                         &Lv2Instance::learn_midi_mapping, DEFVAL(MIDI_CURVE_LINEAR), DEFVAL(0.0), DEFVAL(0.0));
+    ClassDB::bind_method(D_METHOD("cancel_midi_learn"), &Lv2Instance::cancel_midi_learn);
+    ClassDB::bind_method(D_METHOD("is_midi_learning"), &Lv2Instance::is_midi_learning);
+    ClassDB::bind_method(D_METHOD("remove_midi_mapping", "index"), &Lv2Instance::remove_midi_mapping);
+    ClassDB::bind_method(D_METHOD("clear_midi_mappings"), &Lv2Instance::clear_midi_mappings);
+    ClassDB::bind_method(D_METHOD("get_midi_mappings"), &Lv2Instance::get_midi_mappings);
+
+    BIND_ENUM_CONSTANT(MIDI_SOURCE_CC);
+    BIND_ENUM_CONSTANT(MIDI_SOURCE_NRPN);
+    BIND_ENUM_CONSTANT(MIDI_CURVE_LINEAR);
+    BIND_ENUM_CONSTANT(MIDI_CURVE_EXPONENTIAL);
+    BIND_ENUM_CONSTANT(MIDI_CURVE_LOGARITHMIC);
+    BIND_ENUM_CONSTANT(MIDI_CURVE_TOGGLE);
+
+    ClassDB::bind_method(D_METHOD("set_realtime_policy", "policy", "priority"), &Lv2Instance::set_realtime_policy);
+    ClassDB::bind_method(D_METHOD("get_realtime_policy"), &Lv2Instance::get_realtime_policy);
+    ClassDB::bind_method(D_METHOD("get_realtime_priority"), &Lv2Instance::get_realtime_priority);
+    ClassDB::bind_method(D_METHOD("set_cpu_affinity", "cpus"), &Lv2Instance::set_cpu_affinity);
+    ClassDB::bind_method(D_METHOD("get_cpu_affinity"), &Lv2Instance::get_cpu_affinity);
+    ClassDB::bind_method(D_METHOD("get_realtime_status"), &Lv2Instance::get_realtime_status);
+
+    ClassDB::bind_method(D_METHOD("set_deadline_scheduling", "enabled"), &Lv2Instance::set_deadline_scheduling);
+    ClassDB::bind_method(D_METHOD("is_deadline_scheduling"), &Lv2Instance::is_deadline_scheduling);
+    ClassDB::bind_method(D_METHOD("get_deadline_stats"), &Lv2Instance::get_deadline_stats);
+    ClassDB::bind_method(D_METHOD("reset_deadline_stats"), &Lv2Instance::reset_deadline_stats);
+
+    ClassDB::bind_method(D_METHOD("set_memory_locked", "locked"), &Lv2Instance::set_memory_locked);
+    ClassDB::bind_method(D_METHOD("is_memory_locked"), &Lv2Instance::is_memory_locked);
+    ClassDB::bind_method(D_METHOD("get_memory_lock_status"), &Lv2Instance::get_memory_lock_status);
+    ClassDB::bind_method(D_METHOD("set_page_fault_tracking", "enabled"), &Lv2Instance::set_page_fault_tracking);
+    ClassDB::bind_method(D_METHOD("is_page_fault_tracking"), &Lv2Instance::is_page_fault_tracking);
+    ClassDB::bind_method(D_METHOD("get_page_fault_stats"), &Lv2Instance::get_page_fault_stats);
+    ClassDB::bind_method(D_METHOD("reset_page_fault_stats"), &Lv2Instance::reset_page_fault_stats);
+
+    ClassDB::bind_method(D_METHOD("set_priority", "priority"), &Lv2Instance::set_priority);
+    ClassDB::bind_method(D_METHOD("get_priority"), &Lv2Instance::get_priority);
+    ClassDB::bind_method(D_METHOD("get_degrade_level"), &Lv2Instance::get_degrade_level);
+
+    ClassDB::bind_method(D_METHOD("set_watchdog_blocks", "blocks"), &Lv2Instance::set_watchdog_blocks);
+    ClassDB::bind_method(D_METHOD("get_watchdog_blocks"), &Lv2Instance::get_watchdog_blocks);
+    ClassDB::bind_method(D_METHOD("is_quarantined"), &Lv2Instance::is_quarantined);
+    ClassDB::bind_method(D_METHOD("get_hang_count"), &Lv2Instance::get_hang_count);
+    ClassDB::bind_method(D_METHOD("recover"), &Lv2Instance::recover);
+
+    ClassDB::bind_method(D_METHOD("drain_midi_output", "max_events"), &Lv2Instance::drain_midi_output,
+                         DEFVAL(-1));
+    ClassDB::bind_method(D_METHOD("get_midi_output_dropped"), &Lv2Instance::get_midi_output_dropped);
+    ClassDB::bind_method(D_METHOD("get_control_events_dropped"), &Lv2Instance::get_control_events_dropped);
+    ClassDB::bind_method(D_METHOD("get_midi_input_dropped"), &Lv2Instance::get_midi_input_dropped);
+
+    ClassDB::bind_method(D_METHOD("set_rack", "uris"), &Lv2Instance::set_rack);
+    ClassDB::bind_method(D_METHOD("get_rack"), &Lv2Instance::get_rack);
+    ClassDB::bind_method(D_METHOD("get_slot_count"), &Lv2Instance::get_slot_count);
+    ClassDB::bind_method(D_METHOD("set_slot_bypass", "slot", "bypass"), &Lv2Instance::set_slot_bypass);
+    ClassDB::bind_method(D_METHOD("is_slot_bypassed", "slot"), &Lv2Instance::is_slot_bypassed);
+    ClassDB::bind_method(D_METHOD("set_slot_control_value", "slot", "index", "value"),
+                         &Lv2Instance::set_slot_control_value);
+    ClassDB::bind_method(D_METHOD("get_slot_control_value", "slot", "index"), &Lv2Instance::get_slot_control_value);
+    ClassDB::bind_method(D_METHOD("get_slot_stats", "slot"), &Lv2Instance::get_slot_stats);
+    ClassDB::bind_method(D_METHOD("reset_slot_stats"), &Lv2Instance::reset_slot_stats);
+
+    ClassDB::bind_method(D_METHOD("get_loading_policy"), &Lv2Instance::get_loading_policy);
+    ClassDB::bind_method(D_METHOD("get_effective_loading_policy"), &Lv2Instance::get_effective_loading_policy);
+    ClassDB::bind_method(D_METHOD("is_out_of_process"), &Lv2Instance::is_out_of_process);
+    ClassDB::bind_method(D_METHOD("get_remote_stats"), &Lv2Instance::get_remote_stats);
+
+    BIND_ENUM_CONSTANT(PRIORITY_LOW);
+    BIND_ENUM_CONSTANT(PRIORITY_NORMAL);
+    BIND_ENUM_CONSTANT(PRIORITY_HIGH);
+
+    BIND_ENUM_CONSTANT(DEGRADE_NONE);
+    BIND_ENUM_CONSTANT(DEGRADE_SKIP_TAILS);
+    BIND_ENUM_CONSTANT(DEGRADE_REDUCE_QUALITY);
+    BIND_ENUM_CONSTANT(DEGRADE_BYPASS);
+    BIND_ENUM_CONSTANT(DEGRADE_MUTE);
+
+    BIND_ENUM_CONSTANT(REALTIME_POLICY_NONE);
+    BIND_ENUM_CONSTANT(REALTIME_POLICY_FIFO);
+    BIND_ENUM_CONSTANT(REALTIME_POLICY_RR);
+
+    BIND_ENUM_CONSTANT(LOADING_POLICY_SHARED);
+    BIND_ENUM_CONSTANT(LOADING_POLICY_ISOLATED);
+    BIND_ENUM_CONSTANT(LOADING_POLICY_OUT_OF_PROCESS);
+
+    ClassDB::bind_method(D_METHOD("save_state"), &Lv2Instance::save_state);
+    ClassDB::bind_method(D_METHOD("restore_state", "state"), &Lv2Instance::restore_state);
+
     ClassDB::add_property("Lv2Instance", PropertyInfo(Variant::STRING, "instance_name"), "set_instance_name",
                           "get_instance_name");
 
     ADD_SIGNAL(MethodInfo("lv2_ready", PropertyInfo(Variant::STRING, "name")));
+    ADD_SIGNAL(
+        MethodInfo("plugin_hung", PropertyInfo(Variant::STRING, "name"), PropertyInfo(Variant::INT, "stalled_usec")));
+    ADD_SIGNAL(
+        MethodInfo("plugin_restarted", PropertyInfo(Variant::STRING, "name"), PropertyInfo(Variant::INT, "restarts")));
+    ADD_SIGNAL(MethodInfo("midi_learned", PropertyInfo(Variant::STRING, "name"), PropertyInfo(Variant::INT, "index")));
 }
 
 } // namespace godot
@@ -1,6 +1,7 @@
 #ifndef LV2_INSTANCE_H
 #define LV2_INSTANCE_H
 
+#include "godot_cpp/classes/curve.hpp"
 #include "godot_cpp/classes/mutex.hpp"
 #include "godot_cpp/classes/semaphore.hpp"
 #include "godot_cpp/classes/thread.hpp"
@@ -21,14 +22,47 @@
 
 #include <lv2_circular_buffer.h>
 #include <lv2_host.h>
+#include <lv2_memory.h>
+#include <lv2_midi_map.h>
+#include <lv2_midi_player.h>
+#include <lv2_modulation_matrix.h>
+#include <lv2_realtime.h>
+#include <lv2_seqlock.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
 
 static const float AUDIO_PEAK_OFFSET = 0.0000000001f;
 static const float AUDIO_MIN_PEAK_DB = -200.0f;
+// the render block. Godot's AudioServer mixes in fixed steps of this size whatever the driver's buffer is (the step
+// isn't exposed through its API), a larger driver buffer only runs more steps back to back
 static const int BUFFER_FRAME_SIZE = 512;
-static const int CIRCULAR_BUFFER_SIZE = BUFFER_FRAME_SIZE * 2 + 10;
+static const int MODULATION_CURVE_TABLE_SIZE = 256;
+static const int METER_MAX_CHANNELS = 16;
+static const int OUTPUT_MAX_CONSUMERS = 16;
+static const int OUTPUT_CONTROL_MAX_VALUES = 256;
+static const int STACK_PREFAULT_BYTES = 64 * 1024;
+static const int DEADLINE_HISTOGRAM_BINS = 8;
+static const int DEADLINE_WINDOW_BLOCKS = 64;
+static const int DEADLINE_BOOST_LEVELS = 2;
+static const int GOVERNOR_TAIL_BLOCKS = 4;
+static const int WATCHDOG_POLL_USEC = 100;
+static const int GRAPH_MAX_PORTS = 64;
+// power of two
+static const int MIDI_OUT_QUEUE_SIZE = 4096;
+static const int MIDI_OUT_RECORD_BYTES = 16;
 
 namespace godot {
 
+struct MeterSnapshot {
+    int channels = 0;
+    float peak_db[METER_MAX_CHANNELS];
+    float rms_db[METER_MAX_CHANNELS];
+    float true_peak_db[METER_MAX_CHANNELS];
+    bool active[METER_MAX_CHANNELS];
+};
+
 class Lv2Instance : public Object {
     GDCLASS(Lv2Instance, Object);
     friend class Lv2Server;
@@ -58,13 +92,17 @@ private:
     Ref<Thread> thread;
     Ref<Mutex> mutex;
     Ref<Semaphore> semaphore;
+    // what lock()/unlock() take, NULL while no instance thread runs: other threads read this instead of
+    // thread/mutex, which abandon_thread() replaces from the main thread
+    std::atomic<Mutex *> thread_mutex;
+    // the hand-over between the mix thread and the instance thread: ring indices, output consumers, jitter and
+    // deadline state. Only ever held for a few index updates (never across run()), so the mix thread can wait on it
+    Ref<Mutex> io_mutex;
 
     struct Channel {
         String name;
         bool used = false;
-        bool active = false;
-        float peak_volume = AUDIO_MIN_PEAK_DB;
-        Lv2CircularBuffer<float> buffer;
+        Lv2CircularBuffer<float> buffer{0};
         Channel() {
         }
     };
@@ -74,17 +112,316 @@ private:
     std::vector<Lv2CircularBuffer<float>> input_channels;
     std::vector<Channel> output_channels;
 
-    Vector<float> temp_buffer;
+    // one allocation backing every channel ring of this instance, ring_capacity frames per channel; out of process
+    // the rings live in the segment shared with the plugin's process instead and ring_arena stays empty
+    std::vector<float> ring_arena;
+    float *ring_memory;
+    size_t ring_floats;
+    int ring_capacity;
+
+    // ring ranges handed to the plugin for the block being rendered
+    std::vector<Lv2RingSpan<float>> input_spans;
+    std::vector<Lv2RingSpan<float>> output_spans;
 
     Channel output_left_channel;
     Channel output_right_channel;
 
+    // every reader of the output rings (player, channel stream, effect) gets its own cursor,
+    // keyed by the reader's object id; key 0 is shared by callers that don't identify themselves
+    struct OutputConsumer {
+        bool used = false;
+        uint64_t key = 0;
+        uint64_t position = 0;
+        uint64_t last_read = 0;
+        uint64_t frames_read = 0;
+        uint32_t underruns = 0;
+        uint32_t overruns = 0;
+        // clean reads since this reader's last underrun
+        int stable_count = 0;
+        bool starved = false;
+        float last_left = 0.0f;
+        float last_right = 0.0f;
+    };
+
+    // adaptive fill between the mix thread and the instance thread: the leading reader keeps target_frames
+    // rendered ahead of itself, one block more after an underrun and one block less after stable_blocks clean reads.
+    // Only the leading reader (output_leader) adapts it, once per read, however many readers follow it
+    struct JitterBuffer {
+        int min_frames = BUFFER_FRAME_SIZE;
+        int max_frames = BUFFER_FRAME_SIZE * 2;
+        int target_frames = BUFFER_FRAME_SIZE;
+        int stable_blocks = 256;
+        int fade_frames = 64;
+        uint32_t underruns = 0;
+        uint32_t grows = 0;
+        uint32_t shrinks = 0;
+        uint32_t input_underruns = 0;
+        uint32_t input_overruns = 0;
+    };
+
+    // when the leading reader will need each block, and how much time was left when the instance thread delivered
+    // it; slack is binned in fractions of a block period: missed, <1/8, <1/4, <1/2, <1, <2, <4, >=4
+    struct DeadlineStats {
+        bool enabled = false;
+        uint64_t origin_usec = 0;
+        uint64_t origin_position = 0;
+        int read_frames = 0;
+        double render_usec = 0.0;
+        uint64_t blocks = 0;
+        uint32_t missed = 0;
+        uint32_t near_misses = 0;
+        int64_t min_slack_usec = INT64_MAX;
+        double mean_slack_usec = 0.0;
+        uint32_t histogram[DEADLINE_HISTOGRAM_BINS] = {};
+        // render-ahead: one extra block once a window of blocks sees a miss or several near misses,
+        // dropped again after stable_windows clean windows
+        int window_blocks = 0;
+        int window_near_misses = 0;
+        int clean_windows = 0;
+        int stable_windows = 16;
+        int render_ahead_frames = 0;
+        uint32_t render_ahead_changes = 0;
+        // realtime priority raised by up to DEADLINE_BOOST_LEVELS while a block runs short of slack
+        int boost = 0;
+        bool boost_refused = false;
+    };
+
+    JitterBuffer jitter;
+    DeadlineStats deadline;
+    OutputConsumer output_consumers[OUTPUT_MAX_CONSUMERS];
+    uint64_t output_write_position;
+    uint64_t output_render_position;
+    uint64_t output_read_serial;
+    // the reader furthest ahead, it advances the mix clock
+    OutputConsumer *output_leader;
+
+    void reset_output_consumers();
+    OutputConsumer *acquire_output_consumer(uint64_t p_key);
+    int advance_output_consumer(OutputConsumer *p_consumer, int p_frames, int &r_render_blocks);
+    int read_output(AudioFrame *p_dst, const AudioFrame *p_dry, int p_left, int p_right, int p_frames, float p_mix,
+                    uint64_t p_consumer);
+
     TypedArray<Lv2Control> input_controls;
     TypedArray<Lv2Control> output_controls;
 
+    HashMap<String, int> input_control_map;
+    HashMap<String, int> output_control_map;
+
+    // output control values published by the instance thread after each block. The buffer is allocated once at
+    // OUTPUT_CONTROL_MAX_VALUES and never moves, configure() only changes the count, so readers need no lock
+    std::vector<float> output_control_values;
+    std::atomic<int> output_control_count;
+    Lv2SeqLock output_control_seqlock;
+
+    // per-block meters published by the instance thread
+    MeterSnapshot meter;
+    Lv2SeqLock meter_seqlock;
+    bool true_peak_enabled;
+    std::vector<float> true_peak_history;
+    std::vector<float> true_peak_scratch;
+
     TypedArray<String> presets;
 
+    Lv2ModulationMatrix modulation;
+    Lv2MidiPlayer midi_player;
+    Lv2MidiMap midi_map;
+    uint32_t midi_learned_seen;
+    std::shared_ptr<std::atomic<float>> output_level;
+
+    // scheduling requested for the instance thread, the thread applies it to itself before its next block
+    Lv2RealtimePolicy realtime_policy;
+    int realtime_priority;
+    std::vector<int> realtime_cpus;
+    std::atomic<bool> realtime_dirty;
+    Lv2RealtimeStatus realtime_status;
+
+    void apply_realtime();
+
+    int64_t get_block_deadline_usec(uint64_t p_position) const;
+    void update_deadline_boost(int64_t p_due);
+    void record_deadline(uint64_t p_position, uint64_t p_finished_usec, double p_render_usec);
+
+    // everything the instance thread touches, prefaulted and mlocked while lock_memory is set
+    Lv2MemoryLock memory_lock;
+    bool lock_memory;
+
+    // page faults taken by the instance thread while rendering, sampled around every block
+    struct PageFaultStats {
+        bool enabled = false;
+        uint64_t blocks = 0;
+        uint64_t faulting_blocks = 0;
+        uint64_t minor = 0;
+        uint64_t major = 0;
+        uint32_t last_minor = 0;
+        uint32_t last_major = 0;
+        uint32_t max_minor = 0;
+        uint32_t max_major = 0;
+    };
+
+    PageFaultStats page_faults;
+
+    void lock_rt_memory();
+
+    // dsp budget governor, driven by Lv2Server::update_governor(): priority (a Priority) picks who may be
+    // degraded, degrade_level (a DegradeLevel) how far
+    int priority;
+    std::atomic<int> degrade_level;
+    // time the instance thread spent rendering, read by the governor
+    std::atomic<uint64_t> busy_usec;
+    // an input control that trades quality for cpu (lowest value assumed cheapest), -1 if the plugin has none
+    int quality_control;
+    float quality_saved_value;
+    // instance thread: 0 = plugin output, 1 = dry input, ramped over a block
+    float governor_bypass_fade;
+    int silent_blocks;
+    int applied_degrade_level;
+    // server thread
+    uint64_t governor_busy_seen;
+    uint32_t governor_missed_seen;
+
+    String apply_degrade_level(int p_level);
+
+    // watchdog: when did the running perform() start (0 while the instance thread is outside of it), and how many
+    // block periods it may take before the instance is quarantined; a quarantined instance is skipped by the mix
+    // thread, which outputs silence instead
+    std::atomic<uint64_t> perform_started_usec;
+    std::atomic<bool> quarantined;
+    int watchdog_blocks;
+    uint32_t hang_count;
+    // set when the instance thread was given up on, shared with that thread so it can still see it after this
+    // object has moved on (or is gone) once the plugin returns
+    std::shared_ptr<std::atomic<bool>> thread_abandoned;
+
+    // what an abandoned thread may still touch, kept alive for as long as the process runs
+    struct AbandonedThread {
+        Ref<Thread> thread;
+        Ref<Mutex> mutex;
+        Ref<Semaphore> semaphore;
+        Lv2Host *lv2_host = NULL;
+        std::vector<Lv2Host *> rack_hosts;
+        std::vector<float> ring_arena;
+        std::vector<Lv2CircularBuffer<float>> input_channels;
+        std::vector<Channel> output_channels;
+    };
+
+    // instance routing, laid out by Lv2Server::update_graph(): the instances of a connected group are rendered in
+    // topological order on the thread of the last one (the driver), every member locked for the whole block, with
+    // routed inputs bound straight to the output blocks their sources just wrote into their rings
+    struct GraphRoute {
+        // index of the source in the driver's graph_nodes
+        int source = 0;
+        int from_port = 0;
+        int to_port = 0;
+        bool midi = false;
+    };
+
+    struct GraphMidiEvent {
+        int bus = 0;
+        MidiEvent event;
+    };
+
+    struct GraphNode {
+        Lv2Instance *instance = NULL;
+        std::vector<GraphRoute> routes;
+        // input channels fed by routes instead of the instance's input rings
+        uint64_t routed_inputs = 0;
+
+        // driver thread, per block
+        Mutex *held = NULL;
+        std::shared_ptr<std::atomic<bool>> abandoned;
+        bool rendered = false;
+        int output_count = 0;
+        Lv2RingSpan<float> outputs[GRAPH_MAX_PORTS];
+    };
+
+    // MIDI output of the last block on every bus, what MIDI routes of a group read; instance thread
+    std::vector<GraphMidiEvent> block_midi_out;
+
+    // MIDI output for scripts, stamped with its frame on the output timeline: written by the instance thread,
+    // drained in batches by drain_midi_output() without taking the lock
+    struct MidiOutRecord {
+        uint64_t position = 0;
+        int bus = 0;
+        MidiEvent event;
+    };
+
+    std::vector<MidiOutRecord> midi_out_queue;
+    std::atomic<uint64_t> midi_out_written;
+    std::atomic<uint64_t> midi_out_read;
+    std::atomic<uint32_t> midi_out_dropped;
+
+    void collect_midi_output(uint64_t p_position);
+    void reserve_modulation_events();
+
+    // when the instance thread started its last block, stamps incoming MIDI with a frame in the next one
+    std::atomic<uint64_t> block_started_usec;
+
+    // MIDI from outside the DSP thread (Lv2Server's MIDI router), placed in the next block as far as p_stamp_usec
+    // is after the start of the last one. Only as accurate as the stamp: the router can only stamp events when the
+    // main loop dispatches them
+    void send_midi_event(int p_bus, const MidiEvent &p_event, uint64_t p_stamp_usec);
+
+    // the driver rendering this instance, NULL when it renders itself; changed under the lock and io_mutex
+    std::atomic<Lv2Instance *> graph_driver;
+    // members in topological order ending with this instance, empty unless this instance is a driver
+    std::vector<GraphNode> graph_nodes;
+    Ref<Mutex> graph_mutex;
+
+    bool render_block(int p_frames, const std::shared_ptr<std::atomic<bool>> &p_abandoned, const GraphNode *p_node,
+                      const GraphNode *p_nodes);
+    bool render_graph(int p_frames, const std::shared_ptr<std::atomic<bool>> &p_abandoned);
+    void release_graph();
+    void bind_graph_inputs(const GraphNode &p_node, const GraphNode *p_nodes, int p_frames);
+    void request_blocks(int p_blocks);
+
+    // rack mode: plugins run back to back on this instance's thread, each one reading the previous one's output
+    // buffers in place. Slot 0 is the instance's own plugin (lv2_host, uri), it alone gets MIDI, controls, state
+    // and presets; the last slot renders into the output rings.
+    struct RackSlot {
+        // NULL for slot 0
+        Lv2Host *host = NULL;
+        String uri;
+        bool bypass = false;
+
+        // DSP thread, read under the lock
+        uint64_t runs = 0;
+        uint64_t bypassed_blocks = 0;
+        double total_usec = 0.0;
+        double max_usec = 0.0;
+        double last_usec = 0.0;
+        // the slot's own output buffers as spans, what the next slot reads
+        std::vector<Lv2RingSpan<float>> output_spans;
+    };
+
+    std::vector<RackSlot> rack;
+
+    Lv2Host *get_slot_host(int p_slot) const;
+    // the slots after slot 0, hosts are created by the next configure()
+    void assign_rack(const PackedStringArray &p_uris);
+    void configure_rack(int p_frames);
+    void clear_rack();
+    int perform_rack(int p_frames, const std::shared_ptr<std::atomic<bool>> &p_abandoned);
+    void skip_rack(int p_frames);
+
+    // a mapping by control symbol, resolved against the plugin by the next configure()
+    int insert_midi_mapping(const MidiMapping &p_mapping);
+
+    // how the plugin library is loaded, resolved per uri by Lv2Server when the plugin is (re)loaded; the
+    // effective policy differs when isolation ran out of namespaces
+    int loading_policy;
+    int effective_loading_policy;
+    uint32_t remote_restarts_seen;
+
+    static String get_global_lv2_path();
+    void create_host(uint32_t p_min_sub_block);
+    int apply_loading_policy(Lv2Host *p_host, const String &p_uri);
+    uint64_t get_remote_timeout_usec() const;
+    bool check_watchdog();
+    bool lock_watched();
+    void abandon_thread();
+
     void configure();
+    static int compute_ring_capacity(int p_block_frames, double p_latency_ms, double p_rate);
 
     Error start_thread();
     void stop_thread();
@@ -96,6 +433,51 @@ protected:
     static void _bind_methods();
 
 public:
+    enum LfoShape {
+        LFO_SINE = MODULATION_LFO_SINE,
+        LFO_TRIANGLE = MODULATION_LFO_TRIANGLE,
+        LFO_SAW = MODULATION_LFO_SAW,
+        LFO_SQUARE = MODULATION_LFO_SQUARE,
+    };
+
+    enum MidiSource {
+        MIDI_SOURCE_CC = MIDI_MAP_SOURCE_CC,
+        MIDI_SOURCE_NRPN = MIDI_MAP_SOURCE_NRPN,
+    };
+
+    enum MidiCurve {
+        MIDI_CURVE_LINEAR = MIDI_MAP_CURVE_LINEAR,
+        MIDI_CURVE_EXPONENTIAL = MIDI_MAP_CURVE_EXPONENTIAL,
+        MIDI_CURVE_LOGARITHMIC = MIDI_MAP_CURVE_LOGARITHMIC,
+        MIDI_CURVE_TOGGLE = MIDI_MAP_CURVE_TOGGLE,
+    };
+
+    enum Priority {
+        PRIORITY_LOW,
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH,
+    };
+
+    enum DegradeLevel {
+        DEGRADE_NONE,
+        DEGRADE_SKIP_TAILS,
+        DEGRADE_REDUCE_QUALITY,
+        DEGRADE_BYPASS,
+        DEGRADE_MUTE,
+    };
+
+    enum LoadingPolicy {
+        LOADING_POLICY_SHARED,
+        LOADING_POLICY_ISOLATED,
+        LOADING_POLICY_OUT_OF_PROCESS,
+    };
+
+    enum RealtimePolicy {
+        REALTIME_POLICY_NONE = LV2_REALTIME_POLICY_NONE,
+        REALTIME_POLICY_FIFO = LV2_REALTIME_POLICY_FIFO,
+        REALTIME_POLICY_RR = LV2_REALTIME_POLICY_RR,
+    };
+
     Lv2Instance();
     ~Lv2Instance();
 
@@ -109,8 +491,10 @@ public:
     void note_on(int midi_bus, int chan, int key, int vel);
     void note_off(int midi_bus, int chan, int key);
     void control_change(int midi_bus, int chan, int control, int value);
+    int send_midi_packed(const PackedByteArray &p_events, const PackedInt32Array &p_frame_offsets, int p_bus);
 
     void send_input_control_channel(int p_channel, float p_value);
+    void send_input_control_channel_at(int p_channel, float p_value, int p_frame);
     float get_input_control_channel(int p_channel);
 
     void send_output_control_channel(int p_channel, float p_value);
@@ -119,10 +503,23 @@ public:
     // val value (0-16383 with 8192 being center)
     void pitch_bend(int chan, int val);
 
-    int process_sample(AudioFrame *p_buffer, float p_rate, int p_frames);
+    int process_sample(AudioFrame *p_buffer, float p_rate, int p_frames, uint64_t p_consumer = 0);
 
     void set_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right);
-    int get_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right);
+    int get_channel_sample(AudioFrame *p_buffer, float p_rate, int p_frames, int left, int right,
+                           uint64_t p_consumer = 0);
+    int mix_channel_sample(AudioFrame *p_dst, const AudioFrame *p_dry, float p_mix, int p_frames, int left, int right,
+                           uint64_t p_consumer = 0);
+
+    void release_output_consumer(uint64_t p_consumer);
+    Array get_output_consumer_stats();
+
+    int get_ring_capacity();
+
+    void set_jitter_target_frames(int p_frames);
+    int get_jitter_target_frames();
+    int get_output_latency_frames();
+    Dictionary get_jitter_stats();
 
     void set_instance_name(const String &name);
     const String &get_instance_name();
@@ -138,9 +535,118 @@ public:
     TypedArray<Lv2Control> get_input_controls();
     TypedArray<Lv2Control> get_output_controls();
 
+    int resolve_control(const String &p_symbol);
+    int resolve_output_control(const String &p_symbol);
+
+    PackedFloat32Array get_output_controls_packed();
+    int set_input_controls_packed(const PackedInt32Array &p_indices, const PackedFloat32Array &p_values);
+
     TypedArray<String> get_presets();
     void load_preset(String p_preset);
 
+    MeterSnapshot get_meter_snapshot() const;
+    void set_true_peak_enabled(bool p_enabled);
+    bool is_true_peak_enabled();
+
+    int add_modulation_lfo(LfoShape p_shape, float p_rate_hz);
+    int add_modulation_envelope(float p_attack, float p_decay, float p_sustain, float p_release);
+    int add_modulation_curve(const Ref<Curve> &p_curve, float p_duration, bool p_loop);
+    int add_modulation_follower(const String &p_instance_name, float p_attack, float p_release);
+    int add_modulation_route(int p_source, int p_control, float p_min, float p_max);
+    void set_modulation_gate(int p_source, bool p_gate);
+    void clear_modulation();
+    void set_modulation_step_frames(int p_frames);
+    int get_modulation_step_frames();
+
+    Error load_midi_file(const String &p_path);
+    Error load_midi_data(const PackedByteArray &p_data);
+    void play_midi();
+    void stop_midi();
+    bool is_midi_playing();
+    void seek_midi(double p_seconds);
+    double get_midi_position();
+    double get_midi_length();
+    double get_midi_tempo();
+    void set_midi_loop(bool p_enabled, double p_start, double p_end);
+    bool is_midi_looping();
+    void set_midi_tempo_scale(double p_scale);
+    double get_midi_tempo_scale();
+    void set_midi_player_bus(int p_bus);
+    int get_midi_player_bus();
+    int get_midi_player_dropped();
+
+    int add_midi_mapping(MidiSource p_source, int p_channel, int p_number, int p_control, MidiCurve p_curve,
+                         float p_min, float p_max);
+    int learn_midi_mapping(int p_control, MidiCurve p_curve, float p_min, float p_max);
+    void cancel_midi_learn();
+    bool is_midi_learning();
+    void remove_midi_mapping(int p_index);
+    void clear_midi_mappings();
+    Array get_midi_mappings();
+
+    PackedByteArray save_state();
+    bool restore_state(const PackedByteArray &p_state);
+
+    void set_min_sub_block_frames(int p_frames);
+    int get_min_sub_block_frames();
+    Dictionary get_sub_block_stats();
+
+    void set_realtime_policy(RealtimePolicy p_policy, int p_priority);
+    RealtimePolicy get_realtime_policy();
+    int get_realtime_priority();
+    void set_cpu_affinity(const PackedInt32Array &p_cpus);
+    PackedInt32Array get_cpu_affinity();
+    Dictionary get_realtime_status();
+
+    void set_priority(Priority p_priority);
+    Priority get_priority();
+    DegradeLevel get_degrade_level();
+
+    void set_deadline_scheduling(bool p_enabled);
+    bool is_deadline_scheduling();
+    Dictionary get_deadline_stats();
+    void reset_deadline_stats();
+
+    void set_memory_locked(bool p_locked);
+    bool is_memory_locked();
+    Dictionary get_memory_lock_status();
+
+    void set_page_fault_tracking(bool p_enabled);
+    bool is_page_fault_tracking();
+    Dictionary get_page_fault_stats();
+    void reset_page_fault_stats();
+
+    void set_watchdog_blocks(int p_blocks);
+    int get_watchdog_blocks();
+    bool is_quarantined();
+    int get_hang_count();
+    void recover();
+
+    // plugins chained after this instance's own one, reloaded with it
+    void set_rack(const PackedStringArray &p_uris);
+    PackedStringArray get_rack();
+    int get_slot_count();
+    void set_slot_bypass(int p_slot, bool p_bypass);
+    bool is_slot_bypassed(int p_slot);
+    void set_slot_control_value(int p_slot, int p_index, float p_value);
+    float get_slot_control_value(int p_slot, int p_index);
+    Dictionary get_slot_stats(int p_slot);
+    void reset_slot_stats();
+
+    // MIDI the plugin sent since the last call, MIDI_OUT_RECORD_BYTES per event: the event's frame on the
+    // instance's output timeline (int64), bus, size, up to three data bytes and padding
+    PackedByteArray drain_midi_output(int p_max_events = -1);
+    int get_midi_output_dropped();
+    // control changes and MIDI events the host's per-block queues had no room for (modulation, MIDI learn, the
+    // MIDI player and routed MIDI)
+    int get_control_events_dropped();
+    int get_midi_input_dropped();
+
+    LoadingPolicy get_loading_policy();
+    LoadingPolicy get_effective_loading_policy();
+    bool is_out_of_process();
+    Dictionary get_remote_stats();
+
     double get_time_since_last_mix();
     double get_time_to_next_mix();
 
@@ -152,4 +658,12 @@ public:
 };
 } // namespace godot
 
+VARIANT_ENUM_CAST(Lv2Instance::LfoShape);
+VARIANT_ENUM_CAST(Lv2Instance::MidiSource);
+VARIANT_ENUM_CAST(Lv2Instance::MidiCurve);
+VARIANT_ENUM_CAST(Lv2Instance::RealtimePolicy);
+VARIANT_ENUM_CAST(Lv2Instance::Priority);
+VARIANT_ENUM_CAST(Lv2Instance::DegradeLevel);
+VARIANT_ENUM_CAST(Lv2Instance::LoadingPolicy);
+
 #endif
@@ -26,10 +26,107 @@ bool Lv2Layout::_set(const StringName &p_name, const Variant &p_value) {
             lv2.volume_db = p_value;
         } else if (what == "uri") {
             lv2.uri = p_value;
+        } else if (what == "priority") {
+            lv2.priority = p_value;
+        } else if (what == "rack") {
+            lv2.rack = p_value;
+        } else if (what == "rack_bypass") {
+            lv2.rack_bypass = p_value;
         } else {
             return false;
         }
 
+        return true;
+    } else if (s.begins_with("connection/")) {
+        int index = s.get_slice("/", 1).to_int();
+        if (index < 0) {
+            return false;
+        }
+        if (connections.size() <= index) {
+            connections.resize(index + 1);
+        }
+
+        Connection &connection = connections.write[index];
+
+        String what = s.get_slice("/", 2);
+
+        if (what == "from") {
+            connection.from = p_value;
+        } else if (what == "from_port") {
+            connection.from_port = p_value;
+        } else if (what == "to") {
+            connection.to = p_value;
+        } else if (what == "to_port") {
+            connection.to_port = p_value;
+        } else if (what == "type") {
+            connection.type = p_value;
+        } else {
+            return false;
+        }
+
+        return true;
+    } else if (s.begins_with("midi_route/")) {
+        int index = s.get_slice("/", 1).to_int();
+        if (index < 0) {
+            return false;
+        }
+        if (midi_routes.size() <= index) {
+            midi_routes.resize(index + 1);
+        }
+
+        MidiRoute &route = midi_routes.write[index];
+
+        String what = s.get_slice("/", 2);
+
+        if (what == "device") {
+            route.device = p_value;
+        } else if (what == "channel") {
+            route.channel = p_value;
+        } else if (what == "instance") {
+            route.instance = p_value;
+        } else if (what == "bus") {
+            route.bus = p_value;
+        } else {
+            return false;
+        }
+
+        return true;
+    } else if (s.begins_with("midi_mapping/")) {
+        int index = s.get_slice("/", 1).to_int();
+        if (index < 0) {
+            return false;
+        }
+        if (midi_mappings.size() <= index) {
+            midi_mappings.resize(index + 1);
+        }
+
+        MidiMapping &mapping = midi_mappings.write[index];
+
+        String what = s.get_slice("/", 2);
+
+        if (what == "instance") {
+            mapping.instance = p_value;
+        } else if (what == "source") {
+            mapping.source = p_value;
+        } else if (what == "channel") {
+            mapping.channel = p_value;
+        } else if (what == "number") {
+            mapping.number = p_value;
+        } else if (what == "control") {
+            mapping.control = p_value;
+        } else if (what == "curve") {
+            mapping.curve = p_value;
+        } else if (what == "min") {
+            mapping.min = p_value;
+        } else if (what == "max") {
+            mapping.max = p_value;
+        } else {
+            return false;
+        }
+
+        return true;
+    } else if (s == "loading_policies") {
+        loading_policies = p_value;
         return true;
     }
 
@@ -60,10 +157,98 @@ bool Lv2Layout::_get(const StringName &p_name, Variant &r_ret) const {
             r_ret = lv2.volume_db;
         } else if (what == "uri") {
             r_ret = lv2.uri;
+        } else if (what == "priority") {
+            r_ret = lv2.priority;
+        } else if (what == "rack") {
+            r_ret = lv2.rack;
+        } else if (what == "rack_bypass") {
+            r_ret = lv2.rack_bypass;
         } else {
             return false;
         }
 
+        return true;
+    } else if (s.begins_with("connection/")) {
+        int index = s.get_slice("/", 1).to_int();
+        if (index < 0 || index >= connections.size()) {
+            return false;
+        }
+
+        const Connection &connection = connections[index];
+
+        String what = s.get_slice("/", 2);
+
+        if (what == "from") {
+            r_ret = connection.from;
+        } else if (what == "from_port") {
+            r_ret = connection.from_port;
+        } else if (what == "to") {
+            r_ret = connection.to;
+        } else if (what == "to_port") {
+            r_ret = connection.to_port;
+        } else if (what == "type") {
+            r_ret = connection.type;
+        } else {
+            return false;
+        }
+
+        return true;
+    } else if (s.begins_with("midi_route/")) {
+        int index = s.get_slice("/", 1).to_int();
+        if (index < 0 || index >= midi_routes.size()) {
+            return false;
+        }
+
+        const MidiRoute &route = midi_routes[index];
+
+        String what = s.get_slice("/", 2);
+
+        if (what == "device") {
+            r_ret = route.device;
+        } else if (what == "channel") {
+            r_ret = route.channel;
+        } else if (what == "instance") {
+            r_ret = route.instance;
+        } else if (what == "bus") {
+            r_ret = route.bus;
+        } else {
+            return false;
+        }
+
+        return true;
+    } else if (s.begins_with("midi_mapping/")) {
+        int index = s.get_slice("/", 1).to_int();
+        if (index < 0 || index >= midi_mappings.size()) {
+            return false;
+        }
+
+        const MidiMapping &mapping = midi_mappings[index];
+
+        String what = s.get_slice("/", 2);
+
+        if (what == "instance") {
+            r_ret = mapping.instance;
+        } else if (what == "source") {
+            r_ret = mapping.source;
+        } else if (what == "channel") {
+            r_ret = mapping.channel;
+        } else if (what == "number") {
+            r_ret = mapping.number;
+        } else if (what == "control") {
+            r_ret = mapping.control;
+        } else if (what == "curve") {
+            r_ret = mapping.curve;
+        } else if (what == "min") {
+            r_ret = mapping.min;
+        } else if (what == "max") {
+            r_ret = mapping.max;
+        } else {
+            return false;
+        }
+
+        return true;
+    } else if (s == "loading_policies") {
+        r_ret = loading_policies;
         return true;
     }
 
@@ -84,7 +269,55 @@ void Lv2Layout::_get_property_list(List<PropertyInfo> *p_list) const {
                                        PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
         p_list->push_back(PropertyInfo(Variant::STRING, "lv2/" + itos(i) + "/uri", PROPERTY_HINT_NONE, "",
                                        PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "lv2/" + itos(i) + "/priority", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::PACKED_STRING_ARRAY, "lv2/" + itos(i) + "/rack", PROPERTY_HINT_NONE,
+                                       "", PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::ARRAY, "lv2/" + itos(i) + "/rack_bypass", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+    }
+    for (int i = 0; i < connections.size(); i++) {
+        p_list->push_back(PropertyInfo(Variant::STRING, "connection/" + itos(i) + "/from", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "connection/" + itos(i) + "/from_port", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::STRING, "connection/" + itos(i) + "/to", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "connection/" + itos(i) + "/to_port", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "connection/" + itos(i) + "/type", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+    }
+    for (int i = 0; i < midi_routes.size(); i++) {
+        p_list->push_back(PropertyInfo(Variant::STRING, "midi_route/" + itos(i) + "/device", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "midi_route/" + itos(i) + "/channel", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::STRING, "midi_route/" + itos(i) + "/instance", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "midi_route/" + itos(i) + "/bus", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+    }
+    for (int i = 0; i < midi_mappings.size(); i++) {
+        p_list->push_back(PropertyInfo(Variant::STRING, "midi_mapping/" + itos(i) + "/instance", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "midi_mapping/" + itos(i) + "/source", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "midi_mapping/" + itos(i) + "/channel", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "midi_mapping/" + itos(i) + "/number", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::STRING, "midi_mapping/" + itos(i) + "/control", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::INT, "midi_mapping/" + itos(i) + "/curve", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::FLOAT, "midi_mapping/" + itos(i) + "/min", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
+        p_list->push_back(PropertyInfo(Variant::FLOAT, "midi_mapping/" + itos(i) + "/max", PROPERTY_HINT_NONE, "",
+                                       PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
     }
+    p_list->push_back(PropertyInfo(Variant::DICTIONARY, "loading_policies", PROPERTY_HINT_NONE, "",
+                                   PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL));
 }
 
 Lv2Layout::Lv2Layout() {
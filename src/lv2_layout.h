@@ -3,6 +3,9 @@
 
 #include <godot_cpp/classes/resource.hpp>
 #include <godot_cpp/templates/vector.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
 
 namespace godot {
 
@@ -17,12 +20,67 @@ class Lv2Layout : public Resource {
         bool bypass = false;
         float volume_db = 0.0f;
         String uri;
+        // Lv2Instance::Priority
+        int priority = 1;
+        // rack mode: plugins chained after uri, and the bypass of every slot including uri's
+        PackedStringArray rack;
+        Array rack_bypass;
 
         Lv2() {
         }
     };
 
+    // an output of one instance routed into an input of another, by instance name
+    struct Connection {
+        String from;
+        int from_port = 0;
+        String to;
+        int to_port = 0;
+        // Lv2Server::ConnectionType
+        int type = 0;
+
+        Connection() {
+        }
+    };
+
+    // hardware MIDI input delivered to an instance, see Lv2Server::add_midi_route()
+    struct MidiRoute {
+        // connected input name, empty for any
+        String device;
+        // 0-15, -1 for any
+        int channel = -1;
+        String instance;
+        int bus = 0;
+
+        MidiRoute() {
+        }
+    };
+
+    // a CC or NRPN driving a control of an instance, see Lv2Instance::add_midi_mapping()
+    struct MidiMapping {
+        String instance;
+        // Lv2Instance::MidiSource
+        int source = 0;
+        // 0-15, -1 for any
+        int channel = -1;
+        int number = 0;
+        // control symbol
+        String control;
+        // Lv2Instance::MidiCurve
+        int curve = 0;
+        float min = 0.0f;
+        float max = 1.0f;
+
+        MidiMapping() {
+        }
+    };
+
     Vector<Lv2> instances;
+    Vector<Connection> connections;
+    Vector<MidiRoute> midi_routes;
+    Vector<MidiMapping> midi_mappings;
+    // plugin uri -> Lv2Instance::LoadingPolicy
+    Dictionary loading_policies;
 
 protected:
     static void _bind_methods();
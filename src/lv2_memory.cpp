@@ -0,0 +1,218 @@
+#include "lv2_memory.h"
+
+#include <cerrno>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <alloca.h>
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#define LV2_MEMORY_POSIX 1
+#endif
+
+namespace godot {
+
+namespace {
+
+size_t page_size() {
+#ifdef LV2_MEMORY_POSIX
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+// reads one byte per page so anything swapped out or reclaimed is brought back; the buffers are all written when
+// they are allocated, and a read never races with a writer on another thread
+void prefault(uintptr_t p_data, size_t p_bytes) {
+    const size_t page = page_size();
+    uintptr_t address = p_data;
+    while (address < p_data + p_bytes) {
+        (void)*reinterpret_cast<volatile const uint8_t *>(address);
+        address = (address & ~(uintptr_t)(page - 1)) + page;
+    }
+}
+
+#ifdef LV2_MEMORY_POSIX
+// mlock doesn't nest and regions are widened to whole pages, so neighbouring allocations (of any instance) can
+// share a page: every pinned page is counted process-wide and only unpinned when the last region holding it goes
+std::mutex locked_pages_mutex;
+std::unordered_map<uintptr_t, uint32_t> locked_pages;
+
+// runs of pages in [p_begin, p_begin + p_bytes) not pinned by anyone yet, handed to p_apply(begin, bytes) until it
+// returns false
+template <typename F> bool for_each_unpinned_run(uintptr_t p_begin, size_t p_bytes, F p_apply) {
+    const size_t page = page_size();
+    uintptr_t run = 0;
+    for (uintptr_t address = p_begin; address <= p_begin + p_bytes; address += page) {
+        const bool unpinned = address < p_begin + p_bytes && locked_pages.find(address) == locked_pages.end();
+        if (unpinned && run == 0) {
+            run = address;
+        } else if (!unpinned && run != 0) {
+            if (!p_apply(run, address - run)) {
+                return false;
+            }
+            run = 0;
+        }
+    }
+    return true;
+}
+
+// p_begin and p_bytes are page aligned; false (with errno set) if mlock refused, nothing changes then
+bool pin_pages(uintptr_t p_begin, size_t p_bytes) {
+    std::lock_guard<std::mutex> guard(locked_pages_mutex);
+
+    std::vector<std::pair<uintptr_t, size_t>> pinned;
+    bool ok = for_each_unpinned_run(p_begin, p_bytes, [&pinned](uintptr_t p_run, size_t p_run_bytes) {
+        if (mlock(reinterpret_cast<const void *>(p_run), p_run_bytes) != 0) {
+            return false;
+        }
+        pinned.emplace_back(p_run, p_run_bytes);
+        return true;
+    });
+    if (!ok) {
+        const int refused = errno;
+        for (const auto &run : pinned) {
+            munlock(reinterpret_cast<const void *>(run.first), run.second);
+        }
+        errno = refused;
+        return false;
+    }
+
+    const size_t page = page_size();
+    for (uintptr_t address = p_begin; address < p_begin + p_bytes; address += page) {
+        locked_pages[address]++;
+    }
+    return true;
+}
+
+void unpin_pages(uintptr_t p_begin, size_t p_bytes) {
+    std::lock_guard<std::mutex> guard(locked_pages_mutex);
+
+    const size_t page = page_size();
+    for (uintptr_t address = p_begin; address < p_begin + p_bytes; address += page) {
+        auto it = locked_pages.find(address);
+        if (it != locked_pages.end() && --it->second == 0) {
+            locked_pages.erase(it);
+        }
+    }
+    for_each_unpinned_run(p_begin, p_bytes, [](uintptr_t p_run, size_t p_run_bytes) {
+        munlock(reinterpret_cast<const void *>(p_run), p_run_bytes);
+        return true;
+    });
+}
+#endif
+
+} // namespace
+
+bool lv2_thread_page_faults(Lv2PageFaults &r_faults) {
+#if defined(__linux__) && defined(RUSAGE_THREAD)
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+        return false;
+    }
+    r_faults.minor = (uint64_t)usage.ru_minflt;
+    r_faults.major = (uint64_t)usage.ru_majflt;
+    return true;
+#else
+    (void)r_faults;
+    return false;
+#endif
+}
+
+bool lv2_prefault_stack(size_t p_bytes) {
+    const size_t page = page_size();
+    uint8_t *stack = static_cast<uint8_t *>(alloca(p_bytes));
+    for (size_t offset = 0; offset < p_bytes; offset += page) {
+        static_cast<volatile uint8_t *>(stack)[offset] = 0;
+    }
+#ifdef LV2_MEMORY_POSIX
+    return mlock(stack, p_bytes) == 0;
+#else
+    return false;
+#endif
+}
+
+Lv2MemoryLock::Lv2MemoryLock() {
+}
+
+Lv2MemoryLock::~Lv2MemoryLock() {
+    unlock();
+}
+
+void Lv2MemoryLock::add(const void *p_data, size_t p_bytes) {
+    if (!p_data || p_bytes == 0) {
+        return;
+    }
+    const size_t page = page_size();
+    uintptr_t begin = reinterpret_cast<uintptr_t>(p_data) & ~(uintptr_t)(page - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(p_data) + p_bytes + page - 1) & ~(uintptr_t)(page - 1);
+
+    Region region;
+    region.data = reinterpret_cast<uintptr_t>(p_data);
+    region.data_bytes = p_bytes;
+    region.begin = begin;
+    region.bytes = end - begin;
+    regions.push_back(region);
+}
+
+void Lv2MemoryLock::lock() {
+    error = 0;
+    for (Region &region : regions) {
+        if (region.locked) {
+            continue;
+        }
+        prefault(region.data, region.data_bytes);
+#ifdef LV2_MEMORY_POSIX
+        if (pin_pages(region.begin, region.bytes)) {
+            region.locked = true;
+            locked_bytes += region.bytes;
+        } else if (error == 0) {
+            error = errno;
+        }
+#else
+        error = ENOSYS;
+#endif
+    }
+}
+
+void Lv2MemoryLock::unlock() {
+    for (Region &region : regions) {
+        if (!region.locked) {
+            continue;
+        }
+#ifdef LV2_MEMORY_POSIX
+        unpin_pages(region.begin, region.bytes);
+#endif
+        region.locked = false;
+    }
+    locked_bytes = 0;
+}
+
+void Lv2MemoryLock::clear() {
+    unlock();
+    regions.clear();
+    error = 0;
+}
+
+int Lv2MemoryLock::get_region_count() const {
+    return (int)regions.size();
+}
+
+size_t Lv2MemoryLock::get_locked_bytes() const {
+    return locked_bytes;
+}
+
+int Lv2MemoryLock::get_error() const {
+    return error;
+}
+
+} // namespace godot
@@ -0,0 +1,65 @@
+#ifndef LV2_MEMORY_H
+#define LV2_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+struct Lv2PageFaults {
+    uint64_t minor = 0;
+    uint64_t major = 0;
+};
+
+// Page faults taken so far by the calling thread (getrusage RUSAGE_THREAD), false where that isn't available.
+bool lv2_thread_page_faults(Lv2PageFaults &r_faults);
+
+// Grows the calling thread's stack by p_bytes ahead of time and pins those pages, false if mlock was refused.
+bool lv2_prefault_stack(size_t p_bytes);
+
+// Memory the realtime path touches, prefaulted and pinned with mlock so the DSP thread never takes a page fault
+// on it. Regions are widened to whole pages, which are counted process-wide: a page shared with a neighbouring
+// allocation stays pinned until every lock holding it has let go. Needs RLIMIT_MEMLOCK (or CAP_IPC_LOCK) large
+// enough, otherwise the regions are still prefaulted and get_error() holds the errno of the first refused mlock.
+class Lv2MemoryLock {
+private:
+    struct Region {
+        // the caller's bytes, the only ones touched while prefaulting
+        uintptr_t data = 0;
+        size_t data_bytes = 0;
+        // the pages holding them
+        uintptr_t begin = 0;
+        size_t bytes = 0;
+        bool locked = false;
+    };
+
+    std::vector<Region> regions;
+    size_t locked_bytes{};
+    int error{};
+
+public:
+    Lv2MemoryLock();
+    ~Lv2MemoryLock();
+
+    Lv2MemoryLock(const Lv2MemoryLock &) = delete;
+    Lv2MemoryLock &operator=(const Lv2MemoryLock &) = delete;
+
+    void add(const void *p_data, size_t p_bytes);
+    template <typename T> void add_vector(const std::vector<T> &p_vector) {
+        add(p_vector.data(), p_vector.capacity() * sizeof(T));
+    }
+
+    // touches every page of every region, then mlocks it (which also faults in anything not yet present)
+    void lock();
+    void unlock();
+    void clear();
+
+    int get_region_count() const;
+    size_t get_locked_bytes() const;
+    int get_error() const;
+};
+
+} // namespace godot
+
+#endif
@@ -0,0 +1,190 @@
+#include "lv2_midi_map.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace godot;
+
+static const int MIDI_MAP_CC_DATA_ENTRY_MSB = 6;
+static const int MIDI_MAP_CC_DATA_ENTRY_LSB = 38;
+static const int MIDI_MAP_CC_DATA_INCREMENT = 96;
+static const int MIDI_MAP_CC_NRPN_LSB = 98;
+static const int MIDI_MAP_CC_NRPN_MSB = 99;
+static const int MIDI_MAP_CC_RPN_LSB = 100;
+static const int MIDI_MAP_CC_RPN_MSB = 101;
+// CC 120 and up are channel mode messages (all notes off, reset, ...)
+static const int MIDI_MAP_CC_CHANNEL_MODE = 120;
+
+Lv2MidiMap::Lv2MidiMap() {
+    // learning fills mappings in on the DSP thread, they never move once added
+    mappings.reserve(MIDI_MAP_MAX_MAPPINGS);
+}
+
+Lv2MidiMap::~Lv2MidiMap() {
+}
+
+int Lv2MidiMap::add(const MidiMapping &p_mapping) {
+    if ((int)mappings.size() >= MIDI_MAP_MAX_MAPPINGS) {
+        return -1;
+    }
+
+    mappings.push_back(p_mapping);
+    return (int)mappings.size() - 1;
+}
+
+void Lv2MidiMap::remove(int p_index) {
+    if (p_index < 0 || p_index >= (int)mappings.size()) {
+        return;
+    }
+    mappings.erase(mappings.begin() + p_index);
+}
+
+void Lv2MidiMap::clear() {
+    mappings.clear();
+}
+
+void Lv2MidiMap::cancel_learn() {
+    mappings.erase(std::remove_if(mappings.begin(), mappings.end(),
+                                  [](const MidiMapping &p_mapping) { return p_mapping.learning; }),
+                   mappings.end());
+}
+
+bool Lv2MidiMap::is_learning() const {
+    for (const MidiMapping &mapping : mappings) {
+        if (mapping.learning) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<MidiMapping> &Lv2MidiMap::get_mappings() const {
+    return mappings;
+}
+
+void Lv2MidiMap::resolve(Lv2Host *p_host) {
+    const int count = p_host->get_input_control_count();
+
+    for (MidiMapping &mapping : mappings) {
+        mapping.control = MIDI_MAP_UNRESOLVED;
+        for (int i = 0; i < count; i++) {
+            const LilvControl *control = p_host->get_input_control(i);
+            if (control != nullptr && control->symbol == mapping.symbol) {
+                mapping.control = (uint32_t)i;
+                break;
+            }
+        }
+    }
+}
+
+uint32_t Lv2MidiMap::get_learned_count() const {
+    return learned.load(std::memory_order_acquire);
+}
+
+int Lv2MidiMap::get_last_learned() const {
+    return last_learned.load(std::memory_order_relaxed);
+}
+
+float Lv2MidiMap::shape(const MidiMapping &p_mapping, float p_value) {
+    float value = std::min(std::max(p_value, 0.0f), 1.0f);
+
+    switch (p_mapping.curve) {
+    case MIDI_MAP_CURVE_EXPONENTIAL:
+        if (p_mapping.min > 0.0f && p_mapping.max > 0.0f) {
+            return p_mapping.min * std::pow(p_mapping.max / p_mapping.min, value);
+        }
+        value = value * value;
+        break;
+    case MIDI_MAP_CURVE_LOGARITHMIC:
+        value = 1.0f - (1.0f - value) * (1.0f - value);
+        break;
+    case MIDI_MAP_CURVE_TOGGLE:
+        return value >= 0.5f ? p_mapping.max : p_mapping.min;
+    default:
+        break;
+    }
+
+    return p_mapping.min + (p_mapping.max - p_mapping.min) * value;
+}
+
+void Lv2MidiMap::apply(MidiMapSource p_source, int p_channel, int p_number, float p_value, int p_frame,
+                       bool p_learn, Lv2Host *p_host) {
+    for (size_t i = 0; i < mappings.size(); i++) {
+        MidiMapping &mapping = mappings[i];
+
+        if (mapping.learning) {
+            if (!p_learn) {
+                continue;
+            }
+            mapping.source = p_source;
+            mapping.channel = p_channel;
+            mapping.number = p_number;
+            mapping.learning = false;
+            last_learned.store((int)i, std::memory_order_relaxed);
+            learned.fetch_add(1, std::memory_order_release);
+        } else if (mapping.source != p_source || mapping.number != p_number ||
+                   (mapping.channel >= 0 && mapping.channel != p_channel)) {
+            continue;
+        }
+
+        if (mapping.control == MIDI_MAP_UNRESOLVED) {
+            continue;
+        }
+
+        ControlEvent event;
+        event.frame = p_frame;
+        event.index = mapping.control;
+        event.value = shape(mapping, p_value);
+        p_host->queue_control_event(event);
+    }
+}
+
+void Lv2MidiMap::process(const MidiEvent &p_event, Lv2Host *p_host) {
+    if (mappings.empty() || p_event.size < 3 || (p_event.data[0] & 0xf0) != 0xb0) {
+        return;
+    }
+
+    const int channel = p_event.data[0] & 0x0f;
+    const int number = p_event.data[1] & 0x7f;
+    const uint8_t value = p_event.data[2] & 0x7f;
+    ParameterState &state = parameters[channel];
+    const bool selected = state.nrpn && (state.number_msb != 0x7f || state.number_lsb != 0x7f);
+    const int parameter = (state.number_msb << 7) | state.number_lsb;
+
+    switch (number) {
+    case MIDI_MAP_CC_NRPN_MSB:
+        state.number_msb = value;
+        state.nrpn = true;
+        break;
+    case MIDI_MAP_CC_NRPN_LSB:
+        state.number_lsb = value;
+        state.nrpn = true;
+        break;
+    case MIDI_MAP_CC_RPN_MSB:
+    case MIDI_MAP_CC_RPN_LSB:
+        state.nrpn = false;
+        break;
+    case MIDI_MAP_CC_DATA_ENTRY_MSB:
+        state.data_msb = value;
+        if (selected) {
+            apply(MIDI_MAP_SOURCE_NRPN, channel, parameter, (value << 7) / 16383.0f, p_event.frame, true,
+                  p_host);
+        }
+        break;
+    case MIDI_MAP_CC_DATA_ENTRY_LSB:
+        if (selected) {
+            apply(MIDI_MAP_SOURCE_NRPN, channel, parameter, ((state.data_msb << 7) | value) / 16383.0f,
+                  p_event.frame, true, p_host);
+        }
+        break;
+    default:
+        break;
+    }
+
+    // parameter selection, data entry and channel mode messages are only matched by mappings added explicitly,
+    // never learned as plain CCs
+    const bool learnable = number < MIDI_MAP_CC_CHANNEL_MODE && number != MIDI_MAP_CC_DATA_ENTRY_MSB &&
+                           number != MIDI_MAP_CC_DATA_ENTRY_LSB &&
+                           (number < MIDI_MAP_CC_DATA_INCREMENT || number > MIDI_MAP_CC_RPN_MSB);
+    apply(MIDI_MAP_SOURCE_CC, channel, number, value / 127.0f, p_event.frame, learnable, p_host);
+}
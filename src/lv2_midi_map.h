@@ -0,0 +1,96 @@
+#ifndef LV2_MIDI_MAP_H
+#define LV2_MIDI_MAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lv2_host.h"
+
+namespace godot {
+
+const int MIDI_MAP_MAX_MAPPINGS = 256;
+const uint32_t MIDI_MAP_UNRESOLVED = UINT32_MAX;
+
+enum MidiMapSource {
+    MIDI_MAP_SOURCE_CC,
+    MIDI_MAP_SOURCE_NRPN,
+};
+
+enum MidiMapCurve {
+    MIDI_MAP_CURVE_LINEAR,
+    // geometric between min and max when both are positive (frequencies, times), squared otherwise
+    MIDI_MAP_CURVE_EXPONENTIAL,
+    // the mirror of the squared curve, fast at the bottom and fine at the top
+    MIDI_MAP_CURVE_LOGARITHMIC,
+    // min below the middle of the range, max from there on
+    MIDI_MAP_CURVE_TOGGLE,
+};
+
+struct MidiMapping {
+    MidiMapSource source = MIDI_MAP_SOURCE_CC;
+    // 0-15, -1 for any
+    int channel = -1;
+    // 0-127 for a CC, 0-16383 for an NRPN
+    int number = 0;
+    // the control is kept by symbol so the mapping survives a plugin reload, control is its index in the
+    // current plugin
+    std::string symbol;
+    uint32_t control = MIDI_MAP_UNRESOLVED;
+    MidiMapCurve curve = MIDI_MAP_CURVE_LINEAR;
+    float min = 0.0f;
+    float max = 1.0f;
+    // waiting for the next CC or NRPN to fill in source, channel and number
+    bool learning = false;
+};
+
+// Turns CC and NRPN messages into control changes. Set up from other threads under the owner's lock, process()
+// runs on the DSP thread while the host drains its MIDI inputs and queues the changes at the frame of the message.
+class Lv2MidiMap {
+private:
+    // NRPN parameter number and data entry per channel, built from CC 99/98 and 6/38
+    struct ParameterState {
+        uint8_t number_msb = 0x7f;
+        uint8_t number_lsb = 0x7f;
+        uint8_t data_msb = 0;
+        // false once an RPN (CC 101/100) was selected
+        bool nrpn = false;
+    };
+
+    std::vector<MidiMapping> mappings;
+    ParameterState parameters[16];
+
+    std::atomic<uint32_t> learned{0};
+    std::atomic<int> last_learned{-1};
+
+    static float shape(const MidiMapping &p_mapping, float p_value);
+    void apply(MidiMapSource p_source, int p_channel, int p_number, float p_value, int p_frame, bool p_learn,
+               Lv2Host *p_host);
+
+public:
+    Lv2MidiMap();
+    ~Lv2MidiMap();
+
+    // -1 once MIDI_MAP_MAX_MAPPINGS are in use
+    int add(const MidiMapping &p_mapping);
+    void remove(int p_index);
+    void clear();
+    void cancel_learn();
+    bool is_learning() const;
+    const std::vector<MidiMapping> &get_mappings() const;
+
+    // looks the symbols up in a freshly loaded plugin, unknown ones stay unresolved
+    void resolve(Lv2Host *p_host);
+
+    // bumped by the DSP thread for every mapping learned, with the index of the latest one
+    uint32_t get_learned_count() const;
+    int get_last_learned() const;
+
+    // DSP thread: queues a control change on p_host for every mapping p_event matches, never allocates
+    void process(const MidiEvent &p_event, Lv2Host *p_host);
+};
+
+} // namespace godot
+
+#endif
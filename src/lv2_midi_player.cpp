@@ -0,0 +1,521 @@
+#include "lv2_midi_player.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace godot;
+
+static const double MIDI_PLAYER_MIN_LOOP = 0.001;
+static const double MIDI_PLAYER_MIN_TEMPO_SCALE = 0.01;
+static const double MIDI_PLAYER_MAX_TEMPO_SCALE = 100.0;
+
+namespace {
+
+struct SmfReader {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+
+    bool has(size_t p_bytes) const {
+        return offset <= size && size - offset >= p_bytes;
+    }
+
+    uint32_t read_be(int p_bytes) {
+        uint32_t value = 0;
+        for (int i = 0; i < p_bytes; i++) {
+            value = (value << 8) | data[offset++];
+        }
+        return value;
+    }
+
+    // variable length quantity, at most four bytes
+    bool read_vlq(uint32_t &r_value) {
+        r_value = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!has(1)) {
+                return false;
+            }
+            uint8_t byte = data[offset++];
+            r_value = (r_value << 7) | (byte & 0x7f);
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+struct SmfEntry {
+    uint64_t tick;
+    bool tempo;
+    uint32_t usec_per_quarter;
+    MidiPlayerEvent event;
+};
+
+int channel_message_size(uint8_t p_status) {
+    switch (p_status & 0xf0) {
+    case 0xc0:
+    case 0xd0:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+// appends the entries of one MTrk chunk, r_end_tick is the tick of its last event
+bool parse_track(SmfReader p_reader, uint64_t p_start_tick, std::vector<SmfEntry> &r_entries, uint64_t &r_end_tick,
+                 std::string &r_error) {
+    uint64_t tick = p_start_tick;
+    uint8_t running_status = 0;
+
+    while (p_reader.has(1)) {
+        uint32_t delta;
+        if (!p_reader.read_vlq(delta) || !p_reader.has(1)) {
+            r_error = "truncated event";
+            return false;
+        }
+        tick += delta;
+
+        uint8_t status = p_reader.data[p_reader.offset];
+        if (status & 0x80) {
+            p_reader.offset++;
+        } else if (running_status != 0) {
+            status = running_status;
+        } else {
+            r_error = "data byte without running status";
+            return false;
+        }
+
+        if (status == 0xff) {
+            uint32_t length;
+            if (!p_reader.has(1)) {
+                r_error = "truncated meta event";
+                return false;
+            }
+            uint8_t type = p_reader.data[p_reader.offset++];
+            if (!p_reader.read_vlq(length) || !p_reader.has(length)) {
+                r_error = "truncated meta event";
+                return false;
+            }
+            if (type == 0x51 && length == 3) {
+                SmfEntry entry{};
+                entry.tick = tick;
+                entry.tempo = true;
+                entry.usec_per_quarter = p_reader.read_be(3);
+                if (entry.usec_per_quarter > 0) {
+                    r_entries.push_back(entry);
+                }
+            } else {
+                p_reader.offset += length;
+            }
+            if (type == 0x2f) {
+                break;
+            }
+            running_status = 0;
+        } else if (status == 0xf0 || status == 0xf7) {
+            uint32_t length;
+            if (!p_reader.read_vlq(length) || !p_reader.has(length)) {
+                r_error = "truncated sysex event";
+                return false;
+            }
+            p_reader.offset += length;
+            running_status = 0;
+        } else if (status >= 0xf0) {
+            r_error = "unexpected system message in track";
+            return false;
+        } else {
+            int size = channel_message_size(status);
+            if (!p_reader.has(size - 1)) {
+                r_error = "truncated channel message";
+                return false;
+            }
+            SmfEntry entry{};
+            entry.tick = tick;
+            entry.event.size = (uint8_t)size;
+            entry.event.data[0] = status;
+            for (int i = 1; i < size; i++) {
+                entry.event.data[i] = p_reader.data[p_reader.offset++] & 0x7f;
+            }
+            r_entries.push_back(entry);
+            running_status = status;
+        }
+    }
+
+    r_end_tick = tick;
+    return true;
+}
+
+} // namespace
+
+bool Lv2MidiSequence::parse(const uint8_t *p_data, size_t p_size, std::string &r_error) {
+    SmfReader reader{p_data, p_size, 0};
+
+    if (!reader.has(14) || std::memcmp(p_data, "MThd", 4) != 0) {
+        r_error = "not a standard MIDI file";
+        return false;
+    }
+    reader.offset = 4;
+    uint32_t header_length = reader.read_be(4);
+    if (header_length < 6 || !reader.has(header_length)) {
+        r_error = "invalid header chunk";
+        return false;
+    }
+    size_t header_end = reader.offset + header_length;
+    int file_format = (int)reader.read_be(2);
+    int declared_tracks = (int)reader.read_be(2);
+    uint16_t division = (uint16_t)reader.read_be(2);
+    reader.offset = header_end;
+
+    if (file_format > 2) {
+        r_error = "unsupported SMF format " + std::to_string(file_format);
+        return false;
+    }
+
+    // ticks to seconds: quarter note based (tempo dependent) or SMPTE frames (fixed)
+    double seconds_per_tick = 0.0;
+    uint32_t ticks_per_quarter = 0;
+    if (division & 0x8000) {
+        int fps = -(int8_t)(division >> 8);
+        int ticks_per_frame = division & 0xff;
+        if (fps <= 0 || ticks_per_frame == 0) {
+            r_error = "invalid SMPTE division";
+            return false;
+        }
+        seconds_per_tick = 1.0 / ((fps == 29 ? 29.97 : fps) * ticks_per_frame);
+    } else {
+        ticks_per_quarter = division;
+        if (ticks_per_quarter == 0) {
+            r_error = "invalid division";
+            return false;
+        }
+    }
+
+    std::vector<SmfEntry> entries;
+    uint64_t end_tick = 0;
+    int tracks = 0;
+
+    while (reader.has(8) && tracks < declared_tracks) {
+        bool is_track = std::memcmp(p_data + reader.offset, "MTrk", 4) == 0;
+        reader.offset += 4;
+        uint32_t chunk_length = reader.read_be(4);
+        if (!reader.has(chunk_length)) {
+            r_error = "truncated track chunk";
+            return false;
+        }
+        if (is_track) {
+            SmfReader track_reader{p_data, reader.offset + chunk_length, reader.offset};
+            // format 2 tracks are independent patterns, played back to back
+            uint64_t start_tick = file_format == 2 ? end_tick : 0;
+            uint64_t track_end = 0;
+            if (!parse_track(track_reader, start_tick, entries, track_end, r_error)) {
+                r_error = "track " + std::to_string(tracks) + ": " + r_error;
+                return false;
+            }
+            end_tick = std::max(end_tick, track_end);
+            tracks++;
+        }
+        reader.offset += chunk_length;
+    }
+
+    // tracks were appended one after the other, a stable sort merges them and keeps same-tick order
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const SmfEntry &p_a, const SmfEntry &p_b) { return p_a.tick < p_b.tick; });
+
+    std::vector<MidiPlayerTempo> map(1);
+    std::vector<MidiPlayerEvent> flat;
+    flat.reserve(entries.size());
+
+    auto tick_seconds = [&](uint64_t p_tick) {
+        const MidiPlayerTempo &tempo = map.back();
+        if (ticks_per_quarter == 0) {
+            return p_tick * seconds_per_tick;
+        }
+        return tempo.seconds + (double)(p_tick - tempo.tick) * tempo.usec_per_quarter / (1e6 * ticks_per_quarter);
+    };
+
+    for (const SmfEntry &entry : entries) {
+        if (entry.tempo) {
+            MidiPlayerTempo tempo;
+            tempo.tick = entry.tick;
+            tempo.seconds = tick_seconds(entry.tick);
+            tempo.usec_per_quarter = entry.usec_per_quarter;
+            if (map.back().tick == entry.tick) {
+                map.back() = tempo;
+            } else {
+                map.push_back(tempo);
+            }
+            continue;
+        }
+        MidiPlayerEvent event = entry.event;
+        event.seconds = tick_seconds(entry.tick);
+        flat.push_back(event);
+    }
+
+    length = tick_seconds(end_tick);
+    events.swap(flat);
+    tempo_map.swap(map);
+    format = file_format;
+    track_count = tracks;
+    return true;
+}
+
+Lv2MidiPlayer::Lv2MidiPlayer() {
+}
+
+Lv2MidiPlayer::~Lv2MidiPlayer() {
+}
+
+void Lv2MidiPlayer::set_sequence(Lv2MidiSequence &p_sequence) {
+    std::swap(sequence, p_sequence);
+    cursor = 0;
+    position = 0.0;
+    request_release();
+    playing = false;
+    published_position.store(0.0, std::memory_order_relaxed);
+    published_playing.store(false, std::memory_order_relaxed);
+}
+
+bool Lv2MidiPlayer::has_sequence() const {
+    return !sequence.events.empty();
+}
+
+double Lv2MidiPlayer::get_length() const {
+    return sequence.length;
+}
+
+void Lv2MidiPlayer::play() {
+    if (position >= sequence.length) {
+        position = 0.0;
+        cursor = 0;
+    }
+    playing = true;
+    published_playing.store(true, std::memory_order_relaxed);
+}
+
+void Lv2MidiPlayer::stop() {
+    request_release();
+    playing = false;
+    published_playing.store(false, std::memory_order_relaxed);
+}
+
+void Lv2MidiPlayer::seek(double p_seconds) {
+    position = std::min(std::max(p_seconds, 0.0), sequence.length);
+    cursor = find_cursor(position);
+    request_release();
+    published_position.store(position, std::memory_order_relaxed);
+}
+
+void Lv2MidiPlayer::set_loop(bool p_enabled, double p_start, double p_end) {
+    loop = p_enabled;
+    loop_start = std::max(p_start, 0.0);
+    loop_end = p_end;
+}
+
+bool Lv2MidiPlayer::is_looping() const {
+    return loop;
+}
+
+double Lv2MidiPlayer::get_loop_start() const {
+    return loop_start;
+}
+
+double Lv2MidiPlayer::get_loop_end() const {
+    return loop_end > loop_start ? std::min(loop_end, sequence.length) : sequence.length;
+}
+
+void Lv2MidiPlayer::set_tempo_scale(double p_scale) {
+    tempo_scale = std::min(std::max(p_scale, MIDI_PLAYER_MIN_TEMPO_SCALE), MIDI_PLAYER_MAX_TEMPO_SCALE);
+}
+
+double Lv2MidiPlayer::get_tempo_scale() const {
+    return tempo_scale;
+}
+
+void Lv2MidiPlayer::set_bus(int p_bus) {
+    p_bus = std::max(p_bus, 0);
+    if (p_bus == bus) {
+        return;
+    }
+    // notes still sounding on the old bus get their note off there
+    request_release();
+    bus = p_bus;
+}
+
+int Lv2MidiPlayer::get_bus() const {
+    return bus;
+}
+
+double Lv2MidiPlayer::get_position() const {
+    return published_position.load(std::memory_order_relaxed);
+}
+
+bool Lv2MidiPlayer::is_playing() const {
+    return published_playing.load(std::memory_order_relaxed);
+}
+
+double Lv2MidiPlayer::get_tempo_at(double p_seconds) const {
+    uint32_t usec_per_quarter = 500000;
+    for (const MidiPlayerTempo &tempo : sequence.tempo_map) {
+        if (tempo.seconds > p_seconds) {
+            break;
+        }
+        usec_per_quarter = tempo.usec_per_quarter;
+    }
+    return 60e6 / usec_per_quarter;
+}
+
+bool Lv2MidiPlayer::is_idle() const {
+    return !playing && !pending_release;
+}
+
+uint32_t Lv2MidiPlayer::get_dropped_events() const {
+    return dropped_events.load(std::memory_order_relaxed);
+}
+
+void Lv2MidiPlayer::request_release() {
+    if (!playing && used_channels == 0) {
+        return;
+    }
+    // a release still pending goes to the bus its notes were sent to
+    if (!pending_release) {
+        release_bus = bus;
+    }
+    pending_release = true;
+}
+
+size_t Lv2MidiPlayer::find_cursor(double p_seconds) const {
+    auto it = std::lower_bound(
+        sequence.events.begin(), sequence.events.end(), p_seconds,
+        [](const MidiPlayerEvent &p_event, double p_value) { return p_event.seconds < p_value; });
+    return (size_t)(it - sequence.events.begin());
+}
+
+void Lv2MidiPlayer::emit(Lv2Host *p_host, int p_frame, const MidiPlayerEvent &p_event) {
+    MidiEvent event{};
+    event.frame = p_frame;
+    event.size = p_event.size;
+    std::memcpy(event.data, p_event.data, MidiEvent::DATA_SIZE);
+    const bool queued = p_host->queue_midi_event(bus, event);
+
+    const uint8_t channel = p_event.data[0] & 0x0f;
+    const uint8_t type = p_event.data[0] & 0xf0;
+    uint8_t &count = active_notes[channel * 128 + p_event.data[1]];
+
+    if (!queued) {
+        dropped_events.fetch_add(1, std::memory_order_relaxed);
+        // a lost note off would leave its note hanging: everything sounding is released on the next block instead
+        const bool note_off = type == 0x80 || (type == 0x90 && p_event.data[2] == 0);
+        if (note_off && count > 0) {
+            request_release();
+        }
+        return;
+    }
+
+    used_channels |= (uint16_t)(1u << channel);
+    if (type == 0x90 && p_event.data[2] > 0) {
+        count = count < UINT8_MAX ? count + 1 : count;
+    } else if ((type == 0x80 || type == 0x90) && count > 0) {
+        count--;
+    }
+}
+
+bool Lv2MidiPlayer::release_active(Lv2Host *p_host, int p_frame, int p_bus) {
+    for (int channel = 0; channel < 16; channel++) {
+        if ((used_channels & (1u << channel)) == 0) {
+            continue;
+        }
+        MidiEvent event{};
+        event.frame = p_frame;
+        for (int key = 0; key < 128; key++) {
+            uint8_t &count = active_notes[channel * 128 + key];
+            if (count == 0) {
+                continue;
+            }
+            event.data[0] = (uint8_t)(0x80 | channel);
+            event.data[1] = (uint8_t)key;
+            event.data[2] = 0;
+            if (!p_host->queue_midi_event(p_bus, event)) {
+                return false;
+            }
+            count = 0;
+        }
+        // sustain off, otherwise held notes keep ringing after the jump
+        event.data[0] = (uint8_t)(0xb0 | channel);
+        event.data[1] = 64;
+        event.data[2] = 0;
+        if (!p_host->queue_midi_event(p_bus, event)) {
+            return false;
+        }
+        used_channels &= (uint16_t)~(1u << channel);
+    }
+    return true;
+}
+
+void Lv2MidiPlayer::release_or_defer(Lv2Host *p_host, int p_frame) {
+    if (!release_active(p_host, p_frame, bus)) {
+        release_bus = bus;
+        pending_release = true;
+    }
+}
+
+void Lv2MidiPlayer::process(Lv2Host *p_host, int p_frames, double p_rate) {
+    if (p_frames <= 0 || p_rate <= 0.0) {
+        return;
+    }
+
+    if (pending_release) {
+        // a full queue keeps the player where it is, it carries on once every note off is out
+        if (!release_active(p_host, 0, release_bus)) {
+            return;
+        }
+        pending_release = false;
+    }
+    if (!playing) {
+        return;
+    }
+
+    const std::vector<MidiPlayerEvent> &events = sequence.events;
+    // file seconds per output frame
+    const double speed = tempo_scale / p_rate;
+    const double end_of_loop = get_loop_end();
+    const bool wraps = loop && end_of_loop - loop_start >= MIDI_PLAYER_MIN_LOOP;
+
+    double offset = 0.0;
+    double remaining = p_frames;
+
+    while (remaining > 0.0) {
+        double until = position + remaining * speed;
+        // a seek past the loop end plays on to the end of the sequence
+        const bool wrap = wraps && position < end_of_loop && until >= end_of_loop;
+        if (wrap) {
+            until = end_of_loop;
+        }
+
+        while (cursor < events.size() && events[cursor].seconds < until) {
+            const double at = offset + (events[cursor].seconds - position) / speed;
+            emit(p_host, std::min(std::max((int)at, 0), p_frames - 1), events[cursor]);
+            cursor++;
+        }
+
+        if (!wrap) {
+            position = until;
+            break;
+        }
+
+        const double used = (end_of_loop - position) / speed;
+        offset += used;
+        remaining -= used;
+        release_or_defer(p_host, std::min((int)offset, p_frames - 1));
+        position = loop_start;
+        cursor = find_cursor(loop_start);
+    }
+
+    if (position >= sequence.length && cursor >= events.size()) {
+        position = sequence.length;
+        playing = false;
+        release_or_defer(p_host, p_frames - 1);
+        published_playing.store(false, std::memory_order_relaxed);
+    }
+    published_position.store(position, std::memory_order_relaxed);
+}
@@ -0,0 +1,113 @@
+#ifndef LV2_MIDI_PLAYER_H
+#define LV2_MIDI_PLAYER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lv2_host.h"
+
+namespace godot {
+
+// a channel message with its time in the file, tempo changes already applied
+struct MidiPlayerEvent {
+    double seconds = 0.0;
+    uint8_t data[MidiEvent::DATA_SIZE] = {};
+    uint8_t size = 0;
+};
+
+struct MidiPlayerTempo {
+    uint64_t tick = 0;
+    double seconds = 0.0;
+    uint32_t usec_per_quarter = 500000;
+};
+
+// A Standard MIDI File flattened into one time-sorted list: tracks merged, running status resolved, sysex and
+// meta events dropped (tempo changes end up in tempo_map and in the event times)
+struct Lv2MidiSequence {
+    std::vector<MidiPlayerEvent> events;
+    std::vector<MidiPlayerTempo> tempo_map;
+    double length = 0.0;
+    int format = 0;
+    int track_count = 0;
+
+    // parses format 0 and 1 files (format 2 tracks are played one after the other), false with r_error set
+    // when the data is not a usable SMF
+    bool parse(const uint8_t *p_data, size_t p_size, std::string &r_error);
+};
+
+// Plays a sequence into a host's MIDI queue from the DSP thread. Everything is set up from other threads under
+// the owner's lock, process() only walks the pre-parsed events and never allocates.
+class Lv2MidiPlayer {
+private:
+    Lv2MidiSequence sequence;
+    size_t cursor = 0;
+    double position = 0.0;
+    bool playing = false;
+    bool loop = false;
+    double loop_start = 0.0;
+    double loop_end = 0.0;
+    double tempo_scale = 1.0;
+    int bus = 0;
+    // the notes to release were sent to release_bus, which set_bus() may have moved away from since
+    bool pending_release = false;
+    int release_bus = 0;
+
+    // sounding notes per channel/key and channels that saw a message, so stop/seek/loop can end them
+    uint8_t active_notes[16 * 128] = {};
+    uint16_t used_channels = 0;
+
+    // lock-free copies for the getters
+    std::atomic<double> published_position{0.0};
+    std::atomic<bool> published_playing{false};
+    std::atomic<uint32_t> dropped_events{0};
+
+    size_t find_cursor(double p_seconds) const;
+    void request_release();
+    void emit(Lv2Host *p_host, int p_frame, const MidiPlayerEvent &p_event);
+    // false once the host's queue is full, what is left is released on the next block
+    bool release_active(Lv2Host *p_host, int p_frame, int p_bus);
+    void release_or_defer(Lv2Host *p_host, int p_frame);
+
+public:
+    Lv2MidiPlayer();
+    ~Lv2MidiPlayer();
+
+    // swaps p_sequence in, the previous sequence comes back in it so it can be freed outside the lock
+    void set_sequence(Lv2MidiSequence &p_sequence);
+    bool has_sequence() const;
+    double get_length() const;
+
+    void play();
+    void stop();
+    void seek(double p_seconds);
+    // p_end <= p_start loops the whole sequence
+    void set_loop(bool p_enabled, double p_start, double p_end);
+    bool is_looping() const;
+    double get_loop_start() const;
+    double get_loop_end() const;
+
+    void set_tempo_scale(double p_scale);
+    double get_tempo_scale() const;
+
+    void set_bus(int p_bus);
+    int get_bus() const;
+
+    double get_position() const;
+    bool is_playing() const;
+    // tempo of the file at p_seconds, in quarter notes per minute before the tempo scale
+    double get_tempo_at(double p_seconds) const;
+
+    bool is_idle() const;
+    // events that didn't fit in the host's MIDI queue; note offs are never dropped, they are retried
+    uint32_t get_dropped_events() const;
+
+    // DSP thread: queues the events of the next p_frames frames on p_host at their frame offsets
+    void process(Lv2Host *p_host, int p_frames, double p_rate);
+};
+
+} // namespace godot
+
+#endif
@@ -0,0 +1,266 @@
+#include "lv2_modulation_matrix.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace godot;
+
+static const double MODULATION_TWO_PI = 6.283185307179586;
+
+Lv2ModulationMatrix::Lv2ModulationMatrix() {
+}
+
+Lv2ModulationMatrix::~Lv2ModulationMatrix() {
+}
+
+int Lv2ModulationMatrix::add_lfo(ModulationLfoShape p_shape, double p_rate_hz) {
+    ModulationSource source;
+    source.type = MODULATION_SOURCE_LFO;
+    source.shape = p_shape;
+    source.rate_hz = std::max(p_rate_hz, 0.0);
+    sources.push_back(source);
+    return (int)sources.size() - 1;
+}
+
+int Lv2ModulationMatrix::add_envelope(float p_attack, float p_decay, float p_sustain, float p_release) {
+    ModulationSource source;
+    source.type = MODULATION_SOURCE_ENVELOPE;
+    source.attack = std::max(p_attack, 0.0f);
+    source.decay = std::max(p_decay, 0.0f);
+    source.sustain = std::min(std::max(p_sustain, 0.0f), 1.0f);
+    source.release = std::max(p_release, 0.0f);
+    sources.push_back(source);
+    return (int)sources.size() - 1;
+}
+
+int Lv2ModulationMatrix::add_curve(const std::vector<float> &p_table, double p_duration, bool p_loop) {
+    ModulationSource source;
+    source.type = MODULATION_SOURCE_CURVE;
+    source.table = p_table;
+    source.duration = std::max(p_duration, 0.001);
+    source.loop = p_loop;
+    source.value = p_table.empty() ? 0.0f : p_table[0];
+    sources.push_back(source);
+    return (int)sources.size() - 1;
+}
+
+int Lv2ModulationMatrix::add_follower(const std::shared_ptr<std::atomic<float>> &p_level, float p_attack,
+                                      float p_release) {
+    ModulationSource source;
+    source.type = MODULATION_SOURCE_FOLLOWER;
+    source.level = p_level;
+    source.attack = std::max(p_attack, 0.0f);
+    source.release = std::max(p_release, 0.0f);
+    sources.push_back(source);
+    return (int)sources.size() - 1;
+}
+
+int Lv2ModulationMatrix::add_route(int p_source, const std::string &p_symbol, uint32_t p_control, float p_min,
+                                   float p_max) {
+    if (p_source < 0 || p_source >= (int)sources.size()) {
+        return -1;
+    }
+
+    ModulationRoute route;
+    route.source = p_source;
+    route.symbol = p_symbol;
+    route.control = p_control;
+    route.offset = p_min;
+    route.scale = p_max - p_min;
+    routes.push_back(route);
+    return (int)routes.size() - 1;
+}
+
+void Lv2ModulationMatrix::set_gate(int p_source, bool p_gate) {
+    if (p_source < 0 || p_source >= (int)sources.size()) {
+        return;
+    }
+
+    ModulationSource &source = sources[p_source];
+
+    switch (source.type) {
+    case MODULATION_SOURCE_ENVELOPE:
+        if (p_gate) {
+            source.stage = MODULATION_ENVELOPE_ATTACK;
+        } else if (source.stage != MODULATION_ENVELOPE_IDLE) {
+            source.stage = MODULATION_ENVELOPE_RELEASE;
+        }
+        break;
+    case MODULATION_SOURCE_CURVE:
+        source.running = p_gate;
+        if (p_gate) {
+            source.position = 0.0;
+        }
+        break;
+    case MODULATION_SOURCE_LFO:
+        if (p_gate) {
+            source.phase = 0.0;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void Lv2ModulationMatrix::clear() {
+    sources.clear();
+    routes.clear();
+}
+
+void Lv2ModulationMatrix::set_step_frames(int p_frames) {
+    step_frames = std::max(p_frames, 0);
+}
+
+int Lv2ModulationMatrix::get_step_frames() const {
+    return step_frames;
+}
+
+bool Lv2ModulationMatrix::is_empty() const {
+    return routes.empty();
+}
+
+int Lv2ModulationMatrix::get_max_events(int p_frames) const {
+    const int steps = step_frames > 0 ? (p_frames + step_frames - 1) / step_frames : 1;
+    return steps * (int)routes.size();
+}
+
+void Lv2ModulationMatrix::resolve(Lv2Host *p_host) {
+    const int count = p_host->get_input_control_count();
+
+    for (ModulationRoute &route : routes) {
+        route.control = MODULATION_UNRESOLVED;
+        for (int i = 0; i < count; i++) {
+            const LilvControl *control = p_host->get_input_control(i);
+            if (control != nullptr && control->symbol == route.symbol) {
+                route.control = (uint32_t)i;
+                break;
+            }
+        }
+    }
+}
+
+void Lv2ModulationMatrix::advance(ModulationSource &p_source, int p_frames, double p_rate) {
+    const double seconds = p_frames / p_rate;
+
+    switch (p_source.type) {
+    case MODULATION_SOURCE_LFO: {
+        const double phase = p_source.phase;
+        switch (p_source.shape) {
+        case MODULATION_LFO_SINE:
+            p_source.value = (float)(0.5 + 0.5 * std::sin(MODULATION_TWO_PI * phase));
+            break;
+        case MODULATION_LFO_TRIANGLE:
+            p_source.value = (float)(1.0 - std::fabs(2.0 * phase - 1.0));
+            break;
+        case MODULATION_LFO_SAW:
+            p_source.value = (float)phase;
+            break;
+        case MODULATION_LFO_SQUARE:
+            p_source.value = phase < 0.5 ? 1.0f : 0.0f;
+            break;
+        }
+        p_source.phase += p_source.rate_hz * seconds;
+        p_source.phase -= std::floor(p_source.phase);
+        break;
+    }
+    case MODULATION_SOURCE_ENVELOPE: {
+        float value = p_source.value;
+        switch (p_source.stage) {
+        case MODULATION_ENVELOPE_IDLE:
+            value = 0.0f;
+            break;
+        case MODULATION_ENVELOPE_ATTACK:
+            value = p_source.attack > 0.0f ? value + (float)(seconds / p_source.attack) : 1.0f;
+            if (value >= 1.0f) {
+                value = 1.0f;
+                p_source.stage = MODULATION_ENVELOPE_DECAY;
+            }
+            break;
+        case MODULATION_ENVELOPE_DECAY:
+            value = p_source.decay > 0.0f ? value - (float)((1.0 - p_source.sustain) * seconds / p_source.decay)
+                                          : p_source.sustain;
+            if (value <= p_source.sustain) {
+                value = p_source.sustain;
+                p_source.stage = MODULATION_ENVELOPE_SUSTAIN;
+            }
+            break;
+        case MODULATION_ENVELOPE_SUSTAIN:
+            value = p_source.sustain;
+            break;
+        case MODULATION_ENVELOPE_RELEASE:
+            value = p_source.release > 0.0f ? value - (float)(seconds / p_source.release) : 0.0f;
+            if (value <= 0.0f) {
+                value = 0.0f;
+                p_source.stage = MODULATION_ENVELOPE_IDLE;
+            }
+            break;
+        }
+        p_source.value = value;
+        break;
+    }
+    case MODULATION_SOURCE_CURVE: {
+        const std::vector<float> &table = p_source.table;
+        if (table.empty()) {
+            p_source.value = 0.0f;
+            break;
+        }
+
+        const double position = std::min(p_source.position / p_source.duration, 1.0) * (table.size() - 1);
+        const size_t index = (size_t)position;
+        const size_t next = std::min(index + 1, table.size() - 1);
+        const float fraction = (float)(position - index);
+        p_source.value = table[index] + (table[next] - table[index]) * fraction;
+
+        if (p_source.running) {
+            p_source.position += seconds;
+            if (p_source.position >= p_source.duration) {
+                if (p_source.loop) {
+                    p_source.position = std::fmod(p_source.position, p_source.duration);
+                } else {
+                    p_source.position = p_source.duration;
+                    p_source.running = false;
+                }
+            }
+        }
+        break;
+    }
+    case MODULATION_SOURCE_FOLLOWER: {
+        if (!p_source.level) {
+            break;
+        }
+        const float target = std::min(p_source.level->load(std::memory_order_relaxed), 1.0f);
+        const float time = target > p_source.value ? p_source.attack : p_source.release;
+        const float coeff = time > 0.0f ? (float)std::exp(-seconds / time) : 0.0f;
+        p_source.value = target + coeff * (p_source.value - target);
+        break;
+    }
+    }
+}
+
+void Lv2ModulationMatrix::process(Lv2Host *p_host, int p_frames, double p_rate) {
+    if (routes.empty() || p_frames <= 0 || p_rate <= 0.0) {
+        return;
+    }
+
+    const int step = step_frames > 0 ? std::min(step_frames, p_frames) : p_frames;
+
+    for (int offset = 0; offset < p_frames; offset += step) {
+        const int frames = std::min(step, p_frames - offset);
+
+        for (ModulationSource &source : sources) {
+            advance(source, frames, p_rate);
+        }
+
+        for (const ModulationRoute &route : routes) {
+            if (route.control == MODULATION_UNRESOLVED) {
+                continue;
+            }
+
+            ControlEvent event;
+            event.frame = offset;
+            event.index = route.control;
+            event.value = route.offset + route.scale * sources[route.source].value;
+            p_host->queue_control_event(event);
+        }
+    }
+}
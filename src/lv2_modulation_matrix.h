@@ -0,0 +1,115 @@
+#ifndef LV2_MODULATION_MATRIX_H
+#define LV2_MODULATION_MATRIX_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lv2_host.h"
+
+namespace godot {
+
+const uint32_t MODULATION_UNRESOLVED = UINT32_MAX;
+
+enum ModulationSourceType {
+    MODULATION_SOURCE_LFO,
+    MODULATION_SOURCE_ENVELOPE,
+    MODULATION_SOURCE_CURVE,
+    MODULATION_SOURCE_FOLLOWER,
+};
+
+enum ModulationLfoShape {
+    MODULATION_LFO_SINE,
+    MODULATION_LFO_TRIANGLE,
+    MODULATION_LFO_SAW,
+    MODULATION_LFO_SQUARE,
+};
+
+enum ModulationEnvelopeStage {
+    MODULATION_ENVELOPE_IDLE,
+    MODULATION_ENVELOPE_ATTACK,
+    MODULATION_ENVELOPE_DECAY,
+    MODULATION_ENVELOPE_SUSTAIN,
+    MODULATION_ENVELOPE_RELEASE,
+};
+
+// every source produces a normalized value in [0, 1]
+struct ModulationSource {
+    ModulationSourceType type = MODULATION_SOURCE_LFO;
+    float value = 0.0f;
+
+    // lfo
+    ModulationLfoShape shape = MODULATION_LFO_SINE;
+    double rate_hz = 1.0;
+    double phase = 0.0;
+
+    // envelope (seconds, sustain level)
+    float attack = 0.01f;
+    float decay = 0.1f;
+    float sustain = 1.0f;
+    float release = 0.1f;
+    ModulationEnvelopeStage stage = MODULATION_ENVELOPE_IDLE;
+
+    // curve (baked from a Curve resource, played over duration seconds)
+    std::vector<float> table;
+    double duration = 1.0;
+    double position = 0.0;
+    bool loop = false;
+    bool running = false;
+
+    // follower (linear peak of another instance, one-pole smoothed with attack/release above)
+    std::shared_ptr<std::atomic<float>> level;
+};
+
+// value = offset + scale * source, precomputed from the target range
+struct ModulationRoute {
+    int source = 0;
+    // the target is kept by symbol so the route survives a plugin reload, control is its index in the current
+    // plugin
+    std::string symbol;
+    uint32_t control = MODULATION_UNRESOLVED;
+    float offset = 0.0f;
+    float scale = 1.0f;
+};
+
+class Lv2ModulationMatrix {
+private:
+    std::vector<ModulationSource> sources;
+    std::vector<ModulationRoute> routes;
+    int step_frames{};
+
+    void advance(ModulationSource &p_source, int p_frames, double p_rate);
+
+public:
+    Lv2ModulationMatrix();
+    ~Lv2ModulationMatrix();
+
+    int add_lfo(ModulationLfoShape p_shape, double p_rate_hz);
+    int add_envelope(float p_attack, float p_decay, float p_sustain, float p_release);
+    int add_curve(const std::vector<float> &p_table, double p_duration, bool p_loop);
+    int add_follower(const std::shared_ptr<std::atomic<float>> &p_level, float p_attack, float p_release);
+    int add_route(int p_source, const std::string &p_symbol, uint32_t p_control, float p_min, float p_max);
+
+    void set_gate(int p_source, bool p_gate);
+    void clear();
+
+    // 0 evaluates once per block, otherwise every p_frames frames (sub-block rate)
+    void set_step_frames(int p_frames);
+    int get_step_frames() const;
+
+    bool is_empty() const;
+    // the most control changes process() queues for a block of p_frames
+    int get_max_events(int p_frames) const;
+
+    // looks the route targets up in a freshly loaded plugin, unknown ones stay unresolved
+    void resolve(Lv2Host *p_host);
+
+    // DSP thread: advances sources and queues control changes on the host, never allocates
+    void process(Lv2Host *p_host, int p_frames, double p_rate);
+};
+
+} // namespace godot
+
+#endif
@@ -0,0 +1,207 @@
+#include "lv2_realtime.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace godot {
+
+namespace {
+
+// nice level asked for when no realtime policy is allowed
+const int REALTIME_FALLBACK_NICE = -10;
+
+#ifdef __linux__
+
+int to_sched_policy(Lv2RealtimePolicy p_policy) {
+    return p_policy == LV2_REALTIME_POLICY_RR ? SCHED_RR : SCHED_FIFO;
+}
+
+// raises the soft limit up to the hard limit and returns the new soft limit
+rlim_t raise_soft_limit(int p_resource, rlim_t p_wanted) {
+    struct rlimit limit;
+    if (getrlimit(p_resource, &limit) != 0) {
+        return 0;
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && (p_wanted == RLIM_INFINITY || limit.rlim_cur < p_wanted)) {
+        rlim_t raised = limit.rlim_max;
+        if (raised == RLIM_INFINITY || (p_wanted != RLIM_INFINITY && raised > p_wanted)) {
+            raised = p_wanted;
+        }
+        if (raised > limit.rlim_cur) {
+            limit.rlim_cur = raised;
+            if (setrlimit(p_resource, &limit) != 0) {
+                getrlimit(p_resource, &limit);
+            }
+        }
+    }
+    return limit.rlim_cur;
+}
+
+// SCHED_RESET_ON_FORK keeps child processes (the out-of-process host, shell commands) off the realtime policy
+int set_scheduler(int p_policy, int p_priority) {
+    struct sched_param param = {};
+    param.sched_priority = p_priority;
+    if (sched_setscheduler(0, p_policy | SCHED_RESET_ON_FORK, &param) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+void read_scheduler(Lv2RealtimeStatus &r_status) {
+    int policy = sched_getscheduler(0) & ~SCHED_RESET_ON_FORK;
+    struct sched_param param = {};
+    sched_getparam(0, &param);
+
+    r_status.policy = policy == SCHED_FIFO ? LV2_REALTIME_POLICY_FIFO
+                      : policy == SCHED_RR ? LV2_REALTIME_POLICY_RR
+                                           : LV2_REALTIME_POLICY_NONE;
+    r_status.priority = param.sched_priority;
+
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+    r_status.nice = errno == 0 ? nice : 0;
+}
+
+int apply_policy(Lv2RealtimeStatus &r_status) {
+    int policy = to_sched_policy(r_status.requested_policy);
+    int priority = r_status.requested_priority;
+    priority = priority < sched_get_priority_min(policy) ? sched_get_priority_min(policy) : priority;
+    priority = priority > sched_get_priority_max(policy) ? sched_get_priority_max(policy) : priority;
+
+    int error = set_scheduler(policy, priority);
+    if (error == 0) {
+        r_status.fallback = LV2_REALTIME_FALLBACK_NONE;
+        return 0;
+    }
+    if (error != EPERM) {
+        r_status.fallback = LV2_REALTIME_FALLBACK_FAILED;
+        return error;
+    }
+
+    // unprivileged: the kernel allows realtime priorities up to RLIMIT_RTPRIO
+    rlim_t rtprio = raise_soft_limit(RLIMIT_RTPRIO, (rlim_t)priority);
+    if (rtprio > 0) {
+        int clamped = rtprio == RLIM_INFINITY || rtprio > (rlim_t)priority ? priority : (int)rtprio;
+        if (set_scheduler(policy, clamped) == 0) {
+            r_status.fallback =
+                clamped == priority ? LV2_REALTIME_FALLBACK_NONE : LV2_REALTIME_FALLBACK_RTPRIO_LIMIT;
+            return clamped == priority ? 0 : EPERM;
+        }
+    }
+
+    // no realtime at all, take what RLIMIT_NICE allows (nice = 20 - limit)
+    rlim_t nice_limit = raise_soft_limit(RLIMIT_NICE, (rlim_t)(20 - REALTIME_FALLBACK_NICE));
+    int nice = nice_limit == RLIM_INFINITY ? REALTIME_FALLBACK_NICE : 20 - (int)nice_limit;
+    nice = nice < REALTIME_FALLBACK_NICE ? REALTIME_FALLBACK_NICE : nice;
+    if (nice < 0 && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) == 0) {
+        r_status.fallback = LV2_REALTIME_FALLBACK_NICE;
+    } else {
+        r_status.fallback = LV2_REALTIME_FALLBACK_FAILED;
+    }
+    return EPERM;
+}
+
+int apply_affinity(const std::vector<int> &p_cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    int count = 0;
+    for (int cpu : p_cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+            count++;
+        }
+    }
+    if (count == 0) {
+        return EINVAL;
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+#endif
+
+} // namespace
+
+Lv2RealtimeStatus lv2_realtime_apply(Lv2RealtimePolicy p_policy, int p_priority, const std::vector<int> &p_cpus) {
+    Lv2RealtimeStatus status;
+    status.requested_policy = p_policy;
+    status.requested_priority = p_priority;
+
+#ifdef __linux__
+    int error = 0;
+    if (p_policy != LV2_REALTIME_POLICY_NONE) {
+        error = apply_policy(status);
+    }
+    status.policy_applied = error == 0;
+
+    if (!p_cpus.empty()) {
+        int affinity_error = apply_affinity(p_cpus);
+        status.affinity_applied = affinity_error == 0;
+        error = error != 0 ? error : affinity_error;
+    }
+
+    status.error = error;
+    read_scheduler(status);
+#else
+    status.policy_applied = p_policy == LV2_REALTIME_POLICY_NONE;
+    status.affinity_applied = false;
+    if (p_policy != LV2_REALTIME_POLICY_NONE || !p_cpus.empty()) {
+        status.fallback = LV2_REALTIME_FALLBACK_FAILED;
+        status.error = ENOSYS;
+    }
+#endif
+
+    return status;
+}
+
+bool lv2_realtime_set_priority(Lv2RealtimePolicy p_policy, int p_priority) {
+#ifdef __linux__
+    if (p_policy == LV2_REALTIME_POLICY_NONE) {
+        return false;
+    }
+    return set_scheduler(to_sched_policy(p_policy), p_priority) == 0;
+#else
+    (void)p_policy;
+    (void)p_priority;
+    return false;
+#endif
+}
+
+std::vector<int> lv2_realtime_parse_cpus(const char *p_list) {
+    std::vector<int> cpus;
+    const char *cursor = p_list;
+
+    while (cursor && *cursor) {
+        char *end;
+        long first = std::strtol(cursor, &end, 10);
+        if (end == cursor) {
+            cursor++;
+            continue;
+        }
+        long last = first;
+        cursor = end;
+        if (*cursor == '-') {
+            last = std::strtol(cursor + 1, &end, 10);
+            if (end == cursor + 1) {
+                last = first;
+            }
+            cursor = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < 1024; cpu++) {
+            if (cpu >= 0) {
+                cpus.push_back((int)cpu);
+            }
+        }
+    }
+
+    return cpus;
+}
+
+} // namespace godot
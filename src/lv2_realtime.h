@@ -0,0 +1,56 @@
+#ifndef LV2_REALTIME_H
+#define LV2_REALTIME_H
+
+#include <vector>
+
+namespace godot {
+
+enum Lv2RealtimePolicy {
+    LV2_REALTIME_POLICY_NONE,
+    LV2_REALTIME_POLICY_FIFO,
+    LV2_REALTIME_POLICY_RR,
+};
+
+// how the calling thread ended up being scheduled
+enum Lv2RealtimeFallback {
+    // the requested policy and priority are in effect
+    LV2_REALTIME_FALLBACK_NONE,
+    // the requested policy is in effect at a lower priority, clamped to RLIMIT_RTPRIO
+    LV2_REALTIME_FALLBACK_RTPRIO_LIMIT,
+    // no realtime policy allowed, the thread stays SCHED_OTHER with a raised nice level
+    LV2_REALTIME_FALLBACK_NICE,
+    // nothing could be changed, the thread keeps the default scheduling
+    LV2_REALTIME_FALLBACK_FAILED,
+};
+
+struct Lv2RealtimeStatus {
+    Lv2RealtimePolicy requested_policy = LV2_REALTIME_POLICY_NONE;
+    int requested_priority = 0;
+    // LV2_REALTIME_POLICY_NONE when the thread is SCHED_OTHER
+    Lv2RealtimePolicy policy = LV2_REALTIME_POLICY_NONE;
+    int priority = 0;
+    int nice = 0;
+    Lv2RealtimeFallback fallback = LV2_REALTIME_FALLBACK_NONE;
+    bool policy_applied = false;
+    bool affinity_applied = false;
+    // errno of the first refused request, 0 when everything was granted
+    int error = 0;
+};
+
+// Applies a scheduling policy and cpu affinity to the calling thread. Without CAP_SYS_NICE the kernel refuses
+// SCHED_FIFO/SCHED_RR above RLIMIT_RTPRIO (0 by default on most distributions), so the request degrades the way
+// rtkit would: raise the soft RLIMIT_RTPRIO up to the hard limit and clamp the priority to it, then fall back to
+// a negative nice level within RLIMIT_NICE. An empty cpu list leaves the affinity untouched. Only Linux is
+// supported, elsewhere the status reports LV2_REALTIME_FALLBACK_FAILED with ENOSYS.
+Lv2RealtimeStatus lv2_realtime_apply(Lv2RealtimePolicy p_policy, int p_priority, const std::vector<int> &p_cpus);
+
+// Changes only the priority of a calling thread that already runs p_policy (used for short-lived boosts),
+// false when the kernel refuses it.
+bool lv2_realtime_set_priority(Lv2RealtimePolicy p_policy, int p_priority);
+
+// Parses a cpu list such as "2,3" or "0-3,6" into cpu indices, invalid entries are skipped.
+std::vector<int> lv2_realtime_parse_cpus(const char *p_list);
+
+} // namespace godot
+
+#endif
@@ -0,0 +1,855 @@
+#include "lv2_remote.h"
+
+#include "lv2_host.h"
+#include "lv2_realtime.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <climits>
+#include <csignal>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace godot {
+
+namespace {
+
+// the header is padded so the arena starts on a page boundary for any page size up to 64 KiB
+const size_t REMOTE_HEADER_ALIGN = 64 * 1024;
+// allocate_frames() hands out cache line aligned spans
+const size_t REMOTE_FRAME_ALIGN = 16;
+const uint64_t REMOTE_START_TIMEOUT_USEC = 10000000;
+const uint64_t REMOTE_COMMAND_TIMEOUT_USEC = 5000000;
+const uint64_t REMOTE_QUIT_TIMEOUT_USEC = 200000;
+const uint64_t REMOTE_WAIT_SLICE_USEC = 1000;
+const int REMOTE_SUPERVISE_MS = 50;
+const int REMOTE_RESTART_BACKOFF_MS = 2000;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "futex words must be plain 32 bit integers");
+
+size_t remote_header_bytes() {
+    return (sizeof(Lv2RemoteShared) + REMOTE_HEADER_ALIGN - 1) & ~(REMOTE_HEADER_ALIGN - 1);
+}
+
+size_t remote_segment_bytes() {
+    return remote_header_bytes() + REMOTE_ARENA_FLOATS * sizeof(float) + REMOTE_BLOB_BYTES;
+}
+
+uint64_t now_usec() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void copy_string(char *r_dest, size_t p_size, const std::string &p_source) {
+    size_t length = std::min(p_source.size(), p_size - 1);
+    std::memcpy(r_dest, p_source.data(), length);
+    r_dest[length] = '\0';
+}
+
+#ifdef __linux__
+
+// waits while *p_word == p_expected, at most p_timeout_usec
+void futex_wait(std::atomic<uint32_t> *p_word, uint32_t p_expected, uint64_t p_timeout_usec) {
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(p_timeout_usec / 1000000);
+    timeout.tv_nsec = (long)(p_timeout_usec % 1000000) * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(p_word), FUTEX_WAIT, p_expected, &timeout, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t> *p_word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(p_word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// waits until *p_word == p_wanted, false on timeout or when p_abort becomes true
+bool futex_wait_for(std::atomic<uint32_t> *p_word, uint32_t p_wanted, uint64_t p_timeout_usec,
+                    const std::atomic<bool> *p_abort) {
+    const uint64_t start = now_usec();
+    while (true) {
+        uint32_t value = p_word->load(std::memory_order_acquire);
+        if (value == p_wanted) {
+            return true;
+        }
+        if (p_abort && p_abort->load(std::memory_order_acquire)) {
+            return false;
+        }
+        uint64_t elapsed = now_usec() - start;
+        if (elapsed >= p_timeout_usec) {
+            return false;
+        }
+        futex_wait(p_word, value, std::min(REMOTE_WAIT_SLICE_USEC, p_timeout_usec - elapsed));
+    }
+}
+
+void ring_doorbell(Lv2RemoteShared *p_shared) {
+    p_shared->doorbell.fetch_add(1, std::memory_order_release);
+    futex_wake(&p_shared->doorbell);
+}
+
+#endif
+
+} // namespace
+
+// ===== Lv2RemoteLink =====
+Lv2RemoteLink::Lv2RemoteLink(const std::string &p_executable) :
+        executable(p_executable),
+        fd(-1),
+        segment(nullptr),
+        segment_bytes(0),
+        shared(nullptr),
+        arena(nullptr),
+        blob(nullptr),
+        arena_used(0),
+        pid(0),
+        ready(false),
+        in_block(false),
+        failed(false),
+        restarts(0),
+        active(false),
+        timeout_usec(100000),
+        snapshot_interval_ms(1000),
+        realtime_policy(LV2_REALTIME_POLICY_NONE),
+        realtime_priority(0),
+        round_trips(0),
+        mean_round_trip_usec(0.0),
+        max_round_trip_usec(0.0),
+        snapshot_bytes(0),
+        quit(false),
+        failures(0),
+        last_exit_status(0) {
+}
+
+Lv2RemoteLink::~Lv2RemoteLink() {
+    stop();
+#ifdef __linux__
+    if (segment) {
+        munmap(segment, segment_bytes);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+bool Lv2RemoteLink::create_segment() {
+#ifdef __linux__
+    if (segment) {
+        return true;
+    }
+
+    fd = memfd_create("lv2-host", MFD_CLOEXEC);
+    if (fd < 0) {
+        set_error("memfd_create failed");
+        return false;
+    }
+
+    segment_bytes = remote_segment_bytes();
+    if (ftruncate(fd, (off_t)segment_bytes) != 0) {
+        set_error("could not size the shared segment");
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        set_error("could not map the shared segment");
+        return false;
+    }
+
+    // a fresh memfd reads as zeros, which is a valid initial value for every atomic in the header
+    segment = static_cast<uint8_t *>(mapped);
+    shared = reinterpret_cast<Lv2RemoteShared *>(segment);
+    arena = reinterpret_cast<float *>(segment + remote_header_bytes());
+    blob = segment + remote_header_bytes() + REMOTE_ARENA_FLOATS * sizeof(float);
+    shared->magic = REMOTE_MAGIC;
+    shared->version = REMOTE_VERSION;
+    return true;
+#else
+    set_error("out-of-process hosting is only supported on Linux");
+    return false;
+#endif
+}
+
+bool Lv2RemoteLink::spawn() {
+#ifdef __linux__
+    // anything the previous child left half done is dropped
+    shared->started.store(0, std::memory_order_relaxed);
+    shared->block_done.store(shared->block_posted.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    shared->command_done.store(shared->command_posted.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    shared->realtime_policy = realtime_policy;
+    shared->realtime_priority = realtime_priority;
+
+    // everything the child needs is prepared before fork, only async-signal-safe calls after it
+    char fd_arg[16];
+    std::snprintf(fd_arg, sizeof(fd_arg), "%d", REMOTE_CHILD_FD);
+    const char *argv[] = {executable.c_str(), "--serve", fd_arg, nullptr};
+    const pid_t parent = getpid();
+
+    pid_t child = fork();
+    if (child < 0) {
+        set_error("fork failed");
+        return false;
+    }
+    if (child == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != parent) {
+            _exit(126);
+        }
+        if (fd == REMOTE_CHILD_FD) {
+            fcntl(fd, F_SETFD, 0);
+        } else if (dup2(fd, REMOTE_CHILD_FD) < 0) {
+            _exit(126);
+        }
+        execv(argv[0], const_cast<char *const *>(argv));
+        _exit(127);
+    }
+
+    pid.store(child, std::memory_order_release);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Lv2RemoteLink::wait_started() {
+#ifdef __linux__
+    const uint64_t start = now_usec();
+    while (now_usec() - start < REMOTE_START_TIMEOUT_USEC) {
+        uint32_t started = shared->started.load(std::memory_order_acquire);
+        if (started == 1) {
+            return true;
+        }
+        if (started == 2) {
+            set_error("the host process could not instantiate the plugin");
+            return false;
+        }
+        int status;
+        if (waitpid(pid.load(), &status, WNOHANG) == pid.load()) {
+            pid.store(0, std::memory_order_release);
+            last_exit_status.store(status);
+            set_error("the host process exited during startup");
+            return false;
+        }
+        futex_wait(&shared->started, started, 10 * REMOTE_WAIT_SLICE_USEC);
+    }
+    set_error("the host process did not start in time");
+#endif
+    return false;
+}
+
+void Lv2RemoteLink::kill_child() {
+#ifdef __linux__
+    int child = pid.load(std::memory_order_acquire);
+    if (child > 0) {
+        kill(child, SIGKILL);
+    }
+#endif
+}
+
+void Lv2RemoteLink::reap(bool p_block) {
+#ifdef __linux__
+    int child = pid.load(std::memory_order_acquire);
+    if (child <= 0) {
+        return;
+    }
+
+    int status = 0;
+    if (waitpid(child, &status, p_block ? 0 : WNOHANG) != child) {
+        return;
+    }
+
+    pid.store(0, std::memory_order_release);
+    // a child killed after a timeout was already counted and keeps the -1 run_block()/post_command() put there
+    if (failed.load(std::memory_order_acquire)) {
+        return;
+    }
+    last_exit_status.store(status);
+    if (!quit.load(std::memory_order_acquire)) {
+        ready.store(false, std::memory_order_release);
+        failed.store(true, std::memory_order_release);
+        failures.fetch_add(1);
+    }
+#endif
+}
+
+void Lv2RemoteLink::supervise() {
+    uint64_t last_snapshot = now_usec();
+    int backoff_ms = 0;
+
+    std::unique_lock<std::mutex> lock(supervisor_mutex);
+    while (!quit.load()) {
+        supervisor_wake.wait_for(lock, std::chrono::milliseconds(std::max(REMOTE_SUPERVISE_MS, backoff_ms)));
+        if (quit.load()) {
+            break;
+        }
+        lock.unlock();
+
+        reap(false);
+        if (failed.load(std::memory_order_acquire)) {
+            // the instance thread may still be waiting on the dead child, the mailbox is reset under it otherwise
+            while (in_block.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (restart()) {
+                backoff_ms = 0;
+                last_snapshot = now_usec();
+            } else {
+                backoff_ms = std::min(std::max(backoff_ms * 2, REMOTE_SUPERVISE_MS), REMOTE_RESTART_BACKOFF_MS);
+            }
+        } else if (ready.load(std::memory_order_acquire) && snapshot_interval_ms.load() > 0 &&
+                   now_usec() - last_snapshot >= (uint64_t)snapshot_interval_ms.load() * 1000) {
+            std::vector<uint8_t> state;
+            if (command(LV2_REMOTE_COMMAND_SAVE_STATE, nullptr, &state)) {
+                snapshot.swap(state);
+                snapshot_bytes.store(snapshot.size());
+            }
+            last_snapshot = now_usec();
+        }
+
+        lock.lock();
+    }
+}
+
+bool Lv2RemoteLink::restart() {
+#ifdef __linux__
+    kill_child();
+    reap(true);
+
+    if (!spawn()) {
+        return false;
+    }
+    if (!wait_started()) {
+        kill_child();
+        reap(true);
+        return false;
+    }
+
+    failed.store(false, std::memory_order_release);
+    if (!snapshot.empty()) {
+        command(LV2_REMOTE_COMMAND_RESTORE_STATE, &snapshot, nullptr);
+    }
+    if (active) {
+        command(LV2_REMOTE_COMMAND_ACTIVATE, nullptr, nullptr);
+    }
+    if (failed.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    restarts.fetch_add(1);
+    ready.store(true, std::memory_order_release);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Lv2RemoteLink::post_command(uint32_t p_command, uint64_t p_timeout_usec) {
+#ifdef __linux__
+    if (pid.load(std::memory_order_acquire) <= 0) {
+        return false;
+    }
+
+    shared->command = p_command;
+    shared->command_result = -1;
+    uint32_t sequence = shared->command_posted.load(std::memory_order_relaxed) + 1;
+    shared->command_posted.store(sequence, std::memory_order_release);
+    ring_doorbell(shared);
+
+    if (!futex_wait_for(&shared->command_done, sequence, p_timeout_usec, &failed)) {
+        if (!failed.load(std::memory_order_acquire) && !quit.load()) {
+            // hung, the supervisor restarts it
+            ready.store(false, std::memory_order_release);
+            last_exit_status.store(-1);
+            failed.store(true, std::memory_order_release);
+            failures.fetch_add(1);
+            kill_child();
+        }
+        return false;
+    }
+    return shared->command_result == 0;
+#else
+    (void)p_command;
+    (void)p_timeout_usec;
+    return false;
+#endif
+}
+
+void Lv2RemoteLink::set_error(const std::string &p_error) {
+    std::lock_guard<std::mutex> guard(supervisor_mutex);
+    error = p_error;
+}
+
+bool Lv2RemoteLink::start(const std::string &p_uri, double p_sample_rate, uint32_t p_block_frames,
+                          uint32_t p_seq_bytes, uint32_t p_min_sub_block, const std::string &p_state_dir,
+                          const std::string &p_lv2_path) {
+    stop();
+    if (!create_segment()) {
+        return false;
+    }
+
+    shared->sample_rate = p_sample_rate;
+    shared->block_frames = std::min(p_block_frames, REMOTE_MAX_BLOCK);
+    shared->seq_bytes = p_seq_bytes;
+    shared->min_sub_block = p_min_sub_block;
+    copy_string(shared->uri, sizeof(shared->uri), p_uri);
+    copy_string(shared->state_dir, sizeof(shared->state_dir), p_state_dir);
+    copy_string(shared->lv2_path, sizeof(shared->lv2_path), p_lv2_path);
+
+    quit.store(false);
+    failed.store(false);
+    active = false;
+    snapshot.clear();
+    snapshot_bytes.store(0);
+
+    if (!spawn()) {
+        return false;
+    }
+    if (!wait_started()) {
+        quit.store(true);
+        kill_child();
+        reap(true);
+        return false;
+    }
+
+    ready.store(true, std::memory_order_release);
+    supervisor = std::thread(&Lv2RemoteLink::supervise, this);
+    return true;
+}
+
+void Lv2RemoteLink::set_realtime(uint32_t p_policy, int p_priority) {
+    realtime_policy = p_policy;
+    realtime_priority = p_priority;
+}
+
+void Lv2RemoteLink::stop() {
+    {
+        std::lock_guard<std::mutex> guard(supervisor_mutex);
+        quit.store(true);
+    }
+    supervisor_wake.notify_all();
+    if (supervisor.joinable()) {
+        supervisor.join();
+    }
+
+    ready.store(false, std::memory_order_release);
+    if (pid.load() > 0) {
+        {
+            std::lock_guard<std::mutex> guard(command_mutex);
+            post_command(LV2_REMOTE_COMMAND_QUIT, REMOTE_QUIT_TIMEOUT_USEC);
+        }
+        kill_child();
+        reap(true);
+    }
+}
+
+bool Lv2RemoteLink::is_ready() const {
+    return ready.load(std::memory_order_acquire);
+}
+
+Lv2RemoteShared *Lv2RemoteLink::get_shared() const {
+    return shared;
+}
+
+float *Lv2RemoteLink::allocate_frames(size_t p_count) {
+    if (!arena) {
+        return nullptr;
+    }
+    size_t count = (p_count + REMOTE_FRAME_ALIGN - 1) & ~(REMOTE_FRAME_ALIGN - 1);
+    if (arena_used + count > REMOTE_ARENA_FLOATS - REMOTE_SCRATCH_FLOATS) {
+        return nullptr;
+    }
+    float *frames = arena + arena_used;
+    arena_used += count;
+    return frames;
+}
+
+void Lv2RemoteLink::reset_arena() {
+    arena_used = 0;
+}
+
+bool Lv2RemoteLink::arena_offset(const float *p_data, size_t p_count, uint64_t &r_offset) const {
+    if (!arena || !p_data) {
+        return false;
+    }
+    uintptr_t begin = reinterpret_cast<uintptr_t>(arena);
+    uintptr_t data = reinterpret_cast<uintptr_t>(p_data);
+    if (data < begin || data + p_count * sizeof(float) > begin + REMOTE_ARENA_FLOATS * sizeof(float)) {
+        return false;
+    }
+    r_offset = (data - begin) / sizeof(float);
+    return true;
+}
+
+float *Lv2RemoteLink::get_arena() const {
+    return arena;
+}
+
+float *Lv2RemoteLink::get_scratch(uint32_t p_slot) const {
+    if (!arena || p_slot >= REMOTE_MAX_CHANNELS * 2) {
+        return nullptr;
+    }
+    return arena + (REMOTE_ARENA_FLOATS - REMOTE_SCRATCH_FLOATS) + (size_t)p_slot * REMOTE_MAX_BLOCK;
+}
+
+bool Lv2RemoteLink::run_block() {
+#ifdef __linux__
+    if (!ready.load(std::memory_order_acquire)) {
+        return false;
+    }
+    in_block.store(true, std::memory_order_seq_cst);
+    // the supervisor may have started resetting the mailbox between the two loads
+    if (!ready.load(std::memory_order_seq_cst)) {
+        in_block.store(false, std::memory_order_release);
+        return false;
+    }
+
+    const uint64_t start = now_usec();
+    uint32_t sequence = shared->block_posted.load(std::memory_order_relaxed) + 1;
+    shared->block_posted.store(sequence, std::memory_order_release);
+    ring_doorbell(shared);
+
+    bool done = futex_wait_for(&shared->block_done, sequence, timeout_usec.load(), &failed);
+    if (!done && !failed.load(std::memory_order_acquire)) {
+        // stuck in run(): kill it here, the supervisor reaps and restarts it
+        ready.store(false, std::memory_order_release);
+        last_exit_status.store(-1);
+        failed.store(true, std::memory_order_release);
+        failures.fetch_add(1);
+        kill_child();
+        supervisor_wake.notify_one();
+    }
+
+    if (done) {
+        double round_trip = (double)(now_usec() - start);
+        round_trips++;
+        mean_round_trip_usec += (round_trip - mean_round_trip_usec) / (double)round_trips;
+        max_round_trip_usec = std::max(max_round_trip_usec, round_trip);
+    }
+
+    in_block.store(false, std::memory_order_release);
+    return done;
+#else
+    return false;
+#endif
+}
+
+bool Lv2RemoteLink::command(uint32_t p_command, const std::vector<uint8_t> *p_in, std::vector<uint8_t> *r_out,
+                            std::vector<float> *r_controls) {
+    std::lock_guard<std::mutex> guard(command_mutex);
+    if (!shared || pid.load(std::memory_order_acquire) <= 0) {
+        return false;
+    }
+
+    if (p_command == LV2_REMOTE_COMMAND_ACTIVATE) {
+        active = true;
+    } else if (p_command == LV2_REMOTE_COMMAND_DEACTIVATE) {
+        active = false;
+    }
+
+    size_t in_bytes = p_in ? p_in->size() : 0;
+    if (in_bytes > REMOTE_BLOB_BYTES) {
+        return false;
+    }
+    if (in_bytes > 0) {
+        std::memcpy(blob, p_in->data(), in_bytes);
+    }
+    shared->blob_size = in_bytes;
+    shared->command_control_count = 0;
+
+    if (!post_command(p_command, REMOTE_COMMAND_TIMEOUT_USEC)) {
+        return false;
+    }
+
+    if (r_out) {
+        size_t out_bytes = std::min<size_t>(shared->blob_size, REMOTE_BLOB_BYTES);
+        r_out->assign(blob, blob + out_bytes);
+    }
+    if (r_controls) {
+        uint32_t count = std::min(shared->command_control_count, REMOTE_MAX_CONTROLS);
+        r_controls->assign(shared->command_controls, shared->command_controls + count);
+    }
+    return true;
+}
+
+void Lv2RemoteLink::set_timeout_usec(uint64_t p_usec) {
+    timeout_usec.store(std::max<uint64_t>(p_usec, REMOTE_WAIT_SLICE_USEC));
+}
+
+void Lv2RemoteLink::set_snapshot_interval_ms(int p_ms) {
+    snapshot_interval_ms.store(std::max(p_ms, 0));
+}
+
+uint32_t Lv2RemoteLink::get_restarts() const {
+    return restarts.load(std::memory_order_relaxed);
+}
+
+Lv2RemoteStats Lv2RemoteLink::get_stats() {
+    Lv2RemoteStats stats;
+    stats.running = ready.load();
+    stats.pid = pid.load();
+    stats.restarts = restarts.load();
+    stats.failures = failures.load();
+    stats.last_exit_status = last_exit_status.load();
+    // written by the instance thread, a torn read only skews one report
+    stats.round_trips = round_trips;
+    stats.mean_round_trip_usec = mean_round_trip_usec;
+    stats.max_round_trip_usec = max_round_trip_usec;
+    stats.snapshot_bytes = snapshot_bytes.load();
+    {
+        std::lock_guard<std::mutex> guard(supervisor_mutex);
+        stats.error = error;
+    }
+    return stats;
+}
+
+// ===== child =====
+namespace {
+
+#ifdef __linux__
+
+float *arena_span(float *p_arena, uint64_t p_offset, uint64_t p_frames) {
+    if (p_offset == REMOTE_NO_SECOND || p_offset + p_frames > REMOTE_ARENA_FLOATS) {
+        return nullptr;
+    }
+    return p_arena + p_offset;
+}
+
+void serve_block(Lv2Host &p_host, Lv2RemoteShared *p_shared, float *p_arena) {
+    const uint32_t frames = std::min(p_shared->frames, REMOTE_MAX_BLOCK);
+
+    const uint32_t midi_in_count = std::min(p_shared->midi_in_count, REMOTE_MAX_EVENTS);
+    for (uint32_t i = 0; i < midi_in_count; i++) {
+        const Lv2RemoteMidiEvent &remote_event = p_shared->midi_in[i];
+        MidiEvent midi_event{};
+        midi_event.frame = remote_event.frame;
+        midi_event.size = (int)std::min<uint32_t>(remote_event.size, MidiEvent::DATA_SIZE);
+        std::memcpy(midi_event.data, remote_event.data, MidiEvent::DATA_SIZE);
+        // this is the child's DSP thread, it queues like the parent's instance routing does
+        p_host.queue_midi_event((int)remote_event.bus, midi_event);
+    }
+    if (p_shared->notes_off) {
+        p_host.release_notes();
+    }
+
+    // control values as the parent sees them at the start of the block, then its timestamped changes
+    const int control_count = std::min<int>((int)p_shared->control_in_count, p_host.get_input_control_count());
+    for (int i = 0; i < control_count; i++) {
+        if (p_host.get_input_control_value(i) != p_shared->control_in[i]) {
+            p_host.set_input_control_value(i, p_shared->control_in[i]);
+        }
+    }
+    const uint32_t control_event_count = std::min(p_shared->control_event_count, REMOTE_MAX_EVENTS);
+    for (uint32_t i = 0; i < control_event_count; i++) {
+        ControlEvent control_event{};
+        control_event.frame = p_shared->control_events[i].frame;
+        control_event.index = p_shared->control_events[i].index;
+        control_event.value = p_shared->control_events[i].value;
+        p_host.queue_control_event(control_event);
+    }
+
+    const int inputs = std::min<int>(p_host.get_input_channel_count(), (int)REMOTE_MAX_CHANNELS);
+    for (int c = 0; c < inputs; c++) {
+        const Lv2RemoteBinding &binding = p_shared->audio_in[c];
+        uint32_t first_frames = std::min(binding.first_frames, frames);
+        float *first = arena_span(p_arena, binding.first, first_frames);
+        float *second = first_frames < frames ? arena_span(p_arena, binding.second, frames - first_frames) : nullptr;
+        if (!first || (first_frames < frames && !second)) {
+            p_host.bind_input_channel(c, p_host.get_input_channel_buffer(c), 0, nullptr);
+            continue;
+        }
+        p_host.bind_input_channel(c, first, (int)first_frames, second);
+    }
+    const int outputs = std::min<int>(p_host.get_output_channel_count(), (int)REMOTE_MAX_CHANNELS);
+    for (int c = 0; c < outputs; c++) {
+        const Lv2RemoteBinding &binding = p_shared->audio_out[c];
+        uint32_t first_frames = std::min(binding.first_frames, frames);
+        float *first = arena_span(p_arena, binding.first, first_frames);
+        float *second = first_frames < frames ? arena_span(p_arena, binding.second, frames - first_frames) : nullptr;
+        if (!first || (first_frames < frames && !second)) {
+            p_host.bind_output_channel(c, p_host.get_output_channel_buffer(c), 0, nullptr);
+            continue;
+        }
+        p_host.bind_output_channel(c, first, (int)first_frames, second);
+    }
+
+    p_host.perform((int)frames);
+
+    uint32_t midi_out_count = 0;
+    MidiEvent midi_event{};
+    for (int bus = 0; bus < p_host.get_output_midi_count(); bus++) {
+        while (midi_out_count < REMOTE_MAX_EVENTS && p_host.read_midi_out(bus, midi_event)) {
+            Lv2RemoteMidiEvent &remote_event = p_shared->midi_out[midi_out_count++];
+            remote_event.bus = (uint32_t)bus;
+            remote_event.frame = midi_event.frame;
+            remote_event.size = (uint32_t)midi_event.size;
+            std::memcpy(remote_event.data, midi_event.data, MidiEvent::DATA_SIZE);
+        }
+    }
+    p_shared->midi_out_count = midi_out_count;
+
+    const uint32_t control_out_count = std::min<uint32_t>((uint32_t)p_host.get_output_control_count(),
+                                                          REMOTE_MAX_CONTROLS);
+    for (uint32_t i = 0; i < control_out_count; i++) {
+        p_shared->control_out[i] = p_host.get_output_control_value((int)i);
+    }
+    p_shared->control_out_count = control_out_count;
+}
+
+void copy_controls(Lv2Host &p_host, Lv2RemoteShared *p_shared) {
+    const uint32_t count = std::min<uint32_t>((uint32_t)p_host.get_input_control_count(), REMOTE_MAX_CONTROLS);
+    for (uint32_t i = 0; i < count; i++) {
+        p_shared->command_controls[i] = p_host.get_input_control_value((int)i);
+    }
+    p_shared->command_control_count = count;
+}
+
+// false once told to quit
+bool serve_command(Lv2Host &p_host, Lv2RemoteShared *p_shared, uint8_t *p_blob) {
+    const size_t blob_size = std::min<size_t>(p_shared->blob_size, REMOTE_BLOB_BYTES);
+    int32_t result = 0;
+
+    switch (p_shared->command) {
+        case LV2_REMOTE_COMMAND_ACTIVATE: {
+            p_host.activate();
+        } break;
+        case LV2_REMOTE_COMMAND_DEACTIVATE: {
+            p_host.deactivate();
+        } break;
+        case LV2_REMOTE_COMMAND_SAVE_STATE: {
+            std::vector<uint8_t> state;
+            if (p_host.save_state(state) && state.size() <= REMOTE_BLOB_BYTES) {
+                std::memcpy(p_blob, state.data(), state.size());
+                p_shared->blob_size = state.size();
+            } else {
+                p_shared->blob_size = 0;
+                result = -1;
+            }
+        } break;
+        case LV2_REMOTE_COMMAND_RESTORE_STATE: {
+            std::vector<uint8_t> state(p_blob, p_blob + blob_size);
+            result = p_host.restore_state(state) ? 0 : -1;
+            copy_controls(p_host, p_shared);
+        } break;
+        case LV2_REMOTE_COMMAND_LOAD_PRESET: {
+            p_host.load_preset(std::string(reinterpret_cast<const char *>(p_blob), blob_size));
+            copy_controls(p_host, p_shared);
+        } break;
+        case LV2_REMOTE_COMMAND_QUIT: {
+            return false;
+        }
+        default: {
+            result = -1;
+        } break;
+    }
+
+    p_shared->command_result = result;
+    return true;
+}
+
+#endif
+
+} // namespace
+
+int lv2_remote_serve(int p_fd) {
+#ifdef __linux__
+    struct stat info;
+    if (fstat(p_fd, &info) != 0 || (size_t)info.st_size < remote_segment_bytes()) {
+        std::fprintf(stderr, "lv2-host: fd %d is not a shared segment\n", p_fd);
+        return 2;
+    }
+    void *mapped = mmap(nullptr, remote_segment_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, p_fd, 0);
+    if (mapped == MAP_FAILED) {
+        std::fprintf(stderr, "lv2-host: could not map the shared segment\n");
+        return 2;
+    }
+    close(p_fd);
+
+    uint8_t *segment = static_cast<uint8_t *>(mapped);
+    Lv2RemoteShared *shared = reinterpret_cast<Lv2RemoteShared *>(segment);
+    float *arena = reinterpret_cast<float *>(segment + remote_header_bytes());
+    uint8_t *blob = segment + remote_header_bytes() + REMOTE_ARENA_FLOATS * sizeof(float);
+    if (shared->magic != REMOTE_MAGIC || shared->version != REMOTE_VERSION) {
+        std::fprintf(stderr, "lv2-host: shared segment version mismatch\n");
+        return 2;
+    }
+
+    auto fail = [&](const char *p_message) {
+        std::fprintf(stderr, "lv2-host: %s\n", p_message);
+        shared->started.store(2, std::memory_order_release);
+        futex_wake(&shared->started);
+        return 3;
+    };
+
+    LilvWorld *world = lilv_world_new();
+    if (shared->lv2_path[0] != '\0') {
+        LilvNode *lv2_path = lilv_new_string(world, shared->lv2_path);
+        lilv_world_set_option(world, LILV_OPTION_LV2_PATH, lv2_path);
+        lilv_node_free(lv2_path);
+    }
+
+    Lv2Host host(world, shared->sample_rate, (int)shared->block_frames, shared->seq_bytes);
+    if (!host.load_world() || !host.find_plugin(shared->uri) || !host.instantiate()) {
+        return fail("could not instantiate the plugin");
+    }
+    host.wire_worker_interface();
+    host.set_state_dir(shared->state_dir);
+    host.set_min_sub_block(shared->min_sub_block);
+    if (!host.prepare_ports_and_buffers((int)shared->block_frames)) {
+        return fail("could not prepare the plugin ports");
+    }
+    if (host.get_input_channel_count() > (int)REMOTE_MAX_CHANNELS ||
+        host.get_output_channel_count() > (int)REMOTE_MAX_CHANNELS) {
+        return fail("the plugin has more audio channels than the transport carries");
+    }
+
+    if (shared->realtime_policy != LV2_REALTIME_POLICY_NONE) {
+        lv2_realtime_apply((Lv2RealtimePolicy)shared->realtime_policy, shared->realtime_priority, {});
+    }
+
+    shared->started.store(1, std::memory_order_release);
+    futex_wake(&shared->started);
+
+    bool running = true;
+    while (running) {
+        const uint32_t doorbell = shared->doorbell.load(std::memory_order_acquire);
+
+        const uint32_t block_posted = shared->block_posted.load(std::memory_order_acquire);
+        if (block_posted != shared->block_done.load(std::memory_order_relaxed)) {
+            serve_block(host, shared, arena);
+            shared->block_done.store(block_posted, std::memory_order_release);
+            futex_wake(&shared->block_done);
+        }
+
+        const uint32_t command_posted = shared->command_posted.load(std::memory_order_acquire);
+        if (command_posted != shared->command_done.load(std::memory_order_relaxed)) {
+            running = serve_command(host, shared, blob);
+            shared->command_done.store(command_posted, std::memory_order_release);
+            futex_wake(&shared->command_done);
+        }
+
+        if (running) {
+            // the parent dying leaves nobody to ring, PR_SET_PDEATHSIG ends the process then
+            futex_wait(&shared->doorbell, doorbell, REMOTE_COMMAND_TIMEOUT_USEC);
+        }
+    }
+
+    return 0;
+#else
+    (void)p_fd;
+    std::fprintf(stderr, "lv2-host: --serve is only supported on Linux\n");
+    return 2;
+#endif
+}
+
+} // namespace godot
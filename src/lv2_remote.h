@@ -0,0 +1,224 @@
+#ifndef LV2_REMOTE_H
+#define LV2_REMOTE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+const uint32_t REMOTE_MAGIC = 0x4c563252; // "LV2R"
+const uint32_t REMOTE_VERSION = 1;
+const uint32_t REMOTE_MAX_CHANNELS = 32;
+const uint32_t REMOTE_MAX_CONTROLS = 1024;
+const uint32_t REMOTE_MAX_EVENTS = 1024;
+const uint32_t REMOTE_MAX_BLOCK = 8192;
+// floats shared between the processes: rings handed out by allocate_frames() plus one scratch block per channel
+// for buffers that live outside of the segment; pages are only backed once touched
+const size_t REMOTE_ARENA_FLOATS = 4u << 20;
+const size_t REMOTE_SCRATCH_FLOATS = (size_t)REMOTE_MAX_CHANNELS * 2 * REMOTE_MAX_BLOCK;
+const size_t REMOTE_BLOB_BYTES = 16u << 20;
+// where the child finds the segment
+const int REMOTE_CHILD_FD = 3;
+const uint64_t REMOTE_NO_SECOND = UINT64_MAX;
+
+enum Lv2RemoteCommand : uint32_t {
+    LV2_REMOTE_COMMAND_NONE,
+    LV2_REMOTE_COMMAND_ACTIVATE,
+    LV2_REMOTE_COMMAND_DEACTIVATE,
+    LV2_REMOTE_COMMAND_SAVE_STATE,
+    LV2_REMOTE_COMMAND_RESTORE_STATE,
+    LV2_REMOTE_COMMAND_LOAD_PRESET,
+    LV2_REMOTE_COMMAND_QUIT,
+};
+
+struct Lv2RemoteMidiEvent {
+    uint32_t bus;
+    int32_t frame;
+    uint32_t size;
+    uint8_t data[4];
+};
+
+struct Lv2RemoteControlEvent {
+    int32_t frame;
+    uint32_t index;
+    float value;
+};
+
+// a frame port binding as offsets (in floats) into the arena, see PortBinding
+struct Lv2RemoteBinding {
+    uint64_t first;
+    uint32_t first_frames;
+    uint64_t second;
+};
+
+// Head of the shared segment, followed by the arena and the blob area. Both processes map the same memfd, the
+// mailboxes are sequence numbers waited on with futexes (posted != done means a request is pending).
+struct Lv2RemoteShared {
+    uint32_t magic;
+    uint32_t version;
+
+    // startup, written by the parent before spawning
+    double sample_rate;
+    uint32_t block_frames;
+    uint32_t seq_bytes;
+    uint32_t min_sub_block;
+    char uri[1024];
+    char state_dir[1024];
+    char lv2_path[4096];
+    // Lv2RealtimePolicy and priority for the child's serving thread
+    uint32_t realtime_policy;
+    int32_t realtime_priority;
+
+    // child: 1 once the plugin is instantiated, 2 if that failed
+    std::atomic<uint32_t> started;
+    // bumped by the parent after posting a block or a command
+    std::atomic<uint32_t> doorbell;
+
+    // block mailbox, owned by the instance thread
+    std::atomic<uint32_t> block_posted;
+    std::atomic<uint32_t> block_done;
+    uint32_t frames;
+    uint32_t notes_off;
+    uint32_t midi_in_count;
+    Lv2RemoteMidiEvent midi_in[REMOTE_MAX_EVENTS];
+    uint32_t control_event_count;
+    Lv2RemoteControlEvent control_events[REMOTE_MAX_EVENTS];
+    uint32_t control_in_count;
+    float control_in[REMOTE_MAX_CONTROLS];
+    Lv2RemoteBinding audio_in[REMOTE_MAX_CHANNELS];
+    Lv2RemoteBinding audio_out[REMOTE_MAX_CHANNELS];
+    uint32_t midi_out_count;
+    Lv2RemoteMidiEvent midi_out[REMOTE_MAX_EVENTS];
+    uint32_t control_out_count;
+    float control_out[REMOTE_MAX_CONTROLS];
+
+    // command mailbox, non-realtime callers take turns through Lv2RemoteLink::command_mutex
+    std::atomic<uint32_t> command_posted;
+    std::atomic<uint32_t> command_done;
+    uint32_t command;
+    int32_t command_result;
+    uint64_t blob_size;
+    // input control values after a command that may change them (state restore, preset)
+    uint32_t command_control_count;
+    float command_controls[REMOTE_MAX_CONTROLS];
+};
+
+struct Lv2RemoteStats {
+    bool running = false;
+    int pid = 0;
+    uint32_t restarts = 0;
+    uint32_t failures = 0;
+    // raw waitpid status of the last child that died, -1 if it was killed after a timeout
+    int last_exit_status = 0;
+    uint64_t round_trips = 0;
+    double mean_round_trip_usec = 0.0;
+    double max_round_trip_usec = 0.0;
+    size_t snapshot_bytes = 0;
+    std::string error;
+};
+
+// Parent side of an out-of-process plugin: owns the shared segment, spawns `lv2-host --serve` on it and
+// supervises the child. A child that crashes (or stops answering within the timeout) is killed, restarted on the
+// same segment and given back the last state snapshot, taken every snapshot interval. Linux only, start() fails
+// elsewhere.
+class Lv2RemoteLink {
+private:
+    std::string executable;
+    int fd;
+    uint8_t *segment;
+    size_t segment_bytes;
+    Lv2RemoteShared *shared;
+    float *arena;
+    uint8_t *blob;
+    size_t arena_used;
+
+    std::atomic<int> pid;
+    std::atomic<bool> ready;
+    std::atomic<bool> in_block;
+    std::atomic<bool> failed;
+    std::atomic<uint32_t> restarts;
+    bool active;
+    std::atomic<uint64_t> timeout_usec;
+    std::atomic<int> snapshot_interval_ms;
+    uint32_t realtime_policy;
+    int realtime_priority;
+
+    // instance thread
+    uint64_t round_trips;
+    double mean_round_trip_usec;
+    double max_round_trip_usec;
+
+    std::mutex command_mutex;
+    // supervisor thread
+    std::vector<uint8_t> snapshot;
+    std::atomic<size_t> snapshot_bytes;
+
+    std::thread supervisor;
+    std::mutex supervisor_mutex;
+    std::condition_variable supervisor_wake;
+    std::atomic<bool> quit;
+    std::atomic<uint32_t> failures;
+    std::atomic<int> last_exit_status;
+    // guarded by supervisor_mutex
+    std::string error;
+
+    bool create_segment();
+    bool spawn();
+    bool wait_started();
+    void kill_child();
+    void reap(bool p_block);
+    void supervise();
+    bool restart();
+    bool post_command(uint32_t p_command, uint64_t p_timeout_usec);
+    void set_error(const std::string &p_error);
+
+public:
+    explicit Lv2RemoteLink(const std::string &p_executable);
+    ~Lv2RemoteLink();
+
+    Lv2RemoteLink(const Lv2RemoteLink &) = delete;
+    Lv2RemoteLink &operator=(const Lv2RemoteLink &) = delete;
+
+    bool start(const std::string &p_uri, double p_sample_rate, uint32_t p_block_frames, uint32_t p_seq_bytes,
+               uint32_t p_min_sub_block, const std::string &p_state_dir, const std::string &p_lv2_path);
+    // applied by the child to its serving thread, from the next (re)start on
+    void set_realtime(uint32_t p_policy, int p_priority);
+    void stop();
+    bool is_ready() const;
+
+    Lv2RemoteShared *get_shared() const;
+    // memory inside the segment, nullptr once it runs out; valid until the next reset_arena()
+    float *allocate_frames(size_t p_count);
+    void reset_arena();
+    // offset in floats of p_data inside the arena, false if it lies outside
+    bool arena_offset(const float *p_data, size_t p_count, uint64_t &r_offset) const;
+    float *get_arena() const;
+    float *get_scratch(uint32_t p_slot) const;
+
+    // instance thread: posts the block in the shared mailbox and waits for the child, false if it died or
+    // timed out (it is then restarted in the background)
+    bool run_block();
+
+    // non-realtime: p_in goes to the blob area, the blob area comes back in r_out
+    bool command(uint32_t p_command, const std::vector<uint8_t> *p_in, std::vector<uint8_t> *r_out,
+                 std::vector<float> *r_controls = nullptr);
+
+    void set_timeout_usec(uint64_t p_usec);
+    void set_snapshot_interval_ms(int p_ms);
+    uint32_t get_restarts() const;
+    Lv2RemoteStats get_stats();
+};
+
+// Child side: maps the segment passed as p_fd, instantiates the plugin it names and serves blocks and commands
+// until told to quit or the parent goes away. Returns the process exit code.
+int lv2_remote_serve(int p_fd);
+
+} // namespace godot
+
+#endif
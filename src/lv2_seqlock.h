@@ -0,0 +1,41 @@
+#ifndef LV2_SEQLOCK_H
+#define LV2_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace godot {
+
+// Single writer (DSP thread), any number of lock-free readers that retry on a torn read.
+class Lv2SeqLock {
+private:
+    std::atomic<uint32_t> sequence{0};
+
+public:
+    void write_begin() {
+        uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void write_end() {
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    uint32_t read_begin() const {
+        uint32_t s = sequence.load(std::memory_order_acquire);
+        while (s & 1u) {
+            s = sequence.load(std::memory_order_acquire);
+        }
+        return s;
+    }
+
+    bool read_retry(uint32_t p_sequence) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) != p_sequence;
+    }
+};
+
+} // namespace godot
+
+#endif
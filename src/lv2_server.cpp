@@ -3,6 +3,7 @@
 #include <godot_cpp/classes/input.hpp>
 #include <godot_cpp/classes/project_settings.hpp>
 #include <godot_cpp/classes/resource_loader.hpp>
+#include <godot_cpp/classes/time.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
 
 #include "godot_cpp/classes/engine.hpp"
@@ -21,6 +22,62 @@ namespace godot {
 
 Lv2Server *Lv2Server::singleton = NULL;
 
+namespace {
+
+// governor ticks between two escalations, so the previous step gets a chance to show in the load
+const int GOVERNOR_COOLDOWN_TICKS = 5;
+// ticks the load has to stay under GOVERNOR_RECOVER_FRACTION of the budget before stepping back
+const int GOVERNOR_RECOVER_TICKS = 50;
+const float GOVERNOR_RECOVER_FRACTION = 0.7f;
+const int GOVERNOR_MAX_ACTIONS = 64;
+
+const char *GOVERNOR_ACTION_NAMES[] = {"restore", "skip_silent_tails", "reduce_quality", "bypass", "mute"};
+
+// the channel message an InputEventMIDI was decoded from, false for system messages
+bool encode_midi_message(const Ref<InputEventMIDI> &p_event, MidiEvent &r_event) {
+    int message = p_event->get_message();
+    int channel = p_event->get_channel() & 0x0F;
+
+    r_event.frame = 0;
+    r_event.size = 3;
+    r_event.data[0] = (uint8_t)((message << 4) | channel);
+
+    switch (message) {
+        case MIDIMessage::MIDI_MESSAGE_NOTE_OFF:
+        case MIDIMessage::MIDI_MESSAGE_NOTE_ON:
+            r_event.data[1] = (uint8_t)(p_event->get_pitch() & 0x7F);
+            r_event.data[2] = (uint8_t)(p_event->get_velocity() & 0x7F);
+            return true;
+        case MIDIMessage::MIDI_MESSAGE_AFTERTOUCH:
+            r_event.data[1] = (uint8_t)(p_event->get_pitch() & 0x7F);
+            r_event.data[2] = (uint8_t)(p_event->get_pressure() & 0x7F);
+            return true;
+        case MIDIMessage::MIDI_MESSAGE_CONTROL_CHANGE:
+            r_event.data[1] = (uint8_t)(p_event->get_controller_number() & 0x7F);
+            r_event.data[2] = (uint8_t)(p_event->get_controller_value() & 0x7F);
+            return true;
+        case MIDIMessage::MIDI_MESSAGE_PROGRAM_CHANGE:
+            r_event.size = 2;
+            r_event.data[1] = (uint8_t)(p_event->get_instrument() & 0x7F);
+            r_event.data[2] = 0;
+            return true;
+        case MIDIMessage::MIDI_MESSAGE_CHANNEL_PRESSURE:
+            r_event.size = 2;
+            r_event.data[1] = (uint8_t)(p_event->get_pressure() & 0x7F);
+            r_event.data[2] = 0;
+            return true;
+        case MIDIMessage::MIDI_MESSAGE_PITCH_BEND:
+            // the 14-bit bend value is reported as the pitch
+            r_event.data[1] = (uint8_t)(p_event->get_pitch() & 0x7F);
+            r_event.data[2] = (uint8_t)((p_event->get_pitch() >> 7) & 0x7F);
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
 Lv2Server::Lv2Server() {
     world = lilv_world_new();
     initialized = false;
@@ -28,12 +85,20 @@ Lv2Server::Lv2Server() {
     edited = false;
     singleton = this;
     exit_thread = false;
+    solo_mode = false;
+    blocks_started = false;
+    default_loading_policy = Lv2Instance::LOADING_POLICY_ISOLATED;
+    midi_inputs_open = false;
     call_deferred("initialize");
 }
 
 Lv2Server::~Lv2Server() {
     finish();
 
+    // no instance may render another one while they go away
+    connections.clear();
+    update_graph();
+
     for (int i = 0; i < instances.size(); i++) {
         if (instances[i]) {
             instances[i]->stop();
@@ -77,14 +142,14 @@ Lv2Server *Lv2Server::get_singleton() {
 }
 
 void Lv2Server::add_property(String name, String default_value, GDExtensionVariantType extension_type,
-                             PropertyHint hint) {
+                             PropertyHint hint, String hint_string) {
     if (godot::Engine::get_singleton()->is_editor_hint() && !ProjectSettings::get_singleton()->has_setting(name)) {
         ProjectSettings::get_singleton()->set_setting(name, default_value);
         Dictionary property_info;
         property_info["name"] = name;
         property_info["type"] = extension_type;
         property_info["hint"] = hint;
-        property_info["hint_string"] = "";
+        property_info["hint_string"] = hint_string;
         ProjectSettings::get_singleton()->add_property_info(property_info);
         ProjectSettings::get_singleton()->set_initial_value(name, default_value);
         Error error = ProjectSettings::get_singleton()->save();
@@ -101,6 +166,37 @@ void Lv2Server::initialize() {
                  PROPERTY_HINT_FILE);
     add_property("audio/lv2-host/lv2_path", "", GDEXTENSION_VARIANT_TYPE_STRING, PROPERTY_HINT_DIR);
     add_property("audio/lv2-host/hide_lv2_logs", "true", GDEXTENSION_VARIANT_TYPE_BOOL, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/ring_latency_ms", "20", GDEXTENSION_VARIANT_TYPE_FLOAT, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/jitter_target_frames", "512", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/jitter_max_frames", "1024", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/jitter_stable_blocks", "256", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/underrun_fade_frames", "64", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/true_peak_metering", "false", GDEXTENSION_VARIANT_TYPE_BOOL, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/min_sub_block_frames", "16", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/realtime_policy", "0", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_ENUM,
+                 "None,FIFO,RR");
+    add_property("audio/lv2-host/realtime_priority", "50", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_RANGE, "1,99");
+    add_property("audio/lv2-host/dsp_cpu_affinity", "", GDEXTENSION_VARIANT_TYPE_STRING, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/lock_memory", "false", GDEXTENSION_VARIANT_TYPE_BOOL, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/page_fault_tracking", "false", GDEXTENSION_VARIANT_TYPE_BOOL, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/deadline_scheduling", "false", GDEXTENSION_VARIANT_TYPE_BOOL, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/governor_enabled", "false", GDEXTENSION_VARIANT_TYPE_BOOL, PROPERTY_HINT_NONE);
+    add_property("audio/lv2-host/watchdog_blocks", "8", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_RANGE, "1,1000");
+    add_property("audio/lv2-host/loading_policy", "1", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_ENUM,
+                 "Shared,Isolated,Out of process");
+    add_property("audio/lv2-host/host_executable", "res://addons/lv2-host/bin/linux/release/bin/lv2-host",
+                 GDEXTENSION_VARIANT_TYPE_STRING, PROPERTY_HINT_GLOBAL_FILE);
+    add_property("audio/lv2-host/remote_snapshot_ms", "1000", GDEXTENSION_VARIANT_TYPE_INT, PROPERTY_HINT_RANGE,
+                 "0,60000");
+    add_property("audio/lv2-host/dsp_budget", "0.8", GDEXTENSION_VARIANT_TYPE_FLOAT, PROPERTY_HINT_RANGE,
+                 "0.1,64,0.05");
+
+    governor.enabled = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/governor_enabled", false);
+    governor.budget = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/dsp_budget", 0.8f);
+
+    int policy = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/loading_policy", 1);
+    default_loading_policy = (Lv2Instance::LoadingPolicy)CLAMP(policy, (int)Lv2Instance::LOADING_POLICY_SHARED,
+                                                               (int)Lv2Instance::LOADING_POLICY_OUT_OF_PROCESS);
 
     String lv2_path = ProjectSettings::get_singleton()->get_setting("audio/lv2-host/lv2_path");
 
@@ -128,37 +224,80 @@ void Lv2Server::initialize() {
         SceneTree *tree = Object::cast_to<SceneTree>(Engine::get_singleton()->get_main_loop());
         tree->get_root()->add_child(server_node);
         server_node->set_process(true);
+        server_node->set_process_input(true);
     }
 
     start();
     initialized = true;
+    wake();
 }
 
 void Lv2Server::process() {
 }
 
+void Lv2Server::wake() {
+    if (wake_semaphore.is_valid()) {
+        wake_semaphore->post();
+    }
+}
+
+void Lv2Server::watch_block() {
+    if (!blocks_started.exchange(true, std::memory_order_acq_rel)) {
+        wake();
+    }
+}
+
+void Lv2Server::update_solo_mode() {
+    bool use_solo = false;
+    for (int i = 0; i < instances.size(); i++) {
+        if (instances[i]->solo == true) {
+            use_solo = true;
+        }
+    }
+
+    solo_mode = use_solo;
+}
+
 void Lv2Server::thread_func() {
-    int msdelay = 1000;
+    bool ticking = false;
+
     while (!exit_thread) {
-        if (!initialized) {
+        if (ticking) {
+            // the watchdog and the governor sample once per block period, wakes in between are folded into the
+            // next tick
+            int mix_rate = AudioServer::get_singleton()->get_mix_rate();
+            OS::get_singleton()->delay_usec((uint64_t)BUFFER_FRAME_SIZE * 1000000 / MAX(mix_rate, 1));
+            while (wake_semaphore->try_wait()) {
+            }
+        } else {
+            // parked until initialize, the first block after a quiet spell, the governor or shutdown
+            wake_semaphore->wait();
+        }
+
+        if (exit_thread || !initialized) {
+            ticking = false;
             continue;
         }
 
         lock();
 
-        bool use_solo = false;
+        // the mix thread doesn't wait for run() to return, a plugin hanging in it is quarantined from here
+        bool performing = false;
         for (int i = 0; i < instances.size(); i++) {
-            if (instances[i]->solo == true) {
-                use_solo = true;
+            instances[i]->check_watchdog();
+            if (instances[i]->perform_started_usec.load(std::memory_order_acquire) != 0) {
+                performing = true;
             }
         }
 
-        if (use_solo != solo_mode) {
-            solo_mode = use_solo;
+        if (governor.enabled) {
+            update_governor();
         }
 
+        bool started = blocks_started.exchange(false, std::memory_order_acq_rel);
+        ticking = governor.enabled || performing || started;
+
         unlock();
-        OS::get_singleton()->delay_usec(msdelay * 1000);
     }
 }
 
@@ -171,6 +310,16 @@ void Lv2Server::set_instance_count(int p_count) {
     int cb = instances.size();
 
     if (p_count < instances.size()) {
+        for (int i = p_count; i < instances.size(); i++) {
+            remove_connections_of(instances[i]->instance_name);
+            for (int j = midi_routes.size() - 1; j >= 0; j--) {
+                if (midi_routes[j].instance == instances[i]->instance_name) {
+                    midi_routes.remove_at(j);
+                }
+            }
+        }
+        update_graph();
+
         for (int i = p_count; i < instances.size(); i++) {
             instance_map.erase(instances[i]->instance_name);
             memdelete(instances[i]);
@@ -216,8 +365,15 @@ void Lv2Server::set_instance_count(int p_count) {
         if (!instances[i]->is_connected("lv2_ready", Callable(this, "on_ready"))) {
             instances[i]->connect("lv2_ready", Callable(this, "on_ready"), CONNECT_DEFERRED);
         }
+        if (!instances[i]->is_connected("plugin_hung", Callable(this, "on_plugin_hung"))) {
+            instances[i]->connect("plugin_hung", Callable(this, "on_plugin_hung"), CONNECT_DEFERRED);
+        }
+        if (!instances[i]->is_connected("plugin_restarted", Callable(this, "on_plugin_restarted"))) {
+            instances[i]->connect("plugin_restarted", Callable(this, "on_plugin_restarted"), CONNECT_DEFERRED);
+        }
     }
 
+    update_solo_mode();
     emit_signal("layout_changed");
 }
 
@@ -234,11 +390,20 @@ void Lv2Server::remove_instance(int p_index) {
 
     edited = true;
 
+    remove_connections_of(instances[p_index]->instance_name);
+    update_graph();
+    for (int i = midi_routes.size() - 1; i >= 0; i--) {
+        if (midi_routes[i].instance == instances[p_index]->instance_name) {
+            midi_routes.remove_at(i);
+        }
+    }
+
     instances[p_index]->stop();
     instance_map.erase(instances[p_index]->instance_name);
     memdelete(instances[p_index]);
     instances.remove_at(p_index);
 
+    update_solo_mode();
     emit_signal("layout_changed");
 }
 
@@ -285,6 +450,12 @@ void Lv2Server::add_instance(int p_at_pos) {
     if (!instance->is_connected("lv2_ready", Callable(this, "on_ready"))) {
         instance->connect("lv2_ready", Callable(this, "on_ready"), CONNECT_DEFERRED);
     }
+    if (!instance->is_connected("plugin_hung", Callable(this, "on_plugin_hung"))) {
+        instance->connect("plugin_hung", Callable(this, "on_plugin_hung"), CONNECT_DEFERRED);
+    }
+    if (!instance->is_connected("plugin_restarted", Callable(this, "on_plugin_restarted"))) {
+        instance->connect("plugin_restarted", Callable(this, "on_plugin_restarted"), CONNECT_DEFERRED);
+    }
 
     instance_map[attempt] = instance;
 
@@ -352,6 +523,20 @@ void Lv2Server::set_instance_name(int p_index, const String &p_name) {
         attempts++;
         attempt = p_name + String(" ") + itos(attempts);
     }
+    for (int i = 0; i < connections.size(); i++) {
+        if (connections[i].from == instances[p_index]->instance_name) {
+            connections.write[i].from = attempt;
+        }
+        if (connections[i].to == instances[p_index]->instance_name) {
+            connections.write[i].to = attempt;
+        }
+    }
+    for (int i = 0; i < midi_routes.size(); i++) {
+        if (midi_routes[i].instance == instances[p_index]->instance_name) {
+            midi_routes.write[i].instance = attempt;
+        }
+    }
+
     instance_map.erase(instances[p_index]->instance_name);
     instances[p_index]->instance_name = attempt;
     instance_map[attempt] = instances[p_index];
@@ -422,6 +607,7 @@ void Lv2Server::set_solo(int p_index, bool p_enable) {
     edited = true;
 
     instances[p_index]->solo = p_enable;
+    update_solo_mode();
 }
 
 bool Lv2Server::is_solo(int p_index) const {
@@ -460,20 +646,720 @@ bool Lv2Server::is_bypassing(int p_index) const {
 
 float Lv2Server::get_channel_peak_volume_db(int p_index, int p_channel) const {
     ERR_FAIL_INDEX_V(p_index, instances.size(), 0);
-    ERR_FAIL_INDEX_V(p_channel, instances[p_index]->output_channels.size(), 0);
+    MeterSnapshot snapshot = instances[p_index]->get_meter_snapshot();
+    ERR_FAIL_INDEX_V(p_channel, snapshot.channels, 0);
 
-    return instances[p_index]->output_channels[p_channel].peak_volume;
+    return snapshot.peak_db[p_channel];
 }
 
 bool Lv2Server::is_channel_active(int p_index, int p_channel) const {
     ERR_FAIL_INDEX_V(p_index, instances.size(), false);
-    if (p_channel >= instances[p_index]->output_channels.size()) {
+    MeterSnapshot snapshot = instances[p_index]->get_meter_snapshot();
+    if (p_channel >= snapshot.channels) {
         return false;
     }
 
-    ERR_FAIL_INDEX_V(p_channel, instances[p_index]->output_channels.size(), false);
+    ERR_FAIL_INDEX_V(p_channel, snapshot.channels, false);
+
+    return snapshot.active[p_channel];
+}
+
+Array Lv2Server::get_meter_snapshot() const {
+    Array result;
+
+    for (int i = 0; i < instances.size(); i++) {
+        MeterSnapshot snapshot = instances[i]->get_meter_snapshot();
+
+        PackedFloat32Array peak_db;
+        PackedFloat32Array rms_db;
+        PackedFloat32Array true_peak_db;
+        Array active;
+
+        peak_db.resize(snapshot.channels);
+        rms_db.resize(snapshot.channels);
+        true_peak_db.resize(snapshot.channels);
+
+        for (int channel = 0; channel < snapshot.channels; channel++) {
+            peak_db.set(channel, snapshot.peak_db[channel]);
+            rms_db.set(channel, snapshot.rms_db[channel]);
+            true_peak_db.set(channel, snapshot.true_peak_db[channel]);
+            active.push_back(snapshot.active[channel]);
+        }
+
+        Dictionary meter;
+        meter["name"] = instances[i]->instance_name;
+        meter["peak_db"] = peak_db;
+        meter["rms_db"] = rms_db;
+        meter["true_peak_db"] = true_peak_db;
+        meter["active"] = active;
+        result.push_back(meter);
+    }
+
+    return result;
+}
+
+void Lv2Server::set_realtime_policy(Lv2Instance::RealtimePolicy p_policy, int p_priority) {
+    for (int i = 0; i < instances.size(); i++) {
+        instances[i]->set_realtime_policy(p_policy, p_priority);
+    }
+}
+
+void Lv2Server::set_dsp_cpu_affinity(const PackedInt32Array &p_cpus) {
+    for (int i = 0; i < instances.size(); i++) {
+        instances[i]->set_cpu_affinity(p_cpus);
+    }
+}
+
+Array Lv2Server::get_realtime_status() const {
+    Array result;
+
+    for (int i = 0; i < instances.size(); i++) {
+        Dictionary status = instances[i]->get_realtime_status();
+        status["name"] = instances[i]->instance_name;
+        result.push_back(status);
+    }
+
+    return result;
+}
+
+void Lv2Server::set_deadline_scheduling(bool p_enabled) {
+    for (int i = 0; i < instances.size(); i++) {
+        instances[i]->set_deadline_scheduling(p_enabled);
+    }
+}
+
+Dictionary Lv2Server::get_deadline_stats(int p_index) const {
+    ERR_FAIL_INDEX_V(p_index, instances.size(), Dictionary());
+
+    Dictionary stats = instances[p_index]->get_deadline_stats();
+    stats["name"] = instances[p_index]->instance_name;
+    return stats;
+}
+
+void Lv2Server::reset_deadline_stats(int p_index) {
+    ERR_FAIL_INDEX(p_index, instances.size());
+
+    instances[p_index]->reset_deadline_stats();
+}
+
+void Lv2Server::update_governor() {
+    uint64_t now = Time::get_singleton()->get_ticks_usec();
+    uint64_t elapsed = now - governor.last_tick_usec;
+    bool first_tick = governor.last_tick_usec == 0;
+    governor.last_tick_usec = now;
+
+    uint64_t busy = 0;
+    bool priority_missed = false;
+    for (int i = 0; i < instances.size(); i++) {
+        Lv2Instance *instance = instances[i];
+        uint64_t instance_busy = instance->busy_usec.load(std::memory_order_relaxed);
+        busy += instance_busy - instance->governor_busy_seen;
+        instance->governor_busy_seen = instance_busy;
+
+        if (!instance->lock_watched()) {
+            // quarantined instances neither count towards the load nor get degraded
+            continue;
+        }
+        uint32_t missed = instance->deadline.missed;
+        instance->unlock();
+        if (instance->priority > Lv2Instance::PRIORITY_LOW && missed > instance->governor_missed_seen) {
+            priority_missed = true;
+        }
+        instance->governor_missed_seen = missed;
+    }
+
+    if (first_tick || elapsed == 0) {
+        return;
+    }
+
+    governor.load = (float)((double)busy / elapsed);
+    governor.cooldown = MAX(governor.cooldown - 1, 0);
+
+    int level = governor.level;
+    if (governor.load > governor.budget || priority_missed) {
+        governor.calm_ticks = 0;
+        if (governor.cooldown == 0 && level < Lv2Instance::DEGRADE_MUTE) {
+            level++;
+            governor.cooldown = GOVERNOR_COOLDOWN_TICKS;
+            governor.escalations++;
+        }
+    } else if (governor.load < governor.budget * GOVERNOR_RECOVER_FRACTION && level > 0) {
+        governor.calm_ticks++;
+        if (governor.calm_ticks >= GOVERNOR_RECOVER_TICKS) {
+            level--;
+            governor.calm_ticks = 0;
+            governor.recoveries++;
+        }
+    } else {
+        governor.calm_ticks = 0;
+    }
+
+    governor.level = level;
+
+    for (int i = 0; i < instances.size(); i++) {
+        Lv2Instance *instance = instances[i];
+        int target = instance->priority == Lv2Instance::PRIORITY_LOW ? level : Lv2Instance::DEGRADE_NONE;
+        if (instance->degrade_level.load(std::memory_order_relaxed) == target) {
+            continue;
+        }
+
+        String detail = instance->apply_degrade_level(target);
+        // named after the state entered, stepping back down from mute reports "bypass" and so on
+        String action = GOVERNOR_ACTION_NAMES[target];
+
+        Dictionary entry;
+        entry["time_usec"] = now;
+        entry["name"] = instance->instance_name;
+        entry["action"] = action;
+        entry["level"] = target;
+        entry["load"] = governor.load;
+        entry["detail"] = detail;
+        governor_actions.push_back(entry);
+        if (governor_actions.size() > GOVERNOR_MAX_ACTIONS) {
+            governor_actions.pop_front();
+        }
+
+        call_deferred("emit_signal", "governor_action", instance->instance_name, action, target, governor.load,
+                      detail);
+    }
+}
+
+void Lv2Server::set_governor_enabled(bool p_enabled) {
+    lock();
+    governor.enabled = p_enabled;
+    governor.last_tick_usec = 0;
+    governor.cooldown = 0;
+    governor.calm_ticks = 0;
+
+    if (!p_enabled) {
+        // nothing would ever restore them otherwise
+        governor.level = 0;
+        for (int i = 0; i < instances.size(); i++) {
+            instances[i]->apply_degrade_level(Lv2Instance::DEGRADE_NONE);
+        }
+    }
+
+    unlock();
+
+    wake();
+}
+
+bool Lv2Server::is_governor_enabled() const {
+    return governor.enabled;
+}
+
+void Lv2Server::set_dsp_budget(float p_cores) {
+    ERR_FAIL_COND(p_cores <= 0.0f);
+    governor.budget = p_cores;
+}
+
+float Lv2Server::get_dsp_budget() const {
+    return governor.budget;
+}
+
+void Lv2Server::set_priority(int p_index, Lv2Instance::Priority p_priority) {
+    ERR_FAIL_INDEX(p_index, instances.size());
+
+    edited = true;
+
+    instances[p_index]->set_priority(p_priority);
+}
+
+Lv2Instance::Priority Lv2Server::get_priority(int p_index) const {
+    ERR_FAIL_INDEX_V(p_index, instances.size(), Lv2Instance::PRIORITY_NORMAL);
+    return instances[p_index]->get_priority();
+}
+
+Array Lv2Server::get_governor_actions() {
+    // update_governor() appends from the server thread under the lock
+    lock();
+    Array actions = governor_actions.duplicate();
+    unlock();
+    return actions;
+}
+
+Dictionary Lv2Server::get_governor_stats() {
+    Dictionary stats;
+    lock();
+    stats["enabled"] = governor.enabled;
+    stats["budget"] = governor.budget;
+    stats["load"] = governor.load;
+    stats["level"] = governor.level;
+    stats["action"] = GOVERNOR_ACTION_NAMES[governor.level];
+    stats["escalations"] = governor.escalations;
+    stats["recoveries"] = governor.recoveries;
+    unlock();
+    return stats;
+}
+
+void Lv2Server::set_loading_policy(const String &p_uri, Lv2Instance::LoadingPolicy p_policy) {
+    ERR_FAIL_COND(p_uri.is_empty());
+    ERR_FAIL_INDEX(p_policy, Lv2Instance::LOADING_POLICY_OUT_OF_PROCESS + 1);
+
+    edited = true;
+
+    loading_policies[p_uri] = p_policy;
+}
+
+Lv2Instance::LoadingPolicy Lv2Server::get_loading_policy(const String &p_uri) const {
+    if (loading_policies.has(p_uri)) {
+        return (Lv2Instance::LoadingPolicy)loading_policies[p_uri];
+    }
+    return default_loading_policy;
+}
+
+void Lv2Server::clear_loading_policy(const String &p_uri) {
+    edited = true;
+
+    loading_policies.erase(p_uri);
+}
+
+Dictionary Lv2Server::get_loading_policies() const {
+    Dictionary result;
+    for (const KeyValue<String, int> &E : loading_policies) {
+        result[E.key] = E.value;
+    }
+    return result;
+}
+
+int Lv2Server::get_isolated_namespace_count() const {
+    return Lv2Host::get_isolated_namespace_count();
+}
+
+int Lv2Server::get_isolated_namespace_limit() const {
+    return ISOLATED_NAMESPACE_LIMIT;
+}
+
+Error Lv2Server::insert_connection(const Lv2Layout::Connection &p_connection) {
+    ERR_FAIL_INDEX_V(p_connection.type, CONNECTION_MIDI + 1, ERR_INVALID_PARAMETER);
+    ERR_FAIL_COND_V(!instance_map.has(p_connection.from) || !instance_map.has(p_connection.to), ERR_DOES_NOT_EXIST);
+    ERR_FAIL_COND_V(p_connection.from == p_connection.to, ERR_INVALID_PARAMETER);
+    ERR_FAIL_COND_V(p_connection.from_port < 0 || p_connection.to_port < 0, ERR_INVALID_PARAMETER);
+    ERR_FAIL_COND_V(p_connection.type == CONNECTION_AUDIO &&
+                        (p_connection.from_port >= GRAPH_MAX_PORTS || p_connection.to_port >= GRAPH_MAX_PORTS),
+                    ERR_INVALID_PARAMETER);
+
+    for (int i = 0; i < connections.size(); i++) {
+        const Lv2Layout::Connection &connection = connections[i];
+        if (connection.from == p_connection.from && connection.from_port == p_connection.from_port &&
+            connection.to == p_connection.to && connection.to_port == p_connection.to_port &&
+            connection.type == p_connection.type) {
+            return ERR_ALREADY_EXISTS;
+        }
+    }
+
+    ERR_FAIL_COND_V_MSG(is_reachable(p_connection.to, p_connection.from), ERR_CYCLIC_LINK,
+                        vformat("Connecting %s to %s would create a cycle.", p_connection.from, p_connection.to));
+
+    connections.push_back(p_connection);
+    return OK;
+}
+
+bool Lv2Server::is_reachable(const String &p_from, const String &p_to) const {
+    Vector<String> pending;
+    Vector<String> visited;
+    pending.push_back(p_from);
+
+    while (!pending.is_empty()) {
+        String name = pending[pending.size() - 1];
+        pending.remove_at(pending.size() - 1);
+        if (name == p_to) {
+            return true;
+        }
+        if (visited.has(name)) {
+            continue;
+        }
+        visited.push_back(name);
+
+        for (int i = 0; i < connections.size(); i++) {
+            if (connections[i].from == name) {
+                pending.push_back(connections[i].to);
+            }
+        }
+    }
+
+    return false;
+}
+
+void Lv2Server::remove_connections_of(const String &p_name) {
+    for (int i = connections.size() - 1; i >= 0; i--) {
+        if (connections[i].from == p_name || connections[i].to == p_name) {
+            connections.remove_at(i);
+        }
+    }
+}
+
+Vector<int> Lv2Server::sort_instances() const {
+    // Kahn's algorithm, ties are broken by instance index so the order stays stable
+    Vector<int> incoming;
+    incoming.resize(instances.size());
+    incoming.fill(0);
+
+    for (int i = 0; i < connections.size(); i++) {
+        int to = get_instance_index(connections[i].to);
+        if (to >= 0 && get_instance_index(connections[i].from) >= 0) {
+            incoming.write[to]++;
+        }
+    }
+
+    Vector<int> order;
+    Vector<bool> done;
+    done.resize(instances.size());
+    done.fill(false);
+
+    while (order.size() < instances.size()) {
+        int next = -1;
+        for (int i = 0; i < instances.size(); i++) {
+            if (!done[i] && incoming[i] == 0) {
+                next = i;
+                break;
+            }
+        }
+        // connections are kept acyclic, this only guards against a broken layout
+        ERR_FAIL_COND_V(next < 0, order);
+
+        done.write[next] = true;
+        order.push_back(next);
+
+        for (int i = 0; i < connections.size(); i++) {
+            if (connections[i].from != instances[next]->instance_name) {
+                continue;
+            }
+            int to = get_instance_index(connections[i].to);
+            if (to >= 0) {
+                incoming.write[to]--;
+            }
+        }
+    }
+
+    return order;
+}
+
+void Lv2Server::update_graph() {
+    int count = instances.size();
+
+    // connected instances form a group
+    Vector<int> group;
+    group.resize(count);
+    for (int i = 0; i < count; i++) {
+        group.write[i] = i;
+    }
+    for (int i = 0; i < connections.size(); i++) {
+        int from = get_instance_index(connections[i].from);
+        int to = get_instance_index(connections[i].to);
+        if (from < 0 || to < 0) {
+            continue;
+        }
+        while (group[from] != from) {
+            from = group[from];
+        }
+        while (group[to] != to) {
+            to = group[to];
+        }
+        group.write[MAX(from, to)] = MIN(from, to);
+    }
+    for (int i = 0; i < count; i++) {
+        int root = i;
+        while (group[root] != root) {
+            root = group[root];
+        }
+        group.write[i] = root;
+    }
+
+    Vector<int> order = sort_instances();
+
+    std::vector<std::vector<Lv2Instance::GraphNode>> nodes(count);
+    std::vector<Lv2Instance *> drivers(count, (Lv2Instance *)NULL);
+
+    for (int root = 0; root < count; root++) {
+        // members in processing order, the last one drives the group
+        Vector<int> members;
+        for (int i = 0; i < order.size(); i++) {
+            if (group[order[i]] == root) {
+                members.push_back(order[i]);
+            }
+        }
+        if (members.size() < 2) {
+            continue;
+        }
+
+        int driver = members[members.size() - 1];
+        std::vector<Lv2Instance::GraphNode> &group_nodes = nodes[driver];
+        group_nodes.resize(members.size());
+
+        for (int i = 0; i < members.size(); i++) {
+            Lv2Instance::GraphNode &node = group_nodes[i];
+            node.instance = instances[members[i]];
+            if (members[i] != driver) {
+                drivers[members[i]] = instances[driver];
+            }
+
+            for (int j = 0; j < connections.size(); j++) {
+                const Lv2Layout::Connection &connection = connections[j];
+                if (connection.to != node.instance->instance_name) {
+                    continue;
+                }
+
+                Lv2Instance::GraphRoute route;
+                route.source = members.find(get_instance_index(connection.from));
+                route.from_port = connection.from_port;
+                route.to_port = connection.to_port;
+                route.midi = connection.type == CONNECTION_MIDI;
+                ERR_CONTINUE(route.source < 0 || route.source >= i);
+                node.routes.push_back(route);
+
+                if (!route.midi) {
+                    node.routed_inputs |= 1ull << route.to_port;
+                }
+            }
+        }
+    }
+
+    // joining members hand their readers to the new driver first, then every driver takes its new group, then
+    // instances leaving a group render themselves again; a member goes without blocks for at most a moment.
+    // Locks are polled so a plugin hanging in run() can't take the caller along, see Lv2Instance::lock_watched()
+    for (int i = 0; i < count; i++) {
+        if (drivers[i] != NULL) {
+            bool locked = instances[i]->lock_watched();
+            instances[i]->io_mutex->lock();
+            instances[i]->graph_driver.store(drivers[i], std::memory_order_release);
+            instances[i]->io_mutex->unlock();
+            if (locked) {
+                instances[i]->unlock();
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        Lv2Instance *instance = instances[i];
+        bool locked = true;
+        while (!instance->graph_mutex->try_lock()) {
+            if (instance->quarantined.load(std::memory_order_acquire)) {
+                locked = false;
+                break;
+            }
+            OS::get_singleton()->delay_usec(WATCHDOG_POLL_USEC);
+        }
+        if (!locked) {
+            WARN_PRINT(vformat("Lv2 instance %s is stuck rendering its group, keeping its old routing.",
+                               instance->instance_name));
+            continue;
+        }
+        instance->graph_nodes.swap(nodes[i]);
+        instance->graph_mutex->unlock();
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (drivers[i] == NULL && instances[i]->graph_driver.load(std::memory_order_acquire) != NULL) {
+            bool locked = instances[i]->lock_watched();
+            instances[i]->io_mutex->lock();
+            instances[i]->graph_driver.store(NULL, std::memory_order_release);
+            instances[i]->io_mutex->unlock();
+            if (locked) {
+                instances[i]->unlock();
+            }
+        }
+    }
+}
+
+Error Lv2Server::add_connection(const String &p_from, int p_from_port, const String &p_to, int p_to_port,
+                                ConnectionType p_type) {
+    Lv2Layout::Connection connection;
+    connection.from = p_from;
+    connection.from_port = p_from_port;
+    connection.to = p_to;
+    connection.to_port = p_to_port;
+    connection.type = p_type;
+
+    Error error = insert_connection(connection);
+    if (error != OK) {
+        return error;
+    }
+
+    edited = true;
+
+    update_graph();
+    emit_signal("layout_changed");
+    return OK;
+}
+
+void Lv2Server::remove_connection(const String &p_from, int p_from_port, const String &p_to, int p_to_port,
+                                  ConnectionType p_type) {
+    for (int i = 0; i < connections.size(); i++) {
+        const Lv2Layout::Connection &connection = connections[i];
+        if (connection.from == p_from && connection.from_port == p_from_port && connection.to == p_to &&
+            connection.to_port == p_to_port && connection.type == p_type) {
+            edited = true;
+
+            connections.remove_at(i);
+            update_graph();
+            emit_signal("layout_changed");
+            return;
+        }
+    }
+}
+
+void Lv2Server::clear_connections() {
+    if (connections.is_empty()) {
+        return;
+    }
+
+    edited = true;
+
+    connections.clear();
+    update_graph();
+    emit_signal("layout_changed");
+}
+
+Array Lv2Server::get_connections() const {
+    Array result;
+
+    for (int i = 0; i < connections.size(); i++) {
+        Dictionary connection;
+        connection["from"] = connections[i].from;
+        connection["from_port"] = connections[i].from_port;
+        connection["to"] = connections[i].to;
+        connection["to_port"] = connections[i].to_port;
+        connection["type"] = connections[i].type;
+        result.push_back(connection);
+    }
+
+    return result;
+}
+
+PackedStringArray Lv2Server::get_processing_order() const {
+    PackedStringArray result;
+
+    Vector<int> order = sort_instances();
+    for (int i = 0; i < order.size(); i++) {
+        result.push_back(instances[order[i]]->instance_name);
+    }
+
+    return result;
+}
+
+void Lv2Server::open_midi_inputs() {
+    if (!midi_inputs_open) {
+        OS::get_singleton()->open_midi_inputs();
+        midi_inputs_open = true;
+    }
+    midi_devices = OS::get_singleton()->get_connected_midi_inputs();
+}
+
+Error Lv2Server::add_midi_route(const String &p_instance, int p_bus, int p_channel, const String &p_device) {
+    ERR_FAIL_COND_V(!instance_map.has(p_instance), ERR_DOES_NOT_EXIST);
+    ERR_FAIL_COND_V(p_bus < 0, ERR_INVALID_PARAMETER);
+    ERR_FAIL_COND_V(p_channel < -1 || p_channel > 15, ERR_INVALID_PARAMETER);
+
+    Lv2Layout::MidiRoute route;
+    route.instance = p_instance;
+    route.bus = p_bus;
+    route.channel = p_channel;
+    route.device = p_device;
+
+    for (int i = 0; i < midi_routes.size(); i++) {
+        const Lv2Layout::MidiRoute &other = midi_routes[i];
+        if (other.instance == route.instance && other.bus == route.bus && other.channel == route.channel &&
+            other.device == route.device) {
+            return ERR_ALREADY_EXISTS;
+        }
+    }
+
+    edited = true;
+
+    midi_routes.push_back(route);
+    open_midi_inputs();
+
+    emit_signal("layout_changed");
+    return OK;
+}
+
+void Lv2Server::remove_midi_route(int p_index) {
+    ERR_FAIL_INDEX(p_index, midi_routes.size());
+
+    edited = true;
+
+    midi_routes.remove_at(p_index);
+    emit_signal("layout_changed");
+}
+
+void Lv2Server::clear_midi_routes() {
+    if (midi_routes.is_empty()) {
+        return;
+    }
+
+    edited = true;
+
+    midi_routes.clear();
+    emit_signal("layout_changed");
+}
+
+Array Lv2Server::get_midi_routes() const {
+    Array result;
+
+    for (int i = 0; i < midi_routes.size(); i++) {
+        Dictionary route;
+        route["instance"] = midi_routes[i].instance;
+        route["bus"] = midi_routes[i].bus;
+        route["channel"] = midi_routes[i].channel;
+        route["device"] = midi_routes[i].device;
+        result.push_back(route);
+    }
+
+    return result;
+}
+
+PackedStringArray Lv2Server::get_midi_input_devices() {
+    if (midi_inputs_open) {
+        midi_devices = OS::get_singleton()->get_connected_midi_inputs();
+    }
+    return midi_devices;
+}
+
+void Lv2Server::route_midi_input(const Ref<InputEventMIDI> &p_event) {
+    if (midi_routes.is_empty()) {
+        return;
+    }
+
+    // InputEventMIDI carries no timestamp and Godot delivers it from the main loop, so this is when the frame
+    // dispatched the event, not when the hardware received it: events are spread within a block only to the
+    // resolution of the main loop, messages arriving during one frame land close together
+    uint64_t dispatch_usec = Time::get_singleton()->get_ticks_usec();
+
+    MidiEvent event;
+    if (!encode_midi_message(p_event, event)) {
+        return;
+    }
+
+    int device_index = p_event->get_device();
+    if (device_index >= midi_devices.size()) {
+        // plugged in since the routes were set up
+        midi_devices = OS::get_singleton()->get_connected_midi_inputs();
+    }
+    String device = device_index >= 0 && device_index < midi_devices.size() ? midi_devices[device_index] : String();
+    int channel = p_event->get_channel();
+
+    for (int i = 0; i < midi_routes.size(); i++) {
+        const Lv2Layout::MidiRoute &route = midi_routes[i];
+        if ((route.channel >= 0 && route.channel != channel) || (!route.device.is_empty() && route.device != device)) {
+            continue;
+        }
+
+        HashMap<String, Lv2Instance *>::Iterator it = instance_map.find(route.instance);
+        if (it) {
+            it->value->send_midi_event(route.bus, event, dispatch_usec);
+        }
+    }
+}
 
-    return instances[p_index]->output_channels[p_channel].active;
+bool Lv2Server::is_quarantined(int p_index) const {
+    ERR_FAIL_INDEX_V(p_index, instances.size(), false);
+    return instances[p_index]->is_quarantined();
+}
+
+void Lv2Server::recover_instance(int p_index) {
+    ERR_FAIL_INDEX(p_index, instances.size());
+    instances[p_index]->recover();
 }
 
 bool Lv2Server::load_default_layout() {
@@ -502,6 +1388,19 @@ bool Lv2Server::load_default_layout() {
 void Lv2Server::set_layout(const Ref<Lv2Layout> &p_layout) {
     ERR_FAIL_COND(p_layout.is_null() || p_layout->instances.size() == 0);
 
+    // the groups of the previous layout go away before any instance is reset
+    connections.clear();
+    update_graph();
+
+    // before the instances below get (re)loaded
+    loading_policies.clear();
+    Array policy_uris = p_layout->loading_policies.keys();
+    for (int i = 0; i < policy_uris.size(); i++) {
+        int policy = p_layout->loading_policies[policy_uris[i]];
+        loading_policies[policy_uris[i]] =
+            CLAMP(policy, (int)Lv2Instance::LOADING_POLICY_SHARED, (int)Lv2Instance::LOADING_POLICY_OUT_OF_PROCESS);
+    }
+
     int prev_size = instances.size();
     for (int i = prev_size; i < instances.size(); i++) {
         instances[i]->stop();
@@ -529,6 +1428,12 @@ void Lv2Server::set_layout(const Ref<Lv2Layout> &p_layout) {
         instance->bypass = p_layout->instances[i].bypass;
         instance->volume_db = p_layout->instances[i].volume_db;
         instance->uri = p_layout->instances[i].uri;
+        instance->set_priority((Lv2Instance::Priority)p_layout->instances[i].priority);
+        instance->assign_rack(p_layout->instances[i].rack);
+        const Array &rack_bypass = p_layout->instances[i].rack_bypass;
+        for (int slot = 0; slot < rack_bypass.size() && slot < instance->get_slot_count(); slot++) {
+            instance->set_slot_bypass(slot, rack_bypass[slot]);
+        }
         instance_map[instance->instance_name] = instance;
         instances.write[i] = instance;
 
@@ -536,15 +1441,67 @@ void Lv2Server::set_layout(const Ref<Lv2Layout> &p_layout) {
         if (!instance->is_connected("lv2_ready", Callable(this, "on_ready"))) {
             instance->connect("lv2_ready", Callable(this, "on_ready"), CONNECT_DEFERRED);
         }
+        if (!instance->is_connected("plugin_hung", Callable(this, "on_plugin_hung"))) {
+            instance->connect("plugin_hung", Callable(this, "on_plugin_hung"), CONNECT_DEFERRED);
+        }
+        if (!instance->is_connected("plugin_restarted", Callable(this, "on_plugin_restarted"))) {
+            instance->connect("plugin_restarted", Callable(this, "on_plugin_restarted"), CONNECT_DEFERRED);
+        }
+    }
+
+    for (int i = 0; i < p_layout->connections.size(); i++) {
+        const Lv2Layout::Connection &connection = p_layout->connections[i];
+        if (insert_connection(connection) != OK) {
+            WARN_PRINT(vformat("Skipping connection from %s:%d to %s:%d in layout.", connection.from,
+                               connection.from_port, connection.to, connection.to_port));
+        }
     }
+    update_graph();
+
+    midi_routes = p_layout->midi_routes;
+    if (!midi_routes.is_empty()) {
+        open_midi_inputs();
+    }
+
+    for (int i = 0; i < instances.size(); i++) {
+        instances[i]->clear_midi_mappings();
+    }
+    for (int i = 0; i < p_layout->midi_mappings.size(); i++) {
+        const Lv2Layout::MidiMapping &entry = p_layout->midi_mappings[i];
+        HashMap<String, Lv2Instance *>::Iterator it = instance_map.find(entry.instance);
+        if (!it || entry.channel < -1 || entry.channel > 15 || entry.number < 0) {
+            WARN_PRINT(vformat("Skipping MIDI mapping of %s to %s in layout.", entry.instance, entry.control));
+            continue;
+        }
+
+        MidiMapping mapping;
+        mapping.source = entry.source == Lv2Instance::MIDI_SOURCE_NRPN ? MIDI_MAP_SOURCE_NRPN : MIDI_MAP_SOURCE_CC;
+        mapping.channel = entry.channel;
+        mapping.number = entry.number;
+        mapping.symbol = std::string(entry.control.utf8().get_data());
+        mapping.curve = (MidiMapCurve)CLAMP(entry.curve, (int)MIDI_MAP_CURVE_LINEAR, (int)MIDI_MAP_CURVE_TOGGLE);
+        mapping.min = entry.min;
+        mapping.max = entry.max;
+        it->value->insert_midi_mapping(mapping);
+    }
+
     edited = false;
     layout_loaded = true;
+    update_solo_mode();
 }
 
 void Lv2Server::on_ready(String instance_name) {
     emit_signal("lv2_ready", instance_name);
 }
 
+void Lv2Server::on_plugin_hung(String instance_name, int64_t stalled_usec) {
+    emit_signal("plugin_hung", instance_name, stalled_usec);
+}
+
+void Lv2Server::on_plugin_restarted(String instance_name, int64_t restarts) {
+    emit_signal("plugin_restarted", instance_name, restarts);
+}
+
 Ref<Lv2Layout> Lv2Server::generate_layout() const {
     Ref<Lv2Layout> state;
     state.instantiate();
@@ -558,8 +1515,40 @@ Ref<Lv2Layout> Lv2Server::generate_layout() const {
         state->instances.write[i].bypass = instances[i]->bypass;
         state->instances.write[i].volume_db = instances[i]->volume_db;
         state->instances.write[i].uri = instances[i]->uri;
+        state->instances.write[i].priority = instances[i]->get_priority();
+        state->instances.write[i].rack = instances[i]->get_rack();
+        Array rack_bypass;
+        for (int slot = 0; slot < instances[i]->get_slot_count(); slot++) {
+            rack_bypass.push_back(instances[i]->is_slot_bypassed(slot));
+        }
+        state->instances.write[i].rack_bypass = rack_bypass;
     }
 
+    state->connections = connections;
+    state->midi_routes = midi_routes;
+
+    for (int i = 0; i < instances.size(); i++) {
+        instances[i]->lock();
+        for (const MidiMapping &mapping : instances[i]->midi_map.get_mappings()) {
+            // still waiting for a controller to be moved
+            if (mapping.learning) {
+                continue;
+            }
+            Lv2Layout::MidiMapping entry;
+            entry.instance = instances[i]->instance_name;
+            entry.source = mapping.source;
+            entry.channel = mapping.channel;
+            entry.number = mapping.number;
+            entry.control = String(mapping.symbol.c_str());
+            entry.curve = mapping.curve;
+            entry.min = mapping.min;
+            entry.max = mapping.max;
+            state->midi_mappings.push_back(entry);
+        }
+        instances[i]->unlock();
+    }
+    state->loading_policies = get_loading_policies();
+
     return state;
 }
 
@@ -567,6 +1556,7 @@ Error Lv2Server::start() {
     thread_exited = false;
     thread.instantiate();
     mutex.instantiate();
+    wake_semaphore.instantiate();
     thread->start(callable_mp(this, &Lv2Server::thread_func), Thread::PRIORITY_NORMAL);
     return OK;
 }
@@ -587,6 +1577,7 @@ void Lv2Server::unlock() {
 
 void Lv2Server::finish() {
     exit_thread = true;
+    wake();
     if (thread.is_valid() && thread->is_started()) {
         thread->wait_to_finish();
     }
@@ -694,6 +1685,50 @@ void Lv2Server::_bind_methods() {
 
     ClassDB::bind_method(D_METHOD("is_channel_active", "index", "channel"), &Lv2Server::is_channel_active);
 
+    ClassDB::bind_method(D_METHOD("get_meter_snapshot"), &Lv2Server::get_meter_snapshot);
+
+    ClassDB::bind_method(D_METHOD("set_realtime_policy", "policy", "priority"), &Lv2Server::set_realtime_policy);
+    ClassDB::bind_method(D_METHOD("set_dsp_cpu_affinity", "cpus"), &Lv2Server::set_dsp_cpu_affinity);
+    ClassDB::bind_method(D_METHOD("get_realtime_status"), &Lv2Server::get_realtime_status);
+
+    ClassDB::bind_method(D_METHOD("set_deadline_scheduling", "enabled"), &Lv2Server::set_deadline_scheduling);
+    ClassDB::bind_method(D_METHOD("get_deadline_stats", "index"), &Lv2Server::get_deadline_stats);
+    ClassDB::bind_method(D_METHOD("reset_deadline_stats", "index"), &Lv2Server::reset_deadline_stats);
+
+    ClassDB::bind_method(D_METHOD("set_governor_enabled", "enabled"), &Lv2Server::set_governor_enabled);
+    ClassDB::bind_method(D_METHOD("is_governor_enabled"), &Lv2Server::is_governor_enabled);
+    ClassDB::bind_method(D_METHOD("set_dsp_budget", "cores"), &Lv2Server::set_dsp_budget);
+    ClassDB::bind_method(D_METHOD("get_dsp_budget"), &Lv2Server::get_dsp_budget);
+    ClassDB::bind_method(D_METHOD("set_priority", "index", "priority"), &Lv2Server::set_priority);
+    ClassDB::bind_method(D_METHOD("get_priority", "index"), &Lv2Server::get_priority);
+    ClassDB::bind_method(D_METHOD("get_governor_actions"), &Lv2Server::get_governor_actions);
+    ClassDB::bind_method(D_METHOD("get_governor_stats"), &Lv2Server::get_governor_stats);
+
+    ClassDB::bind_method(D_METHOD("set_loading_policy", "uri", "policy"), &Lv2Server::set_loading_policy);
+    ClassDB::bind_method(D_METHOD("get_loading_policy", "uri"), &Lv2Server::get_loading_policy);
+    ClassDB::bind_method(D_METHOD("clear_loading_policy", "uri"), &Lv2Server::clear_loading_policy);
+    ClassDB::bind_method(D_METHOD("get_loading_policies"), &Lv2Server::get_loading_policies);
+    ClassDB::bind_method(D_METHOD("get_isolated_namespace_count"), &Lv2Server::get_isolated_namespace_count);
+    ClassDB::bind_method(D_METHOD("get_isolated_namespace_limit"), &Lv2Server::get_isolated_namespace_limit);
+
+    ClassDB::bind_method(D_METHOD("add_connection", "from", "from_port", "to", "to_port", "type"),
+                         &Lv2Server::add_connection, DEFVAL(CONNECTION_AUDIO));
+    ClassDB::bind_method(D_METHOD("remove_connection", "from", "from_port", "to", "to_port", "type"),
+                         &Lv2Server::remove_connection, DEFVAL(CONNECTION_AUDIO));
+    ClassDB::bind_method(D_METHOD("clear_connections"), &Lv2Server::clear_connections);
+    ClassDB::bind_method(D_METHOD("get_connections"), &Lv2Server::get_connections);
+    ClassDB::bind_method(D_METHOD("get_processing_order"), &Lv2Server::get_processing_order);
+
+    ClassDB::bind_method(D_METHOD("add_midi_route", "instance", "bus", "channel", "device"),
+                         &Lv2Server::add_midi_route, DEFVAL(0), DEFVAL(-1), DEFVAL(""));
+    ClassDB::bind_method(D_METHOD("remove_midi_route", "index"), &Lv2Server::remove_midi_route);
+    ClassDB::bind_method(D_METHOD("clear_midi_routes"), &Lv2Server::clear_midi_routes);
+    ClassDB::bind_method(D_METHOD("get_midi_routes"), &Lv2Server::get_midi_routes);
+    ClassDB::bind_method(D_METHOD("get_midi_input_devices"), &Lv2Server::get_midi_input_devices);
+
+    ClassDB::bind_method(D_METHOD("is_quarantined", "index"), &Lv2Server::is_quarantined);
+    ClassDB::bind_method(D_METHOD("recover_instance", "index"), &Lv2Server::recover_instance);
+
     ClassDB::bind_method(D_METHOD("lock"), &Lv2Server::lock);
     ClassDB::bind_method(D_METHOD("unlock"), &Lv2Server::unlock);
 
@@ -703,6 +1738,8 @@ void Lv2Server::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_instance", "name"), &Lv2Server::get_instance);
 
     ClassDB::bind_method(D_METHOD("on_ready", "name"), &Lv2Server::on_ready);
+    ClassDB::bind_method(D_METHOD("on_plugin_hung", "name", "stalled_usec"), &Lv2Server::on_plugin_hung);
+    ClassDB::bind_method(D_METHOD("on_plugin_restarted", "name", "restarts"), &Lv2Server::on_plugin_restarted);
 
     ClassDB::bind_method(D_METHOD("get_plugins"), &Lv2Server::get_plugins);
 
@@ -710,8 +1747,18 @@ void Lv2Server::_bind_methods() {
 
     ADD_PROPERTY(PropertyInfo(Variant::INT, "instance_count"), "set_instance_count", "get_instance_count");
 
+    BIND_ENUM_CONSTANT(CONNECTION_AUDIO);
+    BIND_ENUM_CONSTANT(CONNECTION_MIDI);
+
     ADD_SIGNAL(MethodInfo("layout_changed"));
     ADD_SIGNAL(MethodInfo("lv2_ready", PropertyInfo(Variant::STRING, "name")));
+    ADD_SIGNAL(
+        MethodInfo("plugin_hung", PropertyInfo(Variant::STRING, "name"), PropertyInfo(Variant::INT, "stalled_usec")));
+    ADD_SIGNAL(
+        MethodInfo("plugin_restarted", PropertyInfo(Variant::STRING, "name"), PropertyInfo(Variant::INT, "restarts")));
+    ADD_SIGNAL(MethodInfo("governor_action", PropertyInfo(Variant::STRING, "name"),
+                          PropertyInfo(Variant::STRING, "action"), PropertyInfo(Variant::INT, "level"),
+                          PropertyInfo(Variant::FLOAT, "load"), PropertyInfo(Variant::STRING, "detail")));
 }
 
 } // namespace godot
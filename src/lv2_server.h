@@ -3,6 +3,7 @@
 
 #include <godot_cpp/classes/audio_frame.hpp>
 #include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/input_event_midi.hpp>
 #include <godot_cpp/classes/main_loop.hpp>
 #include <godot_cpp/classes/node.hpp>
 #include <godot_cpp/classes/resource_loader.hpp>
@@ -13,6 +14,7 @@
 #include <godot_cpp/variant/utility_functions.hpp>
 
 #include "godot_cpp/classes/mutex.hpp"
+#include "godot_cpp/classes/semaphore.hpp"
 #include "godot_cpp/classes/thread.hpp"
 #include "lv2_instance.h"
 #include "lv2_layout.h"
@@ -22,6 +24,12 @@ namespace godot {
 class Lv2Server : public Object {
     GDCLASS(Lv2Server, Object);
 
+public:
+    enum ConnectionType {
+        CONNECTION_AUDIO,
+        CONNECTION_MIDI,
+    };
+
 private:
     bool initialized;
     bool layout_loaded;
@@ -36,9 +44,61 @@ private:
     mutable bool exit_thread;
     Ref<Thread> thread;
     Ref<Mutex> mutex;
-
+    // the server thread sleeps here until something it tracks changes
+    Ref<Semaphore> wake_semaphore;
+    // set by instance threads as they start a block; the server thread polls the watchdog until a tick finds it
+    // clear and no block in progress, then parks again
+    std::atomic<bool> blocks_started;
+
+    // degrades PRIORITY_LOW instances one step at a time while the summed render time of all instance threads
+    // stays over budget (in cores) or a higher priority instance misses a deadline, and restores them once the
+    // load has stayed well below budget for a while
+    struct Governor {
+        bool enabled = false;
+        float budget = 0.8f;
+        int level = 0;
+        int cooldown = 0;
+        int calm_ticks = 0;
+        float load = 0.0f;
+        uint64_t last_tick_usec = 0;
+        uint32_t escalations = 0;
+        uint32_t recoveries = 0;
+    };
+
+    Governor governor;
+    Array governor_actions;
+
+    // Lv2Instance::LoadingPolicy per plugin uri, the others use default_loading_policy
+    HashMap<String, int> loading_policies;
+    Lv2Instance::LoadingPolicy default_loading_policy;
+
+    // routes between instances, by name; update_graph() turns them into render groups on the instances
+    Vector<Lv2Layout::Connection> connections;
+
+    // hardware MIDI handed straight to instances by route_midi_input(), by instance name
+    Vector<Lv2Layout::MidiRoute> midi_routes;
+    // names of the connected MIDI inputs, indexed by InputEventMIDI::device
+    PackedStringArray midi_devices;
+    bool midi_inputs_open;
+
+    void open_midi_inputs();
+
+    Error insert_connection(const Lv2Layout::Connection &p_connection);
+    bool is_reachable(const String &p_from, const String &p_to) const;
+    void remove_connections_of(const String &p_name);
+    // instance indices, sources before the instances they feed
+    Vector<int> sort_instances() const;
+    void update_graph();
+
+    void update_governor();
+
+    void wake();
+    void update_solo_mode();
     void on_ready(String instance_name);
-    void add_property(String name, String default_value, GDExtensionVariantType extension_type, PropertyHint hint);
+    void on_plugin_hung(String instance_name, int64_t stalled_usec);
+    void on_plugin_restarted(String instance_name, int64_t restarts);
+    void add_property(String name, String default_value, GDExtensionVariantType extension_type, PropertyHint hint,
+                      String hint_string = "");
 
 protected:
     bool solo_mode;
@@ -54,6 +114,9 @@ public:
 
     bool get_solo_mode();
 
+    // called by an instance thread before it runs a block
+    void watch_block();
+
     void set_edited(bool p_edited);
     bool get_edited();
 
@@ -97,6 +160,59 @@ public:
 
     bool is_channel_active(int p_index, int p_channel) const;
 
+    Array get_meter_snapshot() const;
+
+    // applies to the instances that exist now, new instances start from the project settings
+    void set_realtime_policy(Lv2Instance::RealtimePolicy p_policy, int p_priority);
+    void set_dsp_cpu_affinity(const PackedInt32Array &p_cpus);
+    Array get_realtime_status() const;
+
+    // render-ahead and deadline priority boosts for every instance, stats per instance
+    void set_deadline_scheduling(bool p_enabled);
+    Dictionary get_deadline_stats(int p_index) const;
+    void reset_deadline_stats(int p_index);
+
+    // dsp budget governor, actions are reported through the governor_action signal
+    void set_governor_enabled(bool p_enabled);
+    bool is_governor_enabled() const;
+    void set_dsp_budget(float p_cores);
+    float get_dsp_budget() const;
+    void set_priority(int p_index, Lv2Instance::Priority p_priority);
+    Lv2Instance::Priority get_priority(int p_index) const;
+    Array get_governor_actions();
+    Dictionary get_governor_stats();
+
+    // how each plugin is loaded, picked up by instances the next time they load it (set_uri, recover)
+    void set_loading_policy(const String &p_uri, Lv2Instance::LoadingPolicy p_policy);
+    Lv2Instance::LoadingPolicy get_loading_policy(const String &p_uri) const;
+    void clear_loading_policy(const String &p_uri);
+    Dictionary get_loading_policies() const;
+    int get_isolated_namespace_count() const;
+    int get_isolated_namespace_limit() const;
+
+    // routes an output port (or MIDI output bus) of one instance into an input of another; connected instances
+    // are rendered together, sources first, on the thread of the last one
+    Error add_connection(const String &p_from, int p_from_port, const String &p_to, int p_to_port,
+                         ConnectionType p_type = CONNECTION_AUDIO);
+    void remove_connection(const String &p_from, int p_from_port, const String &p_to, int p_to_port,
+                           ConnectionType p_type = CONNECTION_AUDIO);
+    void clear_connections();
+    Array get_connections() const;
+    PackedStringArray get_processing_order() const;
+
+    // MIDI from connected inputs goes to the bus of an instance, filtered by device name (empty for any) and
+    // channel (-1 for any); captured by the server node, stamped on arrival, no script involved
+    Error add_midi_route(const String &p_instance, int p_bus = 0, int p_channel = -1, const String &p_device = "");
+    void remove_midi_route(int p_index);
+    void clear_midi_routes();
+    Array get_midi_routes() const;
+    PackedStringArray get_midi_input_devices();
+    void route_midi_input(const Ref<InputEventMIDI> &p_event);
+
+    // instances whose plugin hung in run(), see Lv2Instance::recover()
+    bool is_quarantined(int p_index) const;
+    void recover_instance(int p_index);
+
     bool load_default_layout();
     void set_layout(const Ref<Lv2Layout> &p_layout);
     Ref<Lv2Layout> generate_layout() const;
@@ -118,4 +234,6 @@ public:
 };
 } // namespace godot
 
+VARIANT_ENUM_CAST(Lv2Server::ConnectionType);
+
 #endif
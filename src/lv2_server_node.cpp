@@ -13,6 +13,13 @@ void Lv2ServerNode::_process() {
     Lv2Server::get_singleton()->process();
 }
 
+void Lv2ServerNode::_input(const Ref<InputEvent> &p_event) {
+    Ref<InputEventMIDI> midi = p_event;
+    if (midi.is_valid()) {
+        Lv2Server::get_singleton()->route_midi_input(midi);
+    }
+}
+
 void Lv2ServerNode::_bind_methods() {
     ClassDB::bind_method(D_METHOD("process"), &Lv2ServerNode::_process);
 }
@@ -1,6 +1,7 @@
 #ifndef LV2_SERVER_NODE_H
 #define LV2_SERVER_NODE_H
 
+#include <godot_cpp/classes/input_event.hpp>
 #include <godot_cpp/classes/node.hpp>
 
 namespace godot {
@@ -15,6 +16,8 @@ public:
     ~Lv2ServerNode();
 
     void _process();
+    // MIDI input is routed to the instances from here, see Lv2Server::add_midi_route()
+    void _input(const Ref<InputEvent> &p_event) override;
 
     static void _bind_methods();
 };